@@ -119,8 +119,7 @@ inline unsigned newyorkCenterDistance(const Matrix& a, const Matrix& b)
     unsigned res = 0;
     for (int i = 0; i < 4; ++i)
     {
-        auto distance = std::round(a(i, 3) - b(i, 3));
-        assert(distance >= 0.);
+        auto distance = std::round(std::abs(a(i, 3) - b(i, 3)));
         res += static_cast<unsigned>(distance);
     }
     return res;
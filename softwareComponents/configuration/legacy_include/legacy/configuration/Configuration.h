@@ -6,6 +6,7 @@
 #define ROBOTS_CONFIGURATION_H
 
 #include "legacy/configuration/Matrix.h"
+#include "legacy/configuration/IdMap.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <array>
@@ -240,12 +241,17 @@ rofi::configuration::matrices::Matrix transformConnection(ConnectorId d1, int or
 
 /* CONFIGURATION
  *
+ * All per-module data is kept in flat IdMaps sorted by module ID, so that
+ * copying, hashing and comparing configurations touches a few contiguous
+ * buffers instead of a hash table per map.
  * */
 
-using ModuleMap = std::unordered_map<ID, Module>;
+using ModuleMap = IdMap<ID, Module>;
 using EdgeList = std::array<std::optional<Edge>, 6>;
-using EdgeMap = std::unordered_map<ID, EdgeList>;
-using MatrixMap = std::unordered_map<ID, std::array<rofi::configuration::matrices::Matrix, 2>>;
+using EdgeMap = IdMap<ID, EdgeList>;
+using MatrixMap = IdMap<ID, std::array<rofi::configuration::matrices::Matrix, 2>>;
+using SpanningPredMap = IdMap<ID, std::optional<std::pair<ID, ShoeId>>>;
+using SpanningCountMap = IdMap<ID, unsigned int>;
 enum Value { True, False, Unknown };
 
 class Configuration
@@ -268,9 +274,9 @@ public:
     std::vector<Edge> getEdges(ID id) const;
     std::vector<Edge> getEdges(ID id, const std::unordered_set<ID>& exclude) const;
 
-    const std::unordered_map<ID, std::array<std::optional<Edge>, 6>>& getSpanningSucc() const;
-    const std::unordered_map<ID, unsigned int>& getSpanningSuccCount() const;
-    const std::unordered_map<ID, std::optional<std::pair<ID, ShoeId>>>& getSpanningPred() const;
+    const EdgeMap& getSpanningSucc() const;
+    const SpanningCountMap& getSpanningSuccCount() const;
+    const SpanningPredMap& getSpanningPred() const;
 
     // Creates new module with given ID and angles. Creates an empty set of edges corresponding to the module.
     void addModule(double alpha, double beta, double gamma, ID id);
@@ -329,6 +335,16 @@ public:
     bool collisionFree();
     bool collisionFree() const;
 
+    /**
+     * \brief Checks that no shoe of the modules in \p moved collides with
+     * another shoe.
+     *
+     * Collisions between modules not in \p moved are not checked, which
+     * suits validation after moving only the modules in \p moved.
+     * Matrices have to be computed, otherwise `false` is returned.
+     */
+    bool collisionFree(const std::vector<ID>& moved) const;
+
     rofi::configuration::matrices::Vector massCenter() const;
 
     rofi::configuration::matrices::Vector getModuleMass(ID id) const;
@@ -384,14 +400,20 @@ private:
 
     Value connectedVal = Value::True;
     Value matricesVal = Value::False;
-
-    std::unordered_map<ID, std::array<std::optional<Edge>, 6>> spanningSucc;
-    std::unordered_map<ID, unsigned int> spanningSuccCount;
-    std::unordered_map<ID, std::optional<std::pair<ID, ShoeId>>> spanningPred;
-    std::unordered_map<ID, std::array<std::optional<Edge>, 6>> spanningCross;
-    std::unordered_map<ID, std::array<bool,2>> isMatrixComputed;
-    std::unordered_map<ID, std::array<bool,2>> isMatrixUpdated;
-    std::unordered_map<ID, bool> isChecked;
+    // Result of the last collision check of the current matrices. When it is
+    // Unknown and collisionPartial is set, the matrices were last recomputed
+    // incrementally from a collision-free state, so only modules with an
+    // updated matrix have to be checked.
+    Value collisionVal = Value::Unknown;
+    bool collisionPartial = false;
+
+    EdgeMap spanningSucc;
+    SpanningCountMap spanningSuccCount;
+    SpanningPredMap spanningPred;
+    EdgeMap spanningCross;
+    IdMap<ID, std::array<bool,2>> isMatrixComputed;
+    IdMap<ID, std::array<bool,2>> isMatrixUpdated;
+    IdMap<ID, bool> isChecked;
     bool spanningTreeComputed = false;
 
 
@@ -409,6 +431,14 @@ private:
 
     bool checkConsistency();
 
+    /**
+     * \brief Checks collisions of modules whose matrix was updated by the last
+     * `computeMatrices` against all other modules.
+     *
+     * Pairs of modules that were not updated are assumed to be collision free.
+     */
+    bool collisionFreeMoved() const;
+
     /**
      * \brief Computes differences between all joints of module with ID \p id
      * and \p otherModule
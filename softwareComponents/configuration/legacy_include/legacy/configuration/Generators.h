@@ -6,8 +6,33 @@
 #ifndef ROBOTS_GENERATORS_H
 #define ROBOTS_GENERATORS_H
 
+/**
+ * \brief Executes \p action on a copy of \p config in small steps and returns
+ * the result if every step is valid.
+ *
+ * The copy keeps the spanning tree and matrices of \p config, so each step
+ * recomputes only matrices below the rotated joints and checks collisions of
+ * the moved modules only.
+ */
 std::optional<Configuration> executeIfValid(const Configuration& config, const Action &action);
 
+/**
+ * \brief Executes every action of \p actions on \p config and appends the
+ * valid results to \p res, in the order of \p actions.
+ *
+ * The actions are checked on the successor thread pool if it was enabled by
+ * `setSuccessorThreads`; the result is the same as with sequential checking.
+ */
+void executeAllIfValid(const Configuration& config, const std::vector<Action>& actions,
+    std::vector<Configuration>& res);
+
+/**
+ * \brief Sets how many threads check successors in `next` and the other
+ * `*Next` generators. 1 (the default) checks them on the calling thread,
+ * 0 uses all hardware threads.
+ */
+void setSuccessorThreads(unsigned threads);
+
 /**
  * \brief Generates all possible actions.
  *
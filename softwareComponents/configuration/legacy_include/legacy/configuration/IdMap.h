@@ -0,0 +1,125 @@
+#ifndef ROBOTS_IDMAP_H
+#define ROBOTS_IDMAP_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/* ID MAP
+ *
+ * Flat map from module ID to a value, used for the per-module data of
+ * a Configuration. The entries live in a single vector sorted by ID, so
+ * copying a map is one contiguous copy, equality is a linear scan and
+ * iteration order is deterministic. Module IDs are usually dense
+ * (0, 1, ..., n - 1); in that case the entry of `id` sits at index `id`
+ * and lookups skip the binary search.
+ *
+ * The interface mirrors the subset of std::unordered_map used across the
+ * codebase. Unlike std::unordered_map, inserting a new ID invalidates
+ * references to other entries.
+ * */
+
+template<typename ID, typename T>
+class IdMap {
+public:
+    using key_type = ID;
+    using mapped_type = T;
+    using value_type = std::pair<ID, T>;
+    using Storage = std::vector<value_type>;
+    using iterator = typename Storage::iterator;
+    using const_iterator = typename Storage::const_iterator;
+    using size_type = typename Storage::size_type;
+
+    iterator begin() { return _entries.begin(); }
+    const_iterator begin() const { return _entries.begin(); }
+    const_iterator cbegin() const { return _entries.cbegin(); }
+    iterator end() { return _entries.end(); }
+    const_iterator end() const { return _entries.end(); }
+    const_iterator cend() const { return _entries.cend(); }
+
+    size_type size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    void clear() { _entries.clear(); }
+    void reserve(size_type n) { _entries.reserve(n); }
+
+    iterator find(ID id) {
+        auto it = lowerBound(_entries, id);
+        return it != _entries.end() && it->first == id ? it : _entries.end();
+    }
+
+    const_iterator find(ID id) const {
+        auto it = lowerBound(_entries, id);
+        return it != _entries.end() && it->first == id ? it : _entries.end();
+    }
+
+    size_type count(ID id) const { return find(id) != end() ? 1 : 0; }
+    bool contains(ID id) const { return find(id) != end(); }
+
+    T& at(ID id) {
+        auto it = find(id);
+        if (it == end())
+            throw std::out_of_range("IdMap::at: no entry for id " + std::to_string(id));
+        return it->second;
+    }
+
+    const T& at(ID id) const {
+        auto it = find(id);
+        if (it == end())
+            throw std::out_of_range("IdMap::at: no entry for id " + std::to_string(id));
+        return it->second;
+    }
+
+    T& operator[](ID id) {
+        return try_emplace(id).first->second;
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(ID id, Args&&... args) {
+        auto it = lowerBound(_entries, id);
+        if (it != _entries.end() && it->first == id)
+            return { it, false };
+        it = _entries.emplace(it, std::piecewise_construct,
+                              std::forward_as_tuple(id),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+        return { it, true };
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(ID id, Args&&... args) {
+        return try_emplace(id, std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    size_type erase(ID id) {
+        auto it = find(id);
+        if (it == end())
+            return 0;
+        _entries.erase(it);
+        return 1;
+    }
+
+    iterator erase(const_iterator it) { return _entries.erase(it); }
+
+    bool operator==(const IdMap& other) const { return _entries == other._entries; }
+    bool operator!=(const IdMap& other) const { return !(*this == other); }
+
+private:
+    template<typename Entries>
+    static auto lowerBound(Entries& entries, ID id) {
+        if (id >= 0 && static_cast<size_type>(id) < entries.size()
+            && entries[static_cast<size_type>(id)].first == id)
+            return entries.begin() + id;
+        return std::lower_bound(entries.begin(), entries.end(), id,
+            [](const value_type& entry, ID key) { return entry.first < key; });
+    }
+
+    Storage _entries;
+};
+
+#endif //ROBOTS_IDMAP_H
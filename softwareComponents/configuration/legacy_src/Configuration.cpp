@@ -1,6 +1,9 @@
 #include "legacy/configuration/Configuration.h"
+#include <cmath>
+#include <cstdint>
 #include <stdexcept>
 #include <queue>
+#include <utility>
 
 using namespace rofi::configuration::matrices;
 
@@ -248,26 +251,22 @@ std::vector<Edge> Configuration::getEdges(ID id, const std::unordered_set<ID>& e
 }
 
 
-const std::unordered_map<ID, std::array<std::optional<Edge>, 6>>& Configuration::getSpanningSucc() const {
+const EdgeMap& Configuration::getSpanningSucc() const {
     return spanningSucc;
 }
 
-const std::unordered_map<ID, unsigned int>& Configuration::getSpanningSuccCount() const {
+const SpanningCountMap& Configuration::getSpanningSuccCount() const {
     return spanningSuccCount;
 }
 
-const std::unordered_map<ID, std::optional<std::pair<ID, ShoeId>>>& Configuration::getSpanningPred() const {
+const SpanningPredMap& Configuration::getSpanningPred() const {
     return spanningPred;
 }
 
 
 void Configuration::addModule(double alpha, double beta, double gamma, ID id) {
-    modules.emplace(std::piecewise_construct,
-                    std::forward_as_tuple(id),  // args for key
-                    std::forward_as_tuple(alpha, beta, gamma, id));
-    edges.emplace(std::piecewise_construct,
-                    std::forward_as_tuple(id),  // args for key
-                    std::forward_as_tuple());
+    modules.try_emplace(id, alpha, beta, gamma, id);
+    edges.try_emplace(id);
     if ((modules.size() == 1) || (id < fixedId)) {
         fixedId = id;
         matricesVal = Value::False;
@@ -416,6 +415,8 @@ bool Configuration::computeMatrices() {
     } else {
         isMatrixUpdated[fixedId][fixedSide] = false;
     }
+    collisionPartial = !recomputeAll && collisionVal == Value::True;
+    collisionVal = Value::Unknown;
 
     std::queue<std::tuple<ID, ShoeId, bool>> bag;
     bag.emplace(fixedId, fixedSide, recomputeAll);
@@ -547,50 +548,127 @@ void Configuration::dfsID(ID id, std::unordered_set<ID>& seen) const {
     }
 }
 
-bool Configuration::collisionFree() {
-    if (matricesVal != Value::True && !computeMatrices())
+namespace {
+
+/**
+ * \brief Uniform grid of shoe centers with unit cells.
+ *
+ * Two shoes collide if their centers are closer than 1, so every shoe
+ * colliding with a given one lies in one of the 27 cells around it. Cells
+ * are stored in a hash map, so building the grid and checking all shoes
+ * takes linear time for configurations without heavy overlaps.
+ */
+class ShoeGrid {
+public:
+    explicit ShoeGrid(const MatrixMap& matrices) {
+        shoes.reserve(2 * matrices.size());
+        cells.reserve(2 * matrices.size());
+        for (const auto& [id, ms] : matrices) {
+            for (const Matrix& shoe : ms) {
+                cells[cellKey(cellOf(shoe))].push_back(shoes.size());
+                shoes.push_back(&shoe);
+            }
+        }
+    }
+
+    /** Returns true if \p shoe, which has to be in the grid, collides with another shoe. */
+    bool collides(const Matrix& shoe) const {
+        return collides(shoe, 0);
+    }
+
+    /** Returns true if any two shoes in the grid collide. */
+    bool anyCollision() const {
+        for (size_t i = 0; i < shoes.size(); ++i) {
+            if (collides(*shoes[i], i + 1))
+                return true;
+        }
         return false;
-    for (auto it1 = matrices.begin(); it1 != matrices.end(); ++it1) {
-        for (auto it2 = it1; it2 != matrices.end(); ++it2) {
-            const auto& ms1 = it1->second;
-            const auto& ms2 = it2->second;
-            if (it1 == it2) {
-                if (centerSqDistance(ms1[A], ms1[B]) < 1)
-                    return false;
-                continue;
+    }
+
+private:
+    using Cell = std::array<long, 3>;
+
+    static Cell cellOf(const Matrix& m) {
+        return { std::lround(std::floor(m(0, 3))),
+                 std::lround(std::floor(m(1, 3))),
+                 std::lround(std::floor(m(2, 3))) };
+    }
+
+    // Distinct cells may share a key; that only adds candidates, which are
+    // then rejected by the exact distance check.
+    static uint64_t cellKey(const Cell& c) {
+        auto h = static_cast<uint64_t>(c[0]) * 0x9E3779B97F4A7C15ULL;
+        h = (h ^ static_cast<uint64_t>(c[1])) * 0xC2B2AE3D27D4EB4FULL;
+        h = (h ^ static_cast<uint64_t>(c[2])) * 0x165667B19E3779F9ULL;
+        return h;
+    }
+
+    // Checks `shoe` against the other shoes with index at least `from`.
+    bool collides(const Matrix& shoe, size_t from) const {
+        Cell c = cellOf(shoe);
+        for (long dx = -1; dx <= 1; ++dx) {
+            for (long dy = -1; dy <= 1; ++dy) {
+                for (long dz = -1; dz <= 1; ++dz) {
+                    auto it = cells.find(cellKey({c[0] + dx, c[1] + dy, c[2] + dz}));
+                    if (it == cells.end())
+                        continue;
+                    for (size_t other : it->second) {
+                        if (other < from || shoes[other] == &shoe)
+                            continue;
+                        if (centerSqDistance(shoe, *shoes[other]) < 1)
+                            return true;
+                    }
+                }
             }
-            if (centerSqDistance(ms1[A], ms2[A]) < 1 ||
-                centerSqDistance(ms1[B], ms2[B]) < 1 ||
-                centerSqDistance(ms1[B], ms2[A]) < 1 ||
-                centerSqDistance(ms1[A], ms2[B]) < 1)
-                return false;
         }
+        return false;
     }
-    return true;
+
+    std::vector<const Matrix*> shoes;
+    std::unordered_map<uint64_t, std::vector<size_t>> cells;
+};
+
+} // namespace
+
+bool Configuration::collisionFree() {
+    if (matricesVal != Value::True && !computeMatrices())
+        return false;
+    if (collisionVal == Value::Unknown) {
+        bool free = collisionPartial ? collisionFreeMoved() : std::as_const(*this).collisionFree();
+        collisionVal = free ? Value::True : Value::False;
+        collisionPartial = false;
+    }
+    return collisionVal == Value::True;
 }
 
 bool Configuration::collisionFree() const {
     if (matricesVal != Value::True)
         return false;
-    for (auto it1 = matrices.begin(); it1 != matrices.end(); ++it1) {
-        for (auto it2 = it1; it2 != matrices.end(); ++it2) {
-            const auto& ms1 = it1->second;
-            const auto& ms2 = it2->second;
-            if (it1 == it2) {
-                if (centerSqDistance(ms1[A], ms1[B]) < 1)
-                    return false;
-                continue;
-            }
-            if (centerSqDistance(ms1[A], ms2[A]) < 1 ||
-                centerSqDistance(ms1[B], ms2[B]) < 1 ||
-                centerSqDistance(ms1[B], ms2[A]) < 1 ||
-                centerSqDistance(ms1[A], ms2[B]) < 1)
+    return !ShoeGrid(matrices).anyCollision();
+}
+
+bool Configuration::collisionFree(const std::vector<ID>& moved) const {
+    if (matricesVal != Value::True)
+        return false;
+    ShoeGrid grid(matrices);
+    for (ID id : moved) {
+        for (const Matrix& shoe : matrices.at(id)) {
+            if (grid.collides(shoe))
                 return false;
         }
     }
     return true;
 }
 
+bool Configuration::collisionFreeMoved() const {
+    std::vector<ID> moved;
+    for (const auto& [id, updated] : isMatrixUpdated) {
+        if (updated[A] || updated[B])
+            moved.push_back(id);
+    }
+    return collisionFree(moved);
+}
+
 Vector Configuration::massCenter() const {
     Vector mass({0,0,0,1});
     for (const auto& [id, ms] : matrices) {
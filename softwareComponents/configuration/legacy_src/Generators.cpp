@@ -1,5 +1,13 @@
 #include "legacy/configuration/Generators.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <thread>
 
 using namespace rofi::configuration::matrices;
 
@@ -34,6 +42,150 @@ std::optional<Configuration> executeIfValid(const Configuration& config, const A
     return next;
 }
 
+namespace {
+
+/**
+ * \brief Fixed set of threads running the iterations of parallel loops.
+ *
+ * Several loops may run at once (e.g. when the search itself is parallel);
+ * the calling thread always works on its own loop, so a loop finishes even
+ * if all pool threads are busy elsewhere.
+ */
+class LoopPool {
+public:
+    explicit LoopPool(unsigned threads) {
+        for (unsigned i = 0; i < threads; ++i)
+            _threads.emplace_back([this]{ workerLoop(); });
+    }
+
+    ~LoopPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+        auto job = std::make_shared<Job>(count, body);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(job);
+        }
+        _cv.notify_all();
+
+        work(*job);
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&]{ return job->done.load() == job->count; });
+        // Rethrown only once no pool thread uses the body any more
+        if (job->error)
+            std::rethrow_exception(job->error);
+    }
+
+private:
+    struct Job {
+        Job(size_t count, const std::function<void(size_t)>& body) : count(count), body(body) {}
+
+        size_t count;
+        const std::function<void(size_t)>& body;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;   // first exception of the body, guarded by mutex
+    };
+
+    static void work(Job& job) {
+        for (size_t i = job.next++; i < job.count; i = job.next++) {
+            // After a failure the remaining iterations are only counted as done
+            if (!job.failed) {
+                try {
+                    job.body(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(job.mutex);
+                    if (!job.error)
+                        job.error = std::current_exception();
+                    job.failed = true;
+                }
+            }
+            if (++job.done == job.count) {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                job.finished.notify_all();
+            }
+        }
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [&]{ return _stop || !_jobs.empty(); });
+                if (_stop)
+                    return;
+                job = _jobs.front();
+                if (job->next.load() >= job->count) {
+                    _jobs.pop_front();
+                    continue;
+                }
+            }
+            work(*job);
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::deque<std::shared_ptr<Job>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop = false;
+};
+
+std::mutex successorPoolMutex;
+std::shared_ptr<LoopPool> successorPool;
+
+} // namespace
+
+void setSuccessorThreads(unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    std::lock_guard<std::mutex> lock(successorPoolMutex);
+    // The calling thread takes part in every loop, so the pool needs one
+    // thread less than requested.
+    successorPool = threads > 1 ? std::make_shared<LoopPool>(threads - 1) : nullptr;
+}
+
+void executeAllIfValid(const Configuration& config, const std::vector<Action>& actions,
+    std::vector<Configuration>& res)
+{
+    std::shared_ptr<LoopPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(successorPoolMutex);
+        pool = successorPool;
+    }
+
+    if (!pool || actions.size() < 2) {
+        for (const auto& action : actions) {
+            auto cfgOpt = executeIfValid(config, action);
+            if (cfgOpt.has_value())
+                res.push_back(std::move(cfgOpt.value()));
+        }
+        return;
+    }
+
+    std::vector<std::optional<Configuration>> results(actions.size());
+    pool->parallelFor(actions.size(), [&](size_t i) {
+        results[i] = executeIfValid(config, actions[i]);
+    });
+    for (auto& cfgOpt : results) {
+        if (cfgOpt.has_value())
+            res.push_back(std::move(cfgOpt.value()));
+    }
+}
+
 void generateActions(const Configuration& config, std::vector<Action>& res, unsigned step, unsigned bound /*=1*/) {
     // TODO maybe improve this
     std::vector<Action::Rotate> rotations;
@@ -324,52 +476,32 @@ void next(const Configuration& config, std::vector<Configuration>& res, unsigned
         generateActions(config, actions, step, bound);
     }
 
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void simpleNext(const Configuration& config, std::vector<Configuration>& res, unsigned step) {
     std::vector<Action> actions;
     generateSimpleActions(config, actions, step);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void simpleOnlyRotNext(const Configuration& config, std::vector<Configuration>& res, unsigned step) {
     std::vector<Action> actions;
     generateSimpleOnlyRotActions(config, actions, step);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 
 void bisimpleNext(const Configuration& config, std::vector<Configuration>& res, unsigned step) {
     std::vector<Action> actions;
     generateBisimpleActions(config, actions, step);
-    for (const auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void bisimpleOnlyRotNext(const Configuration& config, std::vector<Configuration>& res, unsigned step) {
     std::vector<Action> actions;
     generateBisimpleOnlyRotActions(config, actions, step);
-    for (const auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 
@@ -378,11 +510,7 @@ void paralyzedNext(const Configuration& config, std::vector<Configuration>& res,
 {
     std::vector<Action> actions;
     generateParalyzedActions(config, actions, step, allowed_indices);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void biParalyzedOnlyRotNext(const Configuration& config, std::vector<Configuration>& res, unsigned step,
@@ -390,11 +518,7 @@ void biParalyzedOnlyRotNext(const Configuration& config, std::vector<Configurati
 {
     std::vector<Action> actions;
     generateBiParalyzedOnlyRotActions(config, actions, step, allowed_indices);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void smartBisimpleOnlyRotNext(const Configuration& config, std::vector<Configuration>& res, unsigned step)
@@ -403,11 +527,7 @@ void smartBisimpleOnlyRotNext(const Configuration& config, std::vector<Configura
     auto ids = config.getIDs();
     std::unordered_set<ID> allowed_indices(ids.begin(), ids.end());
     generateSmartParalyzedOnlyRotActions(config, actions, step, allowed_indices);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
 
 void smartBisimpleParOnlyRotNext(const Configuration& config, std::vector<Configuration>& res, unsigned step,
@@ -415,9 +535,5 @@ void smartBisimpleParOnlyRotNext(const Configuration& config, std::vector<Config
 {
     std::vector<Action> actions;
     generateSmartParalyzedOnlyRotActions(config, actions, step, allowed_indices);
-    for (auto& action : actions) {
-        auto cfgOpt = executeIfValid(config, action);
-        if (cfgOpt.has_value())
-            res.push_back(cfgOpt.value());
-    }
+    executeAllIfValid(config, actions, res);
 }
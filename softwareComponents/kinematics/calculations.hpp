@@ -3,6 +3,7 @@
 #include <legacy/configuration/Configuration.h>
 #include <legacy/configuration/IO.h>
 
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <iostream>
@@ -86,12 +87,39 @@ inline double magnitude( const Vector& vector ){
                       std::pow( vector[ 2 ], 2 ) );
 }
 
-inline double arbitrary_magnitude( const arma::vec& vector ){
-    double sum = 0;
-    for( double d : vector ){
-        sum += std::pow( d, 2 );
+using vec6 = std::array< double, 6 >;
+using mat6 = std::array< vec6, 6 >;
+
+/* Solves a * x = b for a symmetric positive definite a, using the Cholesky
+ * decomposition computed in place; everything stays on the stack */
+inline vec6 solve_spd( mat6 a, vec6 b ){
+    for( int j = 0; j < 6; ++j ){
+        for( int k = 0; k < j; ++k ){
+            a[ j ][ j ] -= a[ j ][ k ] * a[ j ][ k ];
+        }
+        a[ j ][ j ] = std::sqrt( a[ j ][ j ] );
+        for( int i = j + 1; i < 6; ++i ){
+            for( int k = 0; k < j; ++k ){
+                a[ i ][ j ] -= a[ i ][ k ] * a[ j ][ k ];
+            }
+            a[ i ][ j ] /= a[ j ][ j ];
+        }
+    }
+    /* L * y = b */
+    for( int i = 0; i < 6; ++i ){
+        for( int k = 0; k < i; ++k ){
+            b[ i ] -= a[ i ][ k ] * b[ k ];
+        }
+        b[ i ] /= a[ i ][ i ];
+    }
+    /* L^T * x = y */
+    for( int i = 6; i --> 0; ){
+        for( int k = i + 1; k < 6; ++k ){
+            b[ i ] -= a[ k ][ i ] * b[ k ];
+        }
+        b[ i ] /= a[ i ][ i ];
     }
-    return std::sqrt( sum );
+    return b;
 }
 
 /* dot product */
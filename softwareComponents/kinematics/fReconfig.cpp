@@ -1,5 +1,6 @@
 #include "fReconfig.hpp"
 #include <atoms/util.hpp>
+#include <algorithm>
 
 const Edge invalidEdge = { -1, A, ZMinus, North, ZMinus, A, -1 };
 
@@ -130,31 +131,43 @@ treeConfig::treeConfig( Configuration c ){
 void treeConfig::makeTree(){
     std::deque< std::pair< ID, int > > queue;
     std::unordered_set< ID > seen;
+    std::unordered_set< ID > attached;
+    std::set< std::pair< ID, unsigned > > treeEdges;
     int depth = 0;
-    Configuration treed = config;
-    treed.clearEdges();
+
+    auto key = []( const Edge& edge ){
+        const Edge& e = edge.id1() < edge.id2() ? edge : reverse( edge );
+        return std::make_pair( e.id1(), edgeIndex( e ) );
+    };
 
     queue.emplace_back( root, depth );
     seen.insert( root );
 
     while( !queue.empty() ){
         auto [ id, depth ] = queue.front();
-        depths[ id ] = depth;
+        setDepth( id, depth );
         queue.pop_front();
         auto edges = config.getEdges( id, seen );
         for( auto edge : edges ){
             ID otherId = edge.id2();
-            if( treed.getEdges( otherId ).empty() ){
-                treed.addEdge( edge );
+            if( attached.insert( otherId ).second ){
+                treeEdges.insert( key( edge ) );
             }
             queue.emplace_back( otherId, depth + 1 );
             seen.insert( otherId );
         }
 
     }
-    treed.setFixed( root, A, identity );
-    treed.computeMatrices();
-    config = treed;
+
+    for( ID id : config.getIDs() ){
+        for( const auto& edge : config.getEdges( id ) ){
+            if( edge.id1() < edge.id2() && treeEdges.count( key( edge ) ) == 0 ){
+                reconnect( false, edge );
+            }
+        }
+    }
+    config.setFixed( root, A, identity );
+    config.computeMatrices();
 }
 
 treeConfig::treeConfig( Configuration c, ID r ) : config( c ), root( r ),
@@ -163,18 +176,148 @@ treeConfig::treeConfig( Configuration c, ID r ) : config( c ), root( r ),
     makeTree();
 }
 
-treeConfig treeConfig::saveState(){
-    treeConfig old( config, root );
-    old.depths = depths;
-    old.reconfigurationSteps = reconfigurationSteps;
-    return old;
+checkpoint treeConfig::saveState(){
+    if( marks.empty() ){
+        undoLog.clear();
+    }
+    marks.push_back( undoLog.size() );
+    return { undoLog.size(), reconfigurationSteps.size() };
 }
 
-void treeConfig::resetState( const treeConfig& old ){
-    reconfigurationSteps.resize( old.reconfigurationSteps.size() );
-    config = old.config;
-    root = old.root;
-    depths = old.depths;
+void treeConfig::resetState( const checkpoint& old ){
+    std::set< ID > touched;
+    std::vector< Edge > restored;
+    bool rootChanged = false;
+
+    while( undoLog.size() > old.undo ){
+        const undoStep step = undoLog.back();
+        undoLog.pop_back();
+        switch( step.type ){
+            case( undoType::joint ):
+                config.getModule( step.id ).setJoint( step.j, step.value );
+                touched.insert( step.id );
+                break;
+            case( undoType::connection ):
+                config.removeEdge( step.edge );
+                touched.insert( step.edge.id1() );
+                touched.insert( step.edge.id2() );
+                break;
+            case( undoType::disconnect ):
+                config.addEdge( step.edge );
+                touched.insert( step.edge.id1() );
+                touched.insert( step.edge.id2() );
+                restored.push_back( step.edge );
+                break;
+            case( undoType::depth ):
+                if( step.value < 0 ){
+                    depths.erase( step.id );
+                } else {
+                    depths[ step.id ] = static_cast< int >( step.value );
+                }
+                break;
+            case( undoType::root ):
+                root = step.id;
+                rootChanged = true;
+                break;
+        }
+    }
+    while( !marks.empty() && marks.back() >= old.undo ){
+        marks.pop_back();
+    }
+    reconfigurationSteps.resize( old.steps );
+
+    if( !rootChanged && invalidate( touched, restored ) && config.computeMatrices() ){
+        return;
+    }
+    config.setFixed( root, A, identity );
+    config.computeMatrices();
+}
+
+bool treeConfig::invalidate( const std::set< ID >& touched, const std::vector< Edge >& restored ){
+    // A zero rotation is the only way to mark a module as changed; matrices
+    // below its other side get recomputed, the entry shoe is kept
+    auto mark = [&]( ID id ){
+        return config.execute( Action( Action::Rotate( id, Gamma, 0 ) ) );
+    };
+    for( ID id : touched ){
+        if( !mark( id ) ){
+            return false;
+        }
+    }
+
+    // A module entered through a restored edge needs its entry shoe
+    // recomputed as well, mark the nearest ancestor having it below
+    // its other side
+    const auto& pred = config.getSpanningPred();
+    auto entryOf = [&]( ID id ){
+        return pred.at( id ).has_value() ? pred.at( id )->second : config.getFixedSide();
+    };
+    for( const auto& edge : restored ){
+        Edge current = edge;
+        if( pred.at( edge.id1() ) == std::make_pair( edge.id2(), edge.side1() ) ){
+            current = reverse( edge );
+        } else if( pred.at( edge.id2() ) != std::make_pair( edge.id1(), edge.side2() ) ){
+            continue;
+        }
+        while( current.side1() == entryOf( current.id1() ) ){
+            if( !pred.at( current.id1() ).has_value() ){
+                return false;
+            }
+            auto [ parent, side ] = pred.at( current.id1() ).value();
+            auto edges = config.getEdges( parent );
+            auto it = std::find_if( edges.begin(), edges.end(), [&]( const Edge& e ){
+                return e.id2() == current.id1() && e.side2() == side;
+            });
+            if( it == edges.end() ){
+                return false;
+            }
+            current = *it;
+        }
+        if( !mark( current.id1() ) ){
+            return false;
+        }
+    }
+    return true;
+}
+
+void treeConfig::reconnect( bool connect, const Edge& edge ){
+    if( !config.execute( Action( Action::Reconnect( connect, edge ) ) ) )
+        return;
+    undoStep step;
+    step.type = connect ? undoType::connection : undoType::disconnect;
+    step.edge = edge;
+    undoLog.push_back( step );
+}
+
+void treeConfig::logJoint( ID id, Joint j ){
+    undoStep step;
+    step.type = undoType::joint;
+    step.id = id;
+    step.j = j;
+    step.value = config.getModule( id ).getJoint( j );
+    undoLog.push_back( step );
+}
+
+void treeConfig::setDepth( ID id, int depth ){
+    auto it = depths.find( id );
+    if( it != depths.end() && it->second == depth )
+        return;
+    undoStep step;
+    step.type = undoType::depth;
+    step.id = id;
+    step.value = it == depths.end() ? -1 : it->second;
+    undoLog.push_back( step );
+    depths[ id ] = depth;
+}
+
+void treeConfig::setRoot( ID id ){
+    if( id == root )
+        return;
+    undoStep step;
+    step.type = undoType::root;
+    step.id = root;
+    undoLog.push_back( step );
+    root = id;
 }
 
 joints treeConfig::getFreeArm(){
@@ -216,7 +359,7 @@ joints treeConfig::initArm( ID id, ShoeId side, std::unordered_set< ID >& seen )
 
 std::vector< joints > treeConfig::getFreeArms(){
     std::vector< joints > arms;
-    root = closestMass( config );
+    setRoot( closestMass( config ) );
     makeTree();
     config.computeMatrices();
 
@@ -260,6 +403,9 @@ joint treeConfig::getConnected( ID id, ShoeId side, std::unordered_set< ID > exc
 bool treeConfig::reconfig() {
     inspector->onReconfigurationStart();
     bool result = tryConnections();
+    // Checkpoints of the successful branch are never reset
+    undoLog.clear();
+    marks.clear();
     inspector->onReconfigurationEnd();
     return result;
 }
@@ -293,7 +439,7 @@ bool treeConfig::tryConnections(){
             if( arm1 == arm2 )
                 continue;
 
-            treeConfig old = saveState();
+            checkpoint old = saveState();
             if( connect( arm1, arm2, straight == straightening::always ) ){
                 if( tryConnections() ){
                     return true;
@@ -332,7 +478,7 @@ bool treeConfig::fixConnections( std::vector< joints >& arms ){
         rootArm.emplace_back( rootEdge.side1() == A ? joint{ root, A } : joint{ root, B } );
         rootArm.emplace_back( rootEdge.side1() == A ? joint{ root, B } : joint{ root, A } );
 
-        treeConfig old = saveState();
+        checkpoint old = saveState();
         if( connect( rootArm, arms.front(), false ) ){
             return tryConnections();
         }
@@ -353,7 +499,7 @@ bool treeConfig::fixConnections( std::vector< joints >& arms ){
         }
 
 
-        treeConfig old = saveState();
+        checkpoint old = saveState();
         if( connect( rootArm, arms[ other ], false ) ){
             return true;
         }
@@ -361,7 +507,7 @@ bool treeConfig::fixConnections( std::vector< joints >& arms ){
         return false;
     };
 
-    treeConfig old = saveState();
+    checkpoint old = saveState();
     if( connectTwo( 0 ) ){
         return tryConnections();
     }
@@ -401,17 +547,18 @@ bool treeConfig::connect( joints arm1, joints arm2, bool straighten ){
         // }
     }
 
-    Configuration oldConfig = link( arm1, arm2 );
+    checkpoint old = saveState();
+    Matrix target = config.getMatrices().at( arm1.back().id ).at( arm1.back().side );
+
+    link( arm1, arm2 );
 
     if( !config.connected() ){
-        config = oldConfig;
+        resetState( old );
         waitingConnections.clear();
         waitingDisconnects.clear();
         return false;
     }
 
-    Matrix target = oldConfig.getMatrices().at( arm1.back().id ).at( arm1.back().side );
-
     bool result = fabrik( arm1, target );
 
     if( straight == straightening::onCollision ){
@@ -435,10 +582,10 @@ bool treeConfig::connect( joints arm1, joints arm2, bool straighten ){
     if( result ){
         if( newDisconnect != invalidEdge ){
             for( const auto& waiting : waitingDisconnects ){
-                config.execute( Action( Action::Reconnect( true, waiting.edge ) ) );
+                reconnect( true, waiting.edge );
             }
             waitingDisconnects.clear();
-            config.execute( Action( Action::Reconnect( false, newDisconnect ) ) );
+            reconnect( false, newDisconnect );
             waitingDisconnects.push_back( setDisconnect( newDisconnect ) );
         }
         for( auto [ id, side ] : arm1 ){
@@ -457,7 +604,7 @@ bool treeConfig::connect( joints arm1, joints arm2, bool straighten ){
         if( straighten )
             straightenArm( arm1 );
     } else {
-        config = oldConfig;
+        resetState( old );
         waitingConnections.clear();
         waitingDisconnects.clear();
     }
@@ -505,8 +652,7 @@ void treeConfig::extend( joints& arm1, joints& arm2 ){
     }
 }
 
-Configuration treeConfig::link( joints& arm1, joints& arm2 ){
-    Configuration oldConfig = config;
+void treeConfig::link( joints& arm1, joints& arm2 ){
     Edge newEdge = {
         arm1.back().id,
         arm1.back().side,
@@ -523,7 +669,7 @@ Configuration treeConfig::link( joints& arm1, joints& arm2 ){
     while( i != -1 ){
         arm1.push_back( arm2.back() );
         if( arm1.back().id != arm1[ arm1.size() - 2 ].id ){
-            depths[ arm1.back().id ] = depths[ arm1[ arm1.size() - 2 ].id ] + 1;
+            setDepth( arm1.back().id, depths[ arm1[ arm1.size() - 2 ].id ] + 1 );
         }
         if( i != 0 && arm2[ i ].id != arm2[ i - 1 ].id ){
             Edge current = edgeBetween( arm2[ i ], arm2[ i - 1 ] );
@@ -537,15 +683,14 @@ Configuration treeConfig::link( joints& arm1, joints& arm2 ){
         --i;
     }
 
-    config.execute( Action( Action::Reconnect( false, toDisconnect ) ) );
+    reconnect( false, toDisconnect );
     waitingDisconnects.emplace_back( setDisconnect( toDisconnect ) );
 
-    config.execute( Action( Action::Reconnect( true, newEdge ) ) );
+    reconnect( true, newEdge );
     waitingConnections.emplace_back( setConnection( newEdge ) );
 
     config.setFixed( root, A, identity );
     config.computeMatrices();
-    return oldConfig;
 }
 
 bool treeConfig::fabrik( const joints& arm, const Matrix& target ){
@@ -790,6 +935,11 @@ void treeConfig::rotateJoints( const joints& arm, size_t currentJoint, Configura
         az += 360;
     }
 
+    if( &currentConfig == &config ){
+        logJoint( arm[ currentJoint ].id, arm[ currentJoint ].side == A ? Alpha : Beta );
+        logJoint( arm[ currentJoint ].id, Gamma );
+    }
+
     if( arm[ currentJoint ].side == A ){
         double cur = currentConfig.getModule( arm[ currentJoint ].id ).getJoint( Alpha );
         pol = std::clamp( pol , -90.0 - cur, 90.0 - cur );
@@ -820,6 +970,8 @@ Edge treeConfig::edgeBetween( const joint& j1, const joint& j2 ){
 void treeConfig::straightenArm( const joints& arm ){
     for( auto [ id, side ] : arm ){
         Joint j = side == A ? Alpha : Beta;
+        logJoint( id, j );
+        logJoint( id, Gamma );
         config.getModule( id ).setJoint( j, 0 );
         config.getModule( id ).setJoint( Gamma, 0 );
         reconfigurationSteps.emplace_back( setRotation( id, j, 0 ) );
@@ -46,6 +46,26 @@ struct reconfigurationStep {
 
 };
 
+/* Undo log of the reconfiguration machine, replayed backwards on backtrack */
+enum class undoType {
+    joint, connection, disconnect, depth, root
+};
+
+struct undoStep {
+    undoType type = undoType::joint;
+    ID id = 0;
+    Joint j = Alpha;
+    double value = 0.0; // Old joint value or depth, -1 for no depth
+
+    Edge edge = { 0, A, ZMinus, 0, ZMinus, A, 0 };
+};
+
+/* Position in the undo log to return to */
+struct checkpoint {
+    size_t undo = 0;
+    size_t steps = 0;
+};
+
 reconfigurationStep setRotation( ID id, Joint j, double angle );
 reconfigurationStep setConnection( Edge toConnect );
 reconfigurationStep setDisconnect( Edge toDisconnect );
@@ -83,9 +103,27 @@ struct treeConfig {
     /* Iteration limit for fabrik */
     size_t max_iterations = 1000;
 
-    /* Save and reset inner state on failure */
-    treeConfig saveState();
-    void resetState( const treeConfig& old );
+    /* Save and reset inner state on failure; every change of config, depths
+       and root goes through the undo log. A reset replays the log back and
+       recomputes only the matrices below the touched modules; it falls back
+       to a full recomputation when the root changed, the configuration was
+       disconnected or an edge at the fixed shoe of the root was restored. The log only holds
+       entries since the oldest checkpoint still open, `marks` are positions
+       of the open checkpoints */
+    std::vector< undoStep > undoLog;
+    std::vector< size_t > marks;
+    checkpoint saveState();
+    void resetState( const checkpoint& old );
+
+    /* Logged changes of the inner state */
+    void reconnect( bool connect, const Edge& edge );
+    void logJoint( ID id, Joint j );
+    void setDepth( ID id, int depth );
+    void setRoot( ID id );
+
+    /* Mark matrices changed by the touched modules and restored edges for
+       recomputation; false if only a full recomputation helps */
+    bool invalidate( const std::set< ID >& touched, const std::vector< Edge >& restored );
 
     /* Flags for reconfiguration */
     collisionStrategy collisions;
@@ -129,8 +167,8 @@ struct treeConfig {
     /* Connect arms by linking them and using FABRIK */
     bool connect( joints arm1, joints arm2, bool straighten = true );
 
-    /* Link the two arms, return a copy of the old configuration in case of failure */
-    Configuration link( joints& arm1, joints& arm2 );
+    /* Link the two arms */
+    void link( joints& arm1, joints& arm2 );
 
     /* Fabrik itself, takes arm of the configuration and tries to reach target */
     bool fabrik( const joints& arm, const Matrix& target );
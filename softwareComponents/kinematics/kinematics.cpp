@@ -1,4 +1,9 @@
 #include "kinematics.hpp"
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
 
 using namespace rofi::configuration::matrices;
 
@@ -52,6 +57,123 @@ kinematic_rofibot::kinematic_rofibot( std::string file_name, bool fixed, options
     *this = kinematic_rofibot( new_config, fixed, opt );
 }
 
+/** Strategy selection **/
+
+bool kinematic_rofibot::solve( const target& t, strategy s, int arm )
+{
+    auto [ goal, x_frame, y_frame, z_frame ] = t;
+    if( s == strategy::ccd ){
+        return ccd( goal, x_frame, y_frame, z_frame, arms[ arm ], 1000 );
+    }
+    if( s == strategy::fabrik ){
+        return fabrik( goal, y_frame, z_frame, arms[ arm ], 100, arms[ arm ].size() );
+    }
+    if( s == strategy::pseudoinverse ){
+        return pseudoinverse( goal, x_frame, z_frame, arms[ arm ] );
+    }
+    return false;
+}
+
+bool kinematic_rofibot::solve( const target& t, const multistart& ms, int arm )
+{
+    struct run {
+        strategy s;
+        int start;
+    };
+    std::vector< run > runs;
+    for( int start = 0; start < ms.starts; ++start ){
+        for( strategy s : ms.strategies ){
+            runs.push_back( { s, start } );
+        }
+    }
+    started_runs = 0;
+    if( runs.empty() ){
+        return false;
+    }
+    /* Throws here rather than on a worker thread if the arm is broken */
+    arm_links( arms[ arm ] );
+
+    /* Distance of a solution from the current configuration */
+    auto movement = [&]( const Configuration& c ){
+        double result = 0;
+        for( int id : arms[ arm ] ){
+            for( Joint j : { Alpha, Beta, Gamma } ){
+                result += std::fabs( c.getModule( id ).getJoint( j ) - config.getModule( id ).getJoint( j ) );
+            }
+        }
+        return result;
+    };
+
+    std::atomic< bool > stop = false;
+    std::atomic< size_t > next = 0;
+    std::mutex mutex;
+    std::optional< Configuration > solution;
+    double solution_movement = 0;
+
+    auto worker = [&](){
+        while( !stop ){
+            size_t i = next++;
+            if( i >= runs.size() ){
+                break;
+            }
+            kinematic_rofibot bot = *this;
+            bot.opt.verbose = false;
+            bot.opt.animate = false;
+            bot.cancel = &stop;
+
+            if( runs[ i ].start != 0 ){
+                std::mt19937 random( runs[ i ].start );
+                std::uniform_real_distribution< double > offset( -ms.perturbation, ms.perturbation );
+                const chain& modules = arms[ arm ];
+                const std::vector< Edge > links = bot.arm_links( modules );
+                arm_joints joints = bot.read_joints( modules, links );
+                for( auto& module : joints ){
+                    for( size_t j = 0; j < module.size(); ++j ){
+                        double value = module[ j ] + offset( random );
+                        module[ j ] = j == 2 ? value : std::clamp( value, -90.0, 90.0 );
+                    }
+                }
+                /* Through rotations, so that the validity check sees the new matrices */
+                bot.write_joints( modules, links, joints );
+                if( !bot.config.isValid() ){
+                    continue;
+                }
+            }
+
+            if( !bot.solve( t, runs[ i ].s, arm ) || stop ){
+                continue;
+            }
+
+            std::lock_guard< std::mutex > lock( mutex );
+            double current = movement( bot.config );
+            if( !solution || current < solution_movement ){
+                solution = bot.config;
+                solution_movement = current;
+            }
+            if( !ms.best ){
+                stop = true;
+            }
+        }
+    };
+
+    unsigned jobs = ms.jobs == 0 ? std::max( 1u, std::thread::hardware_concurrency() ) : ms.jobs;
+    std::vector< std::thread > threads;
+    for( unsigned i = 1; i < std::min< size_t >( jobs, runs.size() ); ++i ){
+        threads.emplace_back( worker );
+    }
+    worker();
+    for( auto& thread : threads ){
+        thread.join();
+    }
+    started_runs = std::min( next.load(), runs.size() );
+
+    if( !solution ){
+        return false;
+    }
+    reset( *solution );
+    return true;
+}
+
 /** The three algorithms **/
 
 bool kinematic_rofibot::ccd( const Vector& goal, const Vector& x_frame, const Vector& y_frame,
@@ -101,10 +223,10 @@ bool kinematic_rofibot::ccd( const Vector& goal, const Vector& x_frame, const Ve
                                                               ( y_frame * current_y ) +
                                                               ( z_frame * current_z ) );
 
-                k3 = axis * ( wp * cross_product( local_end, local_goal )  +
-                              wa * ( cross_product( current_x, x_frame ) +
-                                     cross_product( current_y, y_frame ) +
-                                     cross_product( current_z, z_frame ) ) );
+                k3 = axis * Vector( wp * cross_product( local_end, local_goal )  +
+                                    wa * ( cross_product( current_x, x_frame ) +
+                                           cross_product( current_y, y_frame ) +
+                                           cross_product( current_z, z_frame ) ) );
 
                 double candidate = std::atan( k3 / ( k2 - k1 ) );
 
@@ -152,7 +274,7 @@ bool kinematic_rofibot::ccd( const Vector& goal, const Vector& x_frame, const Ve
         if( opt.animate )
             std::cout << IO::toString( config );
 
-        if( ++iterations == max_iterations ){
+        if( ++iterations == max_iterations || cancelled() ){
             if( opt.verbose ){
                 std::cerr << IO::toString( get_matrix( arm.back(), 1 ) );
             }
@@ -200,7 +322,7 @@ bool kinematic_rofibot::fabrik( const Vector& goal, const Vector& y_frame, const
     auto respects_limit = [&]() {
         Vector normal = cross_product( z_frame, y_frame );
         Vector projected = project( normal, positions.back(), positions[ positions.size() - 2 ] );
-        return equals( projected, positions[ positions.size() - 2 ]);
+        return rofi::configuration::matrices::equals( projected, positions[ positions.size() - 2 ]);
     };
 
     int iterations = 0;
@@ -303,7 +425,7 @@ bool kinematic_rofibot::fabrik( const Vector& goal, const Vector& y_frame, const
             std::cout << IO::toString( config );
         }
 
-        if( ++iterations == max_iterations ){
+        if( ++iterations == max_iterations || cancelled() ){
             if( opt.verbose ){
                 std::cerr << "E position:\n" << positions.back();
             }
@@ -401,71 +523,96 @@ bool kinematic_rofibot::pseudoinverse( const Vector& goal, const Vector& x_frame
 {
     config.computeMatrices();
 
-    Vector global_x = end_effector( arm ) + x_frame;
-    Vector global_z = end_effector( arm ) + z_frame;
+    /* The iterations work on a copy of the joints and recompute the frames
+     * in a single pass; config is only updated once at the end */
+    const std::vector< Edge > links = arm_links( arm );
+    arm_joints joints = read_joints( arm, links );
+    auto write_joints = [&](){
+        this->write_joints( arm, links, joints );
+    };
+
+    const Matrix base = get_matrix( arm.front(), entry_shoe( links, 0 ) );
+    frames f;
+    std::vector< vec6 > j;
+    forward( base, links, joints, f );
 
-    double rz = rotz( get_local( arm.back(), 1, global_x ), { -1, 0, 0, 1 } );
-    double rx = rotx( get_local( arm.back(), 1, global_z ), { 0, 0, -1, 1 } );
-    double ry = roty( get_local( arm.back(), 1, global_x ), { -1, 0, 0, 1 } );
+    /* The goal frames are only used as directions; reach passes them as points */
+    Vector goal_x = x_frame / magnitude( x_frame );
+    Vector goal_z = z_frame / magnitude( z_frame );
+    goal_x[ 3 ] = goal_z[ 3 ] = 0;
 
     int iterations = 0;
-    while( distance( goal, end_effector( arm ) ) > 0.01 ||
-            std::fabs( rz ) + std::fabs( rx ) + std::fabs( ry ) > 0.1 ){
-        if( opt.animate )
-            std::cout << IO::toString( config );
+    while( true ){
+        Vector pos = f.back()[ 1 ] * Vector( { 0, 0, 0, 1 } );
+        Matrix to_local = inverse( f.back()[ 1 ] );
 
-        Vector pos = end_effector( arm );
+        double rz = rotz( to_local * ( pos + goal_x ), { -1, 0, 0, 1 } );
+        double rx = rotx( to_local * ( pos + goal_z ), { 0, 0, -1, 1 } );
+        double ry = roty( to_local * ( pos + goal_x ), { -1, 0, 0, 1 } );
 
-        global_x = end_effector( arm ) + x_frame;
-        global_z = end_effector( arm ) + z_frame;
+        if( distance( goal, pos ) <= error && std::fabs( rz ) + std::fabs( rx ) + std::fabs( ry ) <= 0.1 )
+            break;
 
-        rz = rotz( get_local( arm.back(), 1, global_x ), { -1, 0, 0, 1 } );
-        rx = rotx( get_local( arm.back(), 1, global_z ), { 0, 0, -1, 1 } );
-        ry = roty( get_local( arm.back(), 1, global_x ), { -1, 0, 0, 1 } );
-    
-        arma::mat j = jacobian( arm );
-
-        arma::vec diff = { goal[ 0 ] - pos[ 0 ], goal[ 1 ] - pos[ 1 ], goal[ 2 ] - pos[ 2 ], rx, ry, rz };
-        arma::mat pseudo_inv = arma::trans( j ) * ( arma::inv( j * arma::trans( j ) ) );
-
-        arma::mat I( 6, 6, arma::fill::eye );
-        double error;
-        /* Ad hoc constant; higher precision can reduce the number of iterations
-         * but increase computation per iteration */
-        double prec = 1e-10;
-        do {
-            error = arbitrary_magnitude( ( I - j * pseudo_inv ) * diff );
-            if( error > prec ){
-                diff /= 2.0;
+        if( iterations++ == max_iterations || cancelled() ){
+            write_joints();
+            if( opt.verbose ){
+                std::cerr << IO::toString( get_matrix( arm.back(), 1 ) );
             }
-        } while( error > prec );
+            return false;
+        }
 
-        arma::vec velocities = pseudo_inv * diff;
+        if( opt.animate ){
+            write_joints();
+            std::cout << IO::toString( config );
+        }
 
-        for( int i = 0; i < velocities.size(); ++i ){
-            Joint joint;
-            if( i % 3 == 0 ){
-                joint = Alpha;
-            }
-            if( i % 3 == 1 )
-                joint = Gamma;
-            if( i % 3 == 2 ){
-                joint = Beta;
-                velocities[ i ] = -velocities[ i ];
+        jacobian( f, links, joints, j );
+
+        /* rx, ry and rz are measured in the frame of the end, the angular rows
+         * of the Jacobian are global; the global rotation turning the current
+         * X and Z axes of the end towards the goal ones is used instead */
+        Vector current_x = f.back()[ 1 ] * Vector( { -1, 0, 0, 0 } );
+        Vector current_z = f.back()[ 1 ] * Vector( { 0, 0, -1, 0 } );
+        Vector omega = ( cross_product( current_x, goal_x ) + cross_product( current_z, goal_z ) ) / 2.0;
+
+        vec6 diff = { goal[ 0 ] - pos[ 0 ], goal[ 1 ] - pos[ 1 ], goal[ 2 ] - pos[ 2 ],
+                      omega[ 0 ], omega[ 1 ], omega[ 2 ] };
+
+        /* Damped least squares, velocities = J^T * ( J * J^T + damping^2 * I )^-1 * diff;
+         * J * J^T is 6x6 regardless of the length of the arm */
+        mat6 jjt = {};
+        for( const auto& column : j ){
+            for( int r = 0; r < 6; ++r ){
+                for( int c = 0; c < 6; ++c ){
+                    jjt[ r ][ c ] += column[ r ] * column[ c ];
+                }
             }
-
-
-            config.execute( Action( Action::Rotate( arm[ i / 3], joint, velocities[ i ] ) ) );
-            config.computeMatrices();
         }
+        for( int r = 0; r < 6; ++r ){
+            jjt[ r ][ r ] += damping * damping;
+        }
+        vec6 y = solve_spd( jjt, diff );
 
-        if( ++iterations == max_iterations ){
-            if( opt.verbose ){
-                std::cerr << IO::toString( get_matrix( arm.back(), 1 ) );
+        for( size_t i = 0; i < j.size(); ++i ){
+            double velocity = 0;
+            for( int r = 0; r < 6; ++r ){
+                velocity += j[ i ][ r ] * y[ r ];
             }
-            return false;
+            velocity = to_deg( velocity );
+
+            auto& [ entry, exit, gamma ] = joints[ i / 3 ];
+            if( i % 3 == 0 )
+                entry = std::clamp( entry + velocity, -90.0, 90.0 );
+            if( i % 3 == 1 )
+                gamma += velocity;
+            if( i % 3 == 2 )
+                exit = std::clamp( exit - velocity, -90.0, 90.0 );
         }
+
+        forward( base, links, joints, f );
     }
+
+    write_joints();
     if( opt.verbose ){
         std::cerr << IO::toString( get_matrix( arm.back(), 1 ) );
     }
@@ -526,35 +673,134 @@ bool kinematic_rofibot::rotate_if_valid( int module, Joint joint, double angle )
 }
 
 
-arma::mat kinematic_rofibot::jacobian( const chain& arm ){
-    int columns = arm.size() * 3;
-    arma::mat result( 6, columns );
+std::vector< Edge > kinematic_rofibot::arm_links( const chain& arm )
+{
+    std::vector< Edge > links;
+    for( size_t i = 0; i + 1 < arm.size(); ++i ){
+        for( const auto& edge : config.getEdges( arm[ i ] ) ){
+            if( edge.id2() == arm[ i + 1 ] ){
+                links.push_back( edge );
+                break;
+            }
+        }
+    }
+    if( links.size() + 1 != arm.size() ){
+        throw std::logic_error( "Consecutive modules of an arm are not connected" );
+    }
+    return links;
+}
 
-    arma::vec3 z1( { 0, 0, 1 } );
-    arma::vec3 x1( { 1, 0, 0 } );
+ShoeId kinematic_rofibot::entry_shoe( const std::vector< Edge >& links, size_t i )
+{
+    if( i > 0 ){
+        return links[ i - 1 ].side2();
+    }
+    if( links.empty() ){
+        return A;
+    }
+    return links.front().side1() == A ? B : A;
+}
 
-    for( int i = 0; i < columns; ++i ){
-        arma::vec3 rotation;
-        if( i % 3 == 0 )
-            rotation = get_rotation( get_matrix( arm[ i / 3 ], 0 ) ) * x1;
-        else if( i % 3 == 1 )
-            rotation = get_rotation( get_matrix( arm[ i / 3 ], 0 ) ) * z1;
-        else
-            rotation = get_rotation( get_matrix( arm[ i / 3 ], 1 ) ) * x1;
+arm_joints kinematic_rofibot::read_joints( const chain& arm, const std::vector< Edge >& links )
+{
+    arm_joints joints;
+    for( size_t i = 0; i < arm.size(); ++i ){
+        const auto& module = config.getModule( arm[ i ] );
+        bool reversed = entry_shoe( links, i ) == B;
+        joints.push_back( { module.getJoint( reversed ? Beta : Alpha ),
+                            module.getJoint( reversed ? Alpha : Beta ),
+                            module.getJoint( Gamma ) } );
+    }
+    return joints;
+}
 
-        arma::vec3 current = arma::cross( rotation,
-            get_translation( get_matrix( arm.back(), 1 ) ) - 
-            get_translation( get_matrix( arm[ i / 3 ], i % 3 == 2 ) )
-            );
+void kinematic_rofibot::write_joints( const chain& arm, const std::vector< Edge >& links, const arm_joints& joints )
+{
+    for( size_t i = 0; i < arm.size(); ++i ){
+        const auto& module = config.getModule( arm[ i ] );
+        bool reversed = entry_shoe( links, i ) == B;
+        std::array< Joint, 3 > order = { reversed ? Beta : Alpha, reversed ? Alpha : Beta, Gamma };
         for( int j = 0; j < 3; ++j ){
-            result( j, i ) = current[ j ];
+            double value = joints[ i ][ j ];
+            if( order[ j ] == Gamma ){
+                /* Module only wraps gamma once */
+                value = std::remainder( value, 360.0 );
+                value = value == -180.0 ? 180.0 : value;
+            }
+            double delta = value - module.getJoint( order[ j ] );
+            if( delta != 0 ){
+                config.execute( Action( Action::Rotate( arm[ i ], order[ j ], delta ) ) );
+            }
         }
-        
-        for( int j = 0; j < 3; ++j ){
-            result( j + 3, i ) = rotation[ j ];
+    }
+    config.computeMatrices();
+}
+
+frames kinematic_rofibot::arm_frames( int arm )
+{
+    config.computeMatrices();
+    const chain& modules = arms[ arm ];
+    const std::vector< Edge > links = arm_links( modules );
+    frames f;
+    forward( get_matrix( modules.front(), entry_shoe( links, 0 ) ), links, read_joints( modules, links ), f );
+    for( size_t i = 0; i < f.size(); ++i ){
+        if( entry_shoe( links, i ) == B ){
+            std::swap( f[ i ][ 0 ], f[ i ][ 1 ] );
+        }
+    }
+    return f;
+}
+
+void kinematic_rofibot::forward( const Matrix& base, const std::vector< Edge >& links,
+                                 const arm_joints& joints, frames& result )
+{
+    result.resize( joints.size() );
+    for( size_t i = 0; i < joints.size(); ++i ){
+        auto [ entry, exit, gamma ] = joints[ i ];
+        if( i == 0 ){
+            result[ i ][ 0 ] = base;
+        } else {
+            /* The previous module can be left through the shoe it was entered by */
+            const Edge& link = links[ i - 1 ];
+            const Matrix& from = result[ i - 1 ][ link.side1() == entry_shoe( links, i - 1 ) ? 0 : 1 ];
+            result[ i ][ 0 ] = from * transformConnection( link.dock1(), link.ori(), link.dock2() );
         }
+        result[ i ][ 1 ] = result[ i ][ 0 ] * transformJoint( to_rad( entry ), to_rad( exit ), to_rad( gamma ) );
+    }
+}
+
+void kinematic_rofibot::jacobian( const frames& f, const std::vector< Edge >& links,
+                                  const arm_joints& joints, std::vector< vec6 >& result )
+{
+    result.resize( f.size() * 3 );
+
+    Vector end = f.back()[ 1 ] * Vector( { 0, 0, 0, 1 } );
+
+    for( size_t i = 0; i < result.size(); ++i ){
+        size_t module = i / 3;
+        if( module < links.size() && links[ module ].side1() == entry_shoe( links, module ) ){
+            /* The arm does not pass through the joints of this module */
+            result[ i ] = {};
+            continue;
+        }
+        const auto& [ a, b ] = f[ module ];
+        Vector axis;
+        Vector origin;
+        if( i % 3 == 0 ){
+            axis = a * Vector( { 1, 0, 0, 0 } );
+            origin = a * Vector( { 0, 0, 0, 1 } );
+        } else if( i % 3 == 1 ){
+            /* Gamma turns around Z after the rotation of the entry joint */
+            axis = a * rotate( to_rad( joints[ module ][ 0 ] ), X ) * Vector( { 0, 0, 1, 0 } );
+            origin = a * Vector( { 0, 0, 0, 1 } );
+        } else {
+            axis = b * Vector( { 1, 0, 0, 0 } );
+            origin = b * Vector( { 0, 0, 0, 1 } );
+        }
+
+        Vector linear = cross_product( axis, end - origin );
+        result[ i ] = { linear[ 0 ], linear[ 1 ], linear[ 2 ], axis[ 0 ], axis[ 1 ], axis[ 2 ] };
     }
-    return result;
 }
 
 /** Connect methods **/
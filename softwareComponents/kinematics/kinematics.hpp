@@ -1,4 +1,5 @@
 #include "calculations.hpp"
+#include <atomic>
 #include <deque>
 #include <cassert>
 #include <math.h>
@@ -9,8 +10,19 @@ namespace {
 using chain = std::deque< int >;
 using target = std::tuple< Vector, Vector, Vector, Vector >;
 
+/* Frames of the entry and the exit shoe of every module along an arm */
+using frames = std::vector< std::array< Matrix, 2 > >;
+
+/* Joints of every module along an arm in degrees: the one at the entry
+ * shoe, the one at the exit shoe and gamma; i.e. alpha, beta and gamma
+ * for a module entered through shoe A */
+using arm_joints = std::vector< std::array< double, 3 > >;
+
 constexpr double error = 0.01;
 
+/* Damping of the least squares step in the pseudoinverse method */
+constexpr double damping = 0.1;
+
 enum class strategy { ccd, fabrik, pseudoinverse };
 
 struct options {
@@ -19,6 +31,20 @@ struct options {
     bool random = false;
 };
 
+/* Solve from several starting configurations and with several strategies in
+ * parallel; start 0 is the current configuration, the others perturb every
+ * joint of the arm by up to `perturbation` degrees */
+struct multistart {
+    int starts = 1;
+    std::vector< strategy > strategies = { strategy::fabrik };
+    double perturbation = 30.0;
+    /* Number of threads, 0 for all cores */
+    unsigned jobs = 0;
+    /* Wait for all runs and take the solution closest to the current
+     * configuration, instead of the first one found */
+    bool best = false;
+};
+
 class kinematic_rofibot {
 
     Configuration config;
@@ -32,6 +58,12 @@ class kinematic_rofibot {
 
     options opt;
 
+    /* Set when a parallel run should stop; checked by all algorithms */
+    const std::atomic< bool >* cancel = nullptr;
+
+    /* Number of runs started by the last multistart solve */
+    size_t started_runs = 0;
+
   public:
 
     kinematic_rofibot( Configuration new_config, bool fixed = false, options opt = {} );
@@ -39,54 +71,27 @@ class kinematic_rofibot {
     kinematic_rofibot( std::string file_name, bool fixed = false, options opt = {} );
 
     bool reach_random( strategy s = strategy::fabrik, int arm = 0 ){
-        auto [ goal, x_frame, y_frame, z_frame ] = random_target( arms[ arm ] );
-        
-        if( s == strategy::ccd ){
-            return ccd( goal, x_frame, y_frame, z_frame, arms[ arm ], 1000 );
-        }
-        if( s == strategy::fabrik ){
-            return fabrik( goal, y_frame, z_frame, arms[ arm ], 100, arms[ arm ].size() );
-        }
-        if( s == strategy::pseudoinverse ){
-
-            return pseudoinverse( goal, x_frame, z_frame, arms[ arm ] );
-        }
+        return solve( random_target( arms[ arm ] ), s, arm );
+    }
 
-        return false;
+    bool reach_random( const multistart& ms, int arm = 0 ){
+        return solve( random_target( arms[ arm ] ), ms, arm );
     }
 
     /* Reach a position with the given end-effector rotation */
     bool reach( Vector goal, std::vector< double > rotation = { 0, 0, 0 }, strategy s = strategy::fabrik, int arm = 0 ){
-        int max_length = arms[ arm ].size() * 2 - 1;
-        Vector y_frame = rotate( to_rad( rotation[ 0 ] ), X ) *
-                            rotate( to_rad( rotation[ 1 ] ), Y ) *
-                            rotate( to_rad( rotation[ 2 ] ), Z ) *
-                            Vector( { 0, 1, 0, 1 } );
-        Vector z_frame = rotate( to_rad( rotation[ 0 ] ), X ) *
-                            rotate( to_rad( rotation[ 1 ] ), Y ) *
-                            rotate( to_rad( rotation[ 2 ] ), Z ) *
-                            Vector( { 0, 0, 1, 1 } );
-        Vector x_frame = rotate( to_rad( rotation[ 0 ] ), X ) *
-                            rotate( to_rad( rotation[ 1 ] ), Y ) *
-                            rotate( to_rad( rotation[ 2 ] ), Z ) *
-                            Vector( { 1, 0, 0, 1 } );
-
-        if( distance( get_global( arms[ arm ].front(), 0 ), goal ) > max_length ){
+        if( !reachable( goal, arm ) ){
             return false;
         }
-        if( s == strategy::ccd ){
-            return ccd( goal, x_frame, y_frame, z_frame, arms[ arm ], 1000 );
-        }
-        if( s == strategy::fabrik ){
-            return fabrik( goal, y_frame, z_frame, arms[ arm ], 100, arms[ arm ].size() );
-        }
-        if( s == strategy::pseudoinverse ){
+        return solve( make_target( goal, rotation ), s, arm );
+    };
 
-            return pseudoinverse( goal, x_frame, z_frame, arms[ arm ] );
+    bool reach( Vector goal, std::vector< double > rotation, const multistart& ms, int arm = 0 ){
+        if( !reachable( goal, arm ) ){
+            return false;
         }
-
-        return false;
-    };
+        return solve( make_target( goal, rotation ), ms, arm );
+    }
 
     /* Move the selected arms so that they can connect */
     bool connect( strategy s, int a = 0, int b = 1 ){
@@ -117,6 +122,18 @@ class kinematic_rofibot {
         return config;
     };
 
+    inline size_t get_started_runs() const {
+        return started_runs;
+    }
+
+    const inline std::vector< chain >& get_arms() const {
+        return arms;
+    }
+
+    /* Frames of shoes A and B of every module of an arm, computed by the
+     * same forward pass as the pseudoinverse method uses */
+    frames arm_frames( int arm );
+
     /* Reset to a different configuration */
     inline void reset( const Configuration& reset ){
         config = reset;
@@ -125,6 +142,29 @@ class kinematic_rofibot {
 
   private:
 
+    /* Target position and frames of the end-effector for the given rotation */
+    target make_target( const Vector& goal, const std::vector< double >& rotation ){
+        Matrix r = rotate( to_rad( rotation[ 0 ] ), X ) *
+                   rotate( to_rad( rotation[ 1 ] ), Y ) *
+                   rotate( to_rad( rotation[ 2 ] ), Z );
+        return { goal, r * Vector( { 1, 0, 0, 1 } ), r * Vector( { 0, 1, 0, 1 } ), r * Vector( { 0, 0, 1, 1 } ) };
+    }
+
+    bool reachable( const Vector& goal, int arm ){
+        int max_length = arms[ arm ].size() * 2 - 1;
+        return distance( get_global( arms[ arm ].front(), 0 ), goal ) <= max_length;
+    }
+
+    /* Run a single strategy from the current configuration */
+    bool solve( const target& t, strategy s, int arm );
+
+    /* Run all strategies from all starts in parallel, keep the chosen solution */
+    bool solve( const target& t, const multistart& ms, int arm );
+
+    inline bool cancelled() const {
+        return cancel && cancel->load( std::memory_order_relaxed );
+    }
+
     /** Classic IK algorithm, Cyclic Coordinate Descent **/
     bool ccd( const Vector& goal, const Vector& x_frame, const Vector& y_frame,
               const Vector& z_frame, const chain& arm, int max_iterations = 100 );
@@ -156,7 +196,28 @@ class kinematic_rofibot {
 
     bool connect_pseudoinverse( int a, int b, int max_iterations = 100 );
 
-    arma::mat jacobian( const chain& arm );
+    /* Edges between consecutive modules of an arm, directed along it;
+     * throws std::logic_error if two consecutive modules are not connected */
+    std::vector< Edge > arm_links( const chain& arm );
+
+    /* Shoe through which the i-th module of an arm is entered */
+    static ShoeId entry_shoe( const std::vector< Edge >& links, size_t i );
+
+    arm_joints read_joints( const chain& arm, const std::vector< Edge >& links );
+
+    /* Set the joints through rotations, so that the matrices of the arm
+     * get recomputed */
+    void write_joints( const chain& arm, const std::vector< Edge >& links, const arm_joints& joints );
+
+    /* Frames of the whole arm in one forward pass from the entry shoe of its
+     * first module, `links` are the edges between consecutive modules */
+    void forward( const Matrix& base, const std::vector< Edge >& links,
+                  const arm_joints& joints, frames& result );
+
+    /* Analytic Jacobian with columns entry joint, gamma, exit joint of every
+     * module; rows are the linear and then the angular velocity of the end */
+    void jacobian( const frames& f, const std::vector< Edge >& links,
+                   const arm_joints& joints, std::vector< vec6 >& result );
 
     /* Generate a random configuration, and take its end-effector as target */
     target random_target( const chain& arm );
@@ -0,0 +1,181 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <sstream>
+
+#include "fReconfig.hpp"
+
+namespace {
+
+const std::string fiveModules =
+    "C\n"
+    "M 22 90 -90 180\n"
+    "M 8 90 -90 0\n"
+    "M 1 0 -90 90\n"
+    "M 7 -90 0 90\n"
+    "M 21 90 -90 180\n"
+    "E 1 A -X W -X B 8\n"
+    "E 1 A -Z E +X B 21\n"
+    "E 1 B +X E +X B 22\n"
+    "E 7 A +X N -Z B 21\n";
+
+/* A chain 1 - 12 with module 20 hanging from the same shoe of module 3
+   as the rest of the chain */
+std::string chainWithBranch(){
+    std::string text = "C\n";
+    for( int id = 1; id <= 12; ++id ){
+        text += "M " + std::to_string( id ) + " 0 0 0\n";
+    }
+    text += "M 20 0 0 0\n";
+    for( int id = 1; id < 12; ++id ){
+        text += "E " + std::to_string( id ) + " B -Z N -Z A " + std::to_string( id + 1 ) + "\n";
+    }
+    text += "E 3 B -X N -Z A 20\n";
+    return text;
+}
+
+Configuration load( const std::string& text ){
+    std::istringstream input( text );
+    Configuration config;
+    IO::readConfiguration( input, config );
+    config.computeMatrices();
+    return config;
+}
+
+struct snapshot {
+    Configuration config;
+    ID root;
+    std::map< ID, int > depths;
+    size_t steps;
+};
+
+snapshot takeSnapshot( treeConfig& t ){
+    t.config.computeMatrices();
+    return { t.config, t.root, t.depths, t.reconfigurationSteps.size() };
+}
+
+void requireSame( const Configuration& actual, const Configuration& expected ){
+    for( ID id : expected.getIDs() ){
+        for( Joint j : { Alpha, Beta, Gamma } ){
+            CHECK( actual.getModule( id ).getJoint( j ) == expected.getModule( id ).getJoint( j ) );
+        }
+        CHECK( actual.getEdges( id ) == expected.getEdges( id ) );
+        for( ShoeId side : { A, B } ){
+            CHECK( rofi::configuration::matrices::equals( actual.getMatrices().at( id )[ side ], expected.getMatrices().at( id )[ side ] ) );
+        }
+    }
+}
+
+void requireRestored( treeConfig& t, const snapshot& s ){
+    CHECK( t.root == s.root );
+    CHECK( t.depths == s.depths );
+    CHECK( t.reconfigurationSteps.size() == s.steps );
+
+    t.config.computeMatrices();
+    requireSame( t.config, s.config );
+
+    // The partial recomputation agrees with a full one
+    Configuration fresh = t.config;
+    fresh.setFixed( t.root, A, identity );
+    fresh.computeMatrices();
+    requireSame( t.config, fresh );
+}
+
+} // namespace
+
+TEST_CASE( "Reset restores the state before a connection" ){
+    treeConfig t( load( fiveModules ) );
+    auto before = takeSnapshot( t );
+
+    checkpoint old = t.saveState();
+    auto arms = t.getFreeArms();
+    REQUIRE( arms.size() >= 2 );
+    t.connect( arms[ 0 ], arms[ 1 ] );
+    t.resetState( old );
+
+    requireRestored( t, before );
+    CHECK( t.undoLog.size() == old.undo );
+    CHECK( t.marks.empty() );
+}
+
+TEST_CASE( "Nested resets restore every level" ){
+    treeConfig t( load( chainWithBranch() ), 7 );
+    std::mt19937 random( 42 );
+    std::vector< ID > ids = t.config.getIDs();
+
+    auto mutate = [&](){
+        for( int i = 0; i < 10; ++i ){
+            ID id = ids[ random() % ids.size() ];
+            if( random() % 3 == 0 ){
+                auto edges = t.config.getEdges( id );
+                if( !edges.empty() ){
+                    Edge edge = edges[ random() % edges.size() ];
+                    t.reconnect( false, edge );
+                    if( random() % 2 == 0 ){
+                        t.reconnect( true, edge );
+                    }
+                }
+            } else {
+                Joint j = std::array{ Alpha, Beta, Gamma }[ random() % 3 ];
+                t.logJoint( id, j );
+                t.logJoint( id, Gamma );
+                t.config.execute( Action( Action::Rotate( id, j, double( random() % 90 ) - 45 ) ) );
+            }
+            t.setDepth( id, int( random() % 10 ) );
+        }
+        t.config.computeMatrices();
+    };
+
+    for( int round = 0; round < 20; ++round ){
+        auto outer = takeSnapshot( t );
+        checkpoint first = t.saveState();
+        mutate();
+
+        auto inner = takeSnapshot( t );
+        checkpoint second = t.saveState();
+        mutate();
+        t.resetState( second );
+        if( inner.config.connected() ){
+            requireRestored( t, inner );
+        }
+
+        mutate();
+        t.resetState( first );
+        requireRestored( t, outer );
+        CHECK( t.marks.empty() );
+    }
+}
+
+TEST_CASE( "Reset recomputes a branch moved away from its parent's entry shoe" ){
+    treeConfig t( load( chainWithBranch() ), 7 );
+    auto before = takeSnapshot( t );
+    Edge branch = t.config.getEdges( 20 ).front();
+
+    checkpoint old = t.saveState();
+    t.reconnect( false, branch );
+    t.reconnect( true, Edge( 12, B, ZMinus, North, ZMinus, A, 20 ) );
+    t.logJoint( 10, Alpha );
+    t.config.execute( Action( Action::Rotate( 10, Alpha, 30 ) ) );
+    t.config.computeMatrices();
+    t.resetState( old );
+
+    requireRestored( t, before );
+}
+
+TEST_CASE( "The undo log only spans open checkpoints" ){
+    treeConfig t( load( fiveModules ) );
+    ID id = t.config.getIDs().front();
+
+    t.logJoint( id, Gamma );
+    t.config.execute( Action( Action::Rotate( id, Gamma, 10 ) ) );
+
+    checkpoint old = t.saveState();
+    CHECK( old.undo == 0 );
+    CHECK( t.undoLog.empty() );
+
+    t.logJoint( id, Gamma );
+    t.config.execute( Action( Action::Rotate( id, Gamma, 10 ) ) );
+    t.resetState( old );
+    CHECK( t.undoLog.empty() );
+    CHECK( t.marks.empty() );
+}
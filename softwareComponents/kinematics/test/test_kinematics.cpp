@@ -0,0 +1,148 @@
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+#include "kinematics.cpp"
+
+namespace {
+
+/* A straight arm 1 - 4, module 3 is connected through its shoe B */
+const std::string straightArm =
+    "C\n"
+    "M 1 0 0 0\n"
+    "M 2 0 0 0\n"
+    "M 3 0 0 0\n"
+    "M 4 0 0 0\n"
+    "E 1 B -Z N -Z A 2\n"
+    "E 2 B -Z N -Z B 3\n"
+    "E 3 A -Z N -Z A 4\n";
+
+Configuration load( const std::string& text ){
+    std::istringstream input( text );
+    Configuration config;
+    IO::readConfiguration( input, config );
+    config.computeMatrices();
+    return config;
+}
+
+Configuration rotated( Configuration config, const std::vector< std::array< double, 3 > >& joints ){
+    for( size_t i = 0; i < joints.size(); ++i ){
+        ID id = config.getIDs()[ i ];
+        config.execute( Action( Action::Rotate( id, Alpha, joints[ i ][ 0 ] ) ) );
+        config.execute( Action( Action::Rotate( id, Beta, joints[ i ][ 1 ] ) ) );
+        config.execute( Action( Action::Rotate( id, Gamma, joints[ i ][ 2 ] ) ) );
+    }
+    config.computeMatrices();
+    return config;
+}
+
+/* The matrices of the configuration are the same as if computed from scratch */
+void requireFresh( Configuration config ){
+    Configuration fresh = config;
+    fresh.setFixed( config.getFixedId(), config.getFixedSide(), identity );
+    fresh.computeMatrices();
+    for( ID id : config.getIDs() ){
+        for( ShoeId side : { A, B } ){
+            CHECK( rofi::configuration::matrices::equals( config.getMatrices().at( id )[ side ],
+                                                          fresh.getMatrices().at( id )[ side ] ) );
+        }
+    }
+}
+
+/* Euler angles as taken by reach, so that the end-effector matches the
+ * end of the given frame */
+std::vector< double > rotationOf( const Matrix& end ){
+    Matrix r = end * rotate( M_PI, Y );
+    return { to_deg( std::atan2( -r( 1, 2 ), r( 2, 2 ) ) ),
+             to_deg( std::asin( r( 0, 2 ) ) ),
+             to_deg( std::atan2( -r( 0, 1 ), r( 0, 0 ) ) ) };
+}
+
+} // namespace
+
+TEST_CASE( "Forward pass agrees with the computed matrices" ){
+    Configuration config = rotated( load( straightArm ), {
+        { 10, 20, 30 }, { -30, 40, 50 }, { 20, -10, 70 }, { 5, 15, -20 } } );
+    kinematic_rofibot bot( config );
+    REQUIRE( bot.get_arms().size() == 2 );
+
+    /* The arms go through module 3 in opposite directions */
+    for( size_t arm = 0; arm < bot.get_arms().size(); ++arm ){
+        const chain& modules = bot.get_arms()[ arm ];
+        frames f = bot.arm_frames( arm );
+        REQUIRE( f.size() == modules.size() );
+        for( size_t i = 0; i < modules.size(); ++i ){
+            for( ShoeId side : { A, B } ){
+                CHECK( rofi::configuration::matrices::equals( f[ i ][ side ],
+                                                              config.getMatrices().at( modules[ i ] )[ side ] ) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "Pseudoinverse reaches the end of another pose of the arm" ){
+    Configuration start = load( straightArm );
+    auto goalJoints = GENERATE( std::vector< std::array< double, 3 > >{
+                                    { 30, -20, 45 }, { -10, 40, 0 }, { 20, 10, -60 }, { 0, 30, 90 } },
+                                std::vector< std::array< double, 3 > >{
+                                    { -45, 0, 10 }, { 15, -15, 30 }, { 30, 30, 0 }, { -20, 10, -45 } } );
+    Matrix end = rotated( start, goalJoints ).getMatrices().at( 4 )[ B ];
+    Vector goal = end * Vector( { 0, 0, 0, 1 } );
+
+    kinematic_rofibot bot( start, true );
+    REQUIRE( bot.reach( goal, rotationOf( end ), strategy::pseudoinverse ) );
+
+    Configuration result = bot.get_config();
+    requireFresh( result );
+    CHECK( distance( result.getMatrices().at( 4 )[ B ] * Vector( { 0, 0, 0, 1 } ), goal ) <= error );
+}
+
+TEST_CASE( "Fixed arm whose modules are not chained in order of IDs" ){
+    /* Module 3 lies between 1 and 2, so 1 and 2 are not connected */
+    Configuration start = load( "C\n"
+                                "M 1 0 0 0\n"
+                                "M 2 0 0 0\n"
+                                "M 3 0 0 0\n"
+                                "E 1 B -Z N -Z A 3\n"
+                                "E 3 B -Z N -Z A 2\n" );
+    kinematic_rofibot bot( start, true );
+    CHECK_THROWS_AS( bot.reach( Vector( { 0, 0, 1, 1 } ), { 0, 0, 0 }, strategy::pseudoinverse ),
+                     std::logic_error );
+}
+
+TEST_CASE( "Multistart solutions reach the target" ){
+    Configuration start = load( straightArm );
+    Matrix end = rotated( start, { { 30, -20, 45 }, { -10, 40, 0 }, { 20, 10, -60 }, { 0, 30, 90 } } )
+                    .getMatrices().at( 4 )[ B ];
+    Vector goal = end * Vector( { 0, 0, 0, 1 } );
+
+    multistart ms;
+    ms.starts = 6;
+    ms.strategies = { strategy::pseudoinverse };
+    ms.jobs = 2;
+
+    SECTION( "First found solution cancels the remaining runs" ){
+        /* A single worker starts with the unperturbed run, which succeeds */
+        ms.jobs = 1;
+        kinematic_rofibot bot( start, true );
+        REQUIRE( bot.reach( goal, rotationOf( end ), ms ) );
+        CHECK( bot.get_started_runs() == 1 );
+
+        Configuration result = bot.get_config();
+        requireFresh( result );
+        CHECK( result.isValid() );
+        CHECK( distance( result.getMatrices().at( 4 )[ B ] * Vector( { 0, 0, 0, 1 } ), goal ) <= error );
+    }
+
+    SECTION( "Best solution waits for all runs" ){
+        ms.best = true;
+        kinematic_rofibot bot( start, true );
+        REQUIRE( bot.reach( goal, rotationOf( end ), ms ) );
+        CHECK( bot.get_started_runs() == 6 );
+
+        Configuration result = bot.get_config();
+        requireFresh( result );
+        CHECK( result.isValid() );
+        CHECK( distance( result.getMatrices().at( 4 )[ B ] * Vector( { 0, 0, 0, 1 } ), goal ) <= error );
+    }
+}
@@ -8,33 +8,98 @@
 #include <legacy/configuration/Configuration.h>
 #include <legacy/configuration/Generators.h>
 #include <legacy/configuration/IO.h>
+#include <chrono>
+#include <functional>
 #include <queue>
 #include <memory>
+#include <stop_token>
+#include <unordered_set>
 
 struct AlgorithmStat {
     unsigned long pathLength = 0;
     unsigned long queueSize = 0;
     unsigned long seenCfgs = 0;
+    // The search ran out of its budget; the path ends closest to the goal.
+    bool partial = false;
 
     std::string toString() const {
         std::stringstream out;
         out << std::setw(8) << std::left << "length " << pathLength << std::endl;
         out << std::setw(8) << std::left << "queue " << queueSize << std::endl;
         out << std::setw(8) << std::left << "cfgs " << seenCfgs << std::endl;
+        if (partial)
+            out << std::setw(8) << std::left << "partial " << "yes" << std::endl;
         return out.str();
     }
 };
 
-class ConfigurationPtrHash {
+/**
+ * Snapshot of a running search, reported through `SearchLimits::onProgress`.
+ */
+struct SearchProgress {
+    unsigned long expanded = 0;     // A* expansions or RRT iterations
+    unsigned long seenCfgs = 0;     // configurations in the pool (tree size for RRT)
+    unsigned long queueSize = 0;    // open list size, 0 for RRT
+    double bestEval = 0;            // lowest heuristic value (RRT: matrixDiff) reached so far
+    double elapsed = 0;             // seconds
+};
+
+/**
+ * Budget of an anytime search. Once the time or node budget is spent or
+ * a stop is requested, the search returns the path to the configuration
+ * closest to the goal and sets `AlgorithmStat::partial`.
+ */
+struct SearchLimits {
+    double timeBudget = 0;          // seconds, 0 for no limit
+    unsigned long nodeBudget = 0;   // stored configurations, 0 for no limit
+    std::stop_token stop;
+    std::function<void(const SearchProgress&)> onProgress;
+    double progressInterval = 1;    // seconds between progress events
+};
+
+/**
+ * Tracks a search against its `SearchLimits`.
+ */
+class SearchBudget {
 public:
-    std::size_t operator()(const std::unique_ptr<Configuration>& ptr) const {
-        return ConfigurationHash{}(*ptr);
+    explicit SearchBudget(const SearchLimits& limits)
+        : limits(limits), start(Clock::now()), lastReport(start) {}
+
+    double elapsed() const {
+        return std::chrono::duration<double>(Clock::now() - start).count();
     }
-};
 
-inline bool operator==(const std::unique_ptr<Configuration>& a, const std::unique_ptr<Configuration>& b) {
-    return (*a) == (*b);
-}
+    bool exhausted(unsigned long seenCfgs) const {
+        if (limits.stop.stop_requested())
+            return true;
+        if (limits.nodeBudget != 0 && seenCfgs >= limits.nodeBudget)
+            return true;
+        return limits.timeBudget > 0 && elapsed() >= limits.timeBudget;
+    }
+
+    /** Whether a progress event is due; call `report` if it is. */
+    bool reportDue() const {
+        if (!limits.onProgress)
+            return false;
+        using namespace std::chrono;
+        return duration<double>(Clock::now() - lastReport).count() >= limits.progressInterval;
+    }
+
+    void report(SearchProgress progress) {
+        if (!limits.onProgress)
+            return;
+        lastReport = Clock::now();
+        progress.elapsed = std::chrono::duration<double>(lastReport - start).count();
+        limits.onProgress(progress);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const SearchLimits& limits;
+    Clock::time_point start;
+    Clock::time_point lastReport;
+};
 
 using ConfigPred = std::unordered_map<const Configuration*, const Configuration*>;
 using ConfigEdges = std::unordered_map<const Configuration*, std::vector<const Configuration*>>;
@@ -52,10 +117,48 @@ public:
     }
 };
 
+/**
+ * Owning set of configurations visited by a search.
+ *
+ * Every entry caches the hash of its configuration, so lookups by a plain
+ * `Configuration` hash it exactly once and never copy it; the stored hash
+ * is also reused on rehash.
+ */
 class ConfigPool {
 public:
-    typedef std::unordered_set<std::unique_ptr<Configuration>, ConfigurationPtrHash>::iterator iterator;
-    typedef std::unordered_set<std::unique_ptr<Configuration>, ConfigurationPtrHash>::const_iterator const_iterator;
+    struct Entry {
+        std::size_t hash;
+        std::unique_ptr<Configuration> cfg;
+    };
+
+    /** Borrowed lookup key, compared against entries without allocating. */
+    struct Key {
+        std::size_t hash;
+        const Configuration* cfg;
+    };
+
+    struct EntryHash {
+        using is_transparent = void;
+        std::size_t operator()(const Entry& e) const { return e.hash; }
+        std::size_t operator()(const Key& k) const { return k.hash; }
+    };
+
+    struct EntryEqual {
+        using is_transparent = void;
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.hash == b.hash && *a.cfg == *b.cfg;
+        }
+        bool operator()(const Key& a, const Entry& b) const {
+            return a.hash == b.hash && *a.cfg == *b.cfg;
+        }
+        bool operator()(const Entry& a, const Key& b) const {
+            return (*this)(b, a);
+        }
+    };
+
+    using Set = std::unordered_set<Entry, EntryHash, EntryEqual>;
+    typedef Set::iterator iterator;
+    typedef Set::const_iterator const_iterator;
 
     iterator begin() { return pool.begin(); }
     const_iterator begin() const { return pool.begin(); }
@@ -66,24 +169,42 @@ public:
         return pool.size();
     }
 
+    /**
+     * Return the pooled copy of `config`, inserting it if it is not present.
+     * The flag is true when the configuration was inserted by this call.
+     */
+    std::pair<const Configuration*, bool> insert_or_get(const Configuration& config) {
+        Key key = makeKey(config);
+        auto it = pool.find(key);
+        if (it != pool.end())
+            return { it->cfg.get(), false };
+        it = pool.insert(Entry{ key.hash, std::make_unique<Configuration>(config) }).first;
+        return { it->cfg.get(), true };
+    }
+
     Configuration* insert(const Configuration& config) {
-        auto tmp = std::make_unique<Configuration>(config);
-        auto [ptr, _] = pool.insert(std::move(tmp));
-        return ptr->get();
+        Key key = makeKey(config);
+        auto it = pool.find(key);
+        if (it == pool.end())
+            it = pool.insert(Entry{ key.hash, std::make_unique<Configuration>(config) }).first;
+        return it->cfg.get();
     }
 
     bool has(const Configuration& config) const {
-        auto tmp = std::make_unique<Configuration>(config);
-        return (pool.find(tmp) != pool.end());
+        return pool.find(makeKey(config)) != pool.end();
     }
 
     const Configuration* get(const Configuration& config) const {
-        auto tmp = std::make_unique<Configuration>(config);
-        return pool.find(tmp)->get();
+        auto it = pool.find(makeKey(config));
+        return it == pool.end() ? nullptr : it->cfg.get();
     }
 
 private:
-    std::unordered_set<std::unique_ptr<Configuration>, ConfigurationPtrHash> pool;
+    static Key makeKey(const Configuration& config) {
+        return { ConfigurationHash{}(config), &config };
+    }
+
+    Set pool;
 };
 
 
@@ -187,7 +308,48 @@ std::vector<Configuration> AStar(const Configuration& init,
     const Configuration& goal, unsigned step = 90,
     unsigned bound = 1, EvalFunction& eval = Eval::trivial, AlgorithmStat* stat = nullptr);
 
+/**
+ * \brief Anytime A*: stops when \p limits are spent and returns the path to
+ * the configuration with the lowest \p eval found so far.
+ */
+std::vector<Configuration> AStar(const Configuration& init,
+    const Configuration& goal, unsigned step, unsigned bound, EvalFunction& eval,
+    const SearchLimits& limits, AlgorithmStat* stat = nullptr);
+
+/**
+ * \brief BFS and A* keeping only fingerprints of visited configurations
+ * (see `ClosedSet` in Fingerprint.h); paths are rebuilt by replaying
+ * successor indices. `seenCfgs` counts the closed set.
+ */
+std::vector<Configuration> CompactBFS(const Configuration& init,
+    const Configuration& goal, unsigned step = 90,
+    unsigned bound = 1, AlgorithmStat* stat = nullptr);
+
+std::vector<Configuration> CompactAStar(const Configuration& init,
+    const Configuration& goal, unsigned step = 90,
+    unsigned bound = 1, EvalFunction& eval = Eval::trivial, AlgorithmStat* stat = nullptr);
+
+/**
+ * \brief Hash-distributed A* (HDA*) running on \p threads threads.
+ *
+ * Each configuration is owned by the thread selected by its hash; successors
+ * are sent to their owner through lock-free queues. With an admissible
+ * \p eval the returned path is a shortest one. If \p threads is 0, all
+ * hardware threads are used.
+ */
+std::vector<Configuration> ParallelAStar(const Configuration& init,
+    const Configuration& goal, unsigned step = 90, unsigned bound = 1,
+    EvalFunction& eval = Eval::trivial, unsigned threads = 0, AlgorithmStat* stat = nullptr);
+
 std::vector<Configuration> RRT(const Configuration& init,
     const Configuration& goal, unsigned step = 90, AlgorithmStat* stat = nullptr);
 
+/**
+ * \brief Anytime RRT: stops when \p limits are spent and returns the path to
+ * the tree node nearest to \p goal by `Eval::matrixDiff`.
+ */
+std::vector<Configuration> RRT(const Configuration& init,
+    const Configuration& goal, unsigned step, const SearchLimits& limits,
+    AlgorithmStat* stat = nullptr);
+
 #endif //ROBOTS_BFS_H
@@ -0,0 +1,84 @@
+#ifndef ROBOTS_BATCH_H
+#define ROBOTS_BATCH_H
+
+#include "Algorithms.h"
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class Algorithm
+{
+    BFS, AStar, RRT
+};
+
+std::optional<Algorithm> parseAlgorithm(const std::string& name);
+std::string algorithmName(Algorithm alg);
+
+/**
+ * \brief Returns the evaluation function called \p name (dMatrix, dCenter,
+ * dJoint, dAction, trivial), or nullptr if there is none.
+ */
+EvalFunction* parseEval(const std::string& name);
+
+/* BATCH
+ *
+ * A manifest lists one reconfiguration query per line:
+ *
+ *     <init file> <goal file> [algorithm [eval [step [bound]]]]
+ *
+ * Empty lines and lines starting with '#' are skipped. Relative paths are
+ * resolved against the directory of the manifest. Missing fields default to
+ * bfs, trivial, 90 and 1.
+ *
+ * Every task runs in its own process, so that it can be stopped after
+ * a timeout and its address space can be limited. Within the process,
+ * A* tasks search on `BatchOptions::threads` threads and all tasks check
+ * successors on `BatchOptions::workers` threads.
+ * */
+
+struct BatchTask {
+    std::string init;
+    std::string goal;
+    Algorithm alg = Algorithm::BFS;
+    std::string eval = "trivial";
+    unsigned step = 90;
+    unsigned bound = 1;
+};
+
+struct BatchOptions {
+    unsigned jobs = 1;
+    double timeout = 0;             // seconds, 0 for no limit
+    unsigned long memoryLimit = 0;  // MiB, 0 for no limit
+    unsigned threads = 1;           // threads of each A* task, 0 for all cores
+    unsigned workers = 1;           // successor-checking threads of each task, 0 for all cores
+};
+
+struct BatchResult {
+    // ok, no-path, invalid, timeout, out-of-memory or error
+    std::string status;
+    AlgorithmStat stat;
+    double wallTime = 0;            // seconds
+    long peakRss = 0;               // KiB
+};
+
+/**
+ * \brief Reads a manifest from \p input; relative paths are resolved against
+ * \p baseDir.
+ *
+ * Throws std::runtime_error with the line number on a malformed line.
+ */
+std::vector<BatchTask> readManifest(std::istream& input, const std::string& baseDir);
+
+/**
+ * \brief Runs all \p tasks, at most `opts.jobs` at once, and returns their
+ * results in the order of \p tasks.
+ */
+std::vector<BatchResult> runBatch(const std::vector<BatchTask>& tasks, const BatchOptions& opts);
+
+void writeResultsJson(std::ostream& out, const std::vector<BatchTask>& tasks,
+    const std::vector<BatchResult>& results);
+void writeResultsCsv(std::ostream& out, const std::vector<BatchTask>& tasks,
+    const std::vector<BatchResult>& results);
+
+#endif //ROBOTS_BATCH_H
@@ -0,0 +1,173 @@
+#ifndef ROBOTS_FINGERPRINT_H
+#define ROBOTS_FINGERPRINT_H
+
+#include <legacy/configuration/Configuration.h>
+#include <legacy/configuration/Generators.h>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+/* FINGERPRINT CLOSED SET
+ *
+ * A closed set for searches over huge state spaces. Instead of a copy of
+ * every visited configuration it keeps a 128-bit fingerprint, the
+ * fingerprint of the parent and the index of the configuration among the
+ * successors of its parent (`next` generates successors in a fixed order).
+ * A path is rebuilt by replaying these indices from the initial
+ * configuration.
+ *
+ * Two different configurations sharing a fingerprint would be merged; with
+ * 128 bits this is negligible for any state space that fits into memory.
+ * */
+
+struct Fingerprint {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const Fingerprint& other) const {
+        return lo == other.lo && hi == other.hi;
+    }
+    bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+};
+
+struct FingerprintHash {
+    std::size_t operator()(const Fingerprint& f) const {
+        return static_cast<std::size_t>(f.lo);
+    }
+};
+
+namespace detail {
+    inline uint64_t mix64(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    class FingerprintBuilder {
+    public:
+        void add(uint64_t word) {
+            lo = mix64(lo ^ word) + 0x9e3779b97f4a7c15ULL;
+            hi = mix64(hi + word * 0xff51afd7ed558ccdULL) ^ 0xc4ceb9fe1a85ec53ULL;
+        }
+
+        void add(double joint) {
+            // Joints are rounded to 1e-3 degrees, coarser than the 1e-4 degree
+            // tolerance of module equality, so equal modules usually share a
+            // fingerprint. Two equal values straddling a rounding boundary do
+            // not; such a configuration only gets a duplicate closed-set entry.
+            add(static_cast<uint64_t>(std::llround(joint * 1000)));
+        }
+
+        Fingerprint get() const { return {mix64(lo), mix64(hi)}; }
+
+    private:
+        uint64_t lo = 0x243f6a8885a308d3ULL;
+        uint64_t hi = 0x13198a2e03707344ULL;
+    };
+}
+
+/**
+ * \brief Fingerprint of the joints and edges of \p config. Configurations
+ * with the same joints rounded to 1e-3 degrees and the same edges have equal
+ * fingerprints; equal configurations whose joints round differently do not
+ * (see `FingerprintBuilder::add(double)`).
+ */
+inline Fingerprint fingerprint(const Configuration& config) {
+    detail::FingerprintBuilder builder;
+    for (const auto& [id, mod] : config.getModules()) {
+        builder.add(static_cast<uint64_t>(id));
+        for (Joint j : {Alpha, Beta, Gamma})
+            builder.add(mod.getJoint(j));
+    }
+    for (const auto& [id, list] : config.getEdges()) {
+        for (const auto& edge : list) {
+            if (!edge.has_value())
+                continue;
+            builder.add((static_cast<uint64_t>(static_cast<uint32_t>(edge->id1())) << 32)
+                | static_cast<uint32_t>(edge->id2()));
+            builder.add(static_cast<uint64_t>(edge->side1())
+                | static_cast<uint64_t>(edge->side2()) << 1
+                | static_cast<uint64_t>(edge->dock1()) << 2
+                | static_cast<uint64_t>(edge->dock2()) << 4
+                | static_cast<uint64_t>(edge->ori()) << 6);
+        }
+    }
+    return builder.get();
+}
+
+class ClosedSet {
+public:
+    static constexpr uint32_t noAction = std::numeric_limits<uint32_t>::max();
+
+    struct Record {
+        Fingerprint parent;
+        uint32_t action;    // index among the successors of parent
+        uint32_t dist;      // distance from the root
+    };
+
+    ClosedSet(unsigned step, unsigned bound) : step(step), bound(bound) {}
+
+    void insertRoot(const Fingerprint& root) {
+        records[root] = {root, noAction, 0};
+    }
+
+    /**
+     * \brief Records \p fp reached from \p parent by successor \p action,
+     * unless it is already known with at most \p dist.
+     *
+     * \return true if the record was inserted or improved.
+     */
+    bool relax(const Fingerprint& fp, const Fingerprint& parent, uint32_t action, uint32_t dist) {
+        auto [it, inserted] = records.try_emplace(fp, Record{parent, action, dist});
+        if (inserted)
+            return true;
+        if (it->second.dist <= dist)
+            return false;
+        it->second = {parent, action, dist};
+        return true;
+    }
+
+    bool contains(const Fingerprint& fp) const {
+        return records.find(fp) != records.end();
+    }
+
+    const Record* find(const Fingerprint& fp) const {
+        auto it = records.find(fp);
+        return it == records.end() ? nullptr : &it->second;
+    }
+
+    size_t size() const {
+        return records.size();
+    }
+
+    /**
+     * \brief Rebuilds the path from \p root to \p end by replaying the
+     * recorded successor indices.
+     */
+    std::vector<Configuration> path(const Configuration& root, const Fingerprint& end) const {
+        std::vector<uint32_t> actions;
+        for (const Record* r = find(end); r != nullptr && r->action != noAction; r = find(r->parent))
+            actions.push_back(r->action);
+
+        std::vector<Configuration> res = {root};
+        std::vector<Configuration> succ;
+        for (auto it = actions.rbegin(); it != actions.rend(); ++it) {
+            succ.clear();
+            next(res.back(), succ, step, bound);
+            res.push_back(succ.at(*it));
+        }
+        return res;
+    }
+
+private:
+    unsigned step;
+    unsigned bound;
+    std::unordered_map<Fingerprint, Record, FingerprintHash> records;
+};
+
+#endif //ROBOTS_FINGERPRINT_H
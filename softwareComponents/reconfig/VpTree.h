@@ -0,0 +1,198 @@
+#ifndef ROBOTS_VPTREE_H
+#define ROBOTS_VPTREE_H
+
+#include <legacy/configuration/Configuration.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+/**
+ * \brief Vantage-point tree over configurations for nearest-neighbour queries.
+ *
+ * Configurations are inserted one by one: a new configuration descends from
+ * the root, going inside a node if it is at most the node's radius away from
+ * its vantage point, and outside otherwise. A leaf gets its radius from its
+ * first child. Such radii depend on the insertion order; RRT grows paths of
+ * configurations close to each other, which would degrade the tree into a
+ * list. So when a child holds more than `balance` of its parent's subtree,
+ * the subtree is rebuilt with every radius set to the median distance from
+ * its vantage point, as in a scapegoat tree. Insertion then costs
+ * O(log^2 n) distance evaluations amortized.
+ *
+ * Queries prune subtrees by the triangle inequality, so the result is exact
+ * for metric distances (such as `Eval::jointDiff`, `Eval::centerDiff` and
+ * `Eval::matrixDiff` up to their rounding).
+ *
+ * The tree stores pointers only; inserted configurations must outlive it.
+ */
+class VpTree {
+public:
+    using DistFunction = double(const Configuration&, const Configuration&);
+
+    explicit VpTree(DistFunction* dist) : dist(dist) {}
+
+    size_t size() const { return nodes.size(); }
+    bool empty() const { return nodes.empty(); }
+
+    void insert(const Configuration* cfg) {
+        int newIndex = static_cast<int>(nodes.size());
+        nodes.push_back({cfg});
+        if (newIndex == 0)
+            return;
+
+        // Highest node on the path whose subtree got unbalanced
+        int scapegoat = -1;
+        int idx = 0;
+        while (true) {
+            Node& node = nodes[static_cast<size_t>(idx)];
+            ++node.size;
+            double d = dist(*cfg, *node.point);
+            if (node.radius < 0)
+                node.radius = d;
+            int& child = d <= node.radius ? node.inside : node.outside;
+            if (child < 0) {
+                child = newIndex;
+                break;
+            }
+            const Node& next = nodes[static_cast<size_t>(child)];
+            if (scapegoat < 0 && node.size >= minRebuild
+                    && static_cast<double>(next.size + 1) > balance * static_cast<double>(node.size))
+                scapegoat = idx;
+            idx = child;
+        }
+        if (scapegoat >= 0)
+            rebuild(scapegoat);
+    }
+
+    /**
+     * \brief Returns the inserted configuration nearest to \p cfg, or
+     * nullptr if the tree is empty.
+     */
+    const Configuration* nearest(const Configuration& cfg) const {
+        if (nodes.empty())
+            return nullptr;
+
+        const Configuration* best = nullptr;
+        double bestDist = std::numeric_limits<double>::infinity();
+
+        // Pairs of node index and lower bound on the distance of its subtree.
+        std::vector<std::pair<int, double>> stack;
+        stack.emplace_back(0, 0);
+        while (!stack.empty()) {
+            auto [idx, bound] = stack.back();
+            stack.pop_back();
+            if (bound >= bestDist)
+                continue;
+
+            const Node& node = nodes[static_cast<size_t>(idx)];
+            double d = dist(cfg, *node.point);
+            if (d < bestDist) {
+                bestDist = d;
+                best = node.point;
+            }
+            if (node.radius < 0)
+                continue;
+
+            double insideBound = std::max(0.0, d - node.radius);
+            double outsideBound = std::max(0.0, node.radius - d);
+            // Push the farther side first so that the nearer one is searched
+            // first and tightens bestDist.
+            if (d <= node.radius) {
+                if (node.outside >= 0)
+                    stack.emplace_back(node.outside, outsideBound);
+                if (node.inside >= 0)
+                    stack.emplace_back(node.inside, insideBound);
+            } else {
+                if (node.inside >= 0)
+                    stack.emplace_back(node.inside, insideBound);
+                if (node.outside >= 0)
+                    stack.emplace_back(node.outside, outsideBound);
+            }
+        }
+        return best;
+    }
+
+private:
+    struct Node {
+        const Configuration* point;
+        double radius = -1;
+        int inside = -1;
+        int outside = -1;
+        size_t size = 1;
+    };
+
+    // Pairs of distance from the current vantage point and configuration.
+    using Items = std::vector<std::pair<double, const Configuration*>>;
+
+    static bool byDistance(const Items::value_type& a, const Items::value_type& b) {
+        return a.first < b.first;
+    }
+
+    /**
+     * \brief Rebuilds the subtree rooted at \p root balanced, reusing the
+     * nodes of the subtree; \p root stays its root.
+     */
+    void rebuild(int root) {
+        std::vector<int> slots = {root};
+        Items items;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            const Node& node = nodes[static_cast<size_t>(slots[i])];
+            items.emplace_back(0, node.point);
+            for (int child : {node.inside, node.outside}) {
+                if (child >= 0)
+                    slots.push_back(child);
+            }
+        }
+        size_t next = 0;
+        build(items, 0, items.size(), slots, next);
+    }
+
+    /**
+     * \brief Builds a balanced subtree of \p items in [\p begin, \p end) into
+     * the nodes \p slots from \p next on and returns index of its root, or -1
+     * if the range is empty.
+     */
+    int build(Items& items, size_t begin, size_t end, const std::vector<int>& slots, size_t& next) {
+        if (begin == end)
+            return -1;
+
+        // The farthest configuration from the parent's vantage point lies in
+        // a corner of the subtree, where vantage points prune best.
+        auto farthest = std::max_element(items.begin() + static_cast<std::ptrdiff_t>(begin),
+                                         items.begin() + static_cast<std::ptrdiff_t>(end), byDistance);
+        std::iter_swap(items.begin() + static_cast<std::ptrdiff_t>(begin), farthest);
+
+        int idx = slots[next++];
+        nodes[static_cast<size_t>(idx)] = {items[begin].second};
+        nodes[static_cast<size_t>(idx)].size = end - begin;
+        if (++begin == end)
+            return idx;
+
+        const Configuration* vantage = nodes[static_cast<size_t>(idx)].point;
+        for (size_t i = begin; i < end; ++i)
+            items[i].first = dist(*items[i].second, *vantage);
+
+        // The median goes inside, as an inserted configuration at the radius would.
+        size_t middle = begin + (end - begin - 1) / 2;
+        std::nth_element(items.begin() + static_cast<std::ptrdiff_t>(begin),
+                         items.begin() + static_cast<std::ptrdiff_t>(middle),
+                         items.begin() + static_cast<std::ptrdiff_t>(end), byDistance);
+        nodes[static_cast<size_t>(idx)].radius = items[middle].first;
+
+        int inside = build(items, begin, middle + 1, slots, next);
+        int outside = build(items, middle + 1, end, slots, next);
+        nodes[static_cast<size_t>(idx)].inside = inside;
+        nodes[static_cast<size_t>(idx)].outside = outside;
+        return idx;
+    }
+
+    // Largest part of a subtree its child may hold before it gets rebuilt;
+    // subtrees smaller than minRebuild are never rebuilt.
+    static constexpr double balance = 0.75;
+    static constexpr size_t minRebuild = 16;
+
+    DistFunction* dist;
+    std::vector<Node> nodes;
+};
+
+#endif //ROBOTS_VPTREE_H
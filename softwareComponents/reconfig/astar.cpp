@@ -1,8 +1,15 @@
 #include "Algorithms.h"
 
-std::vector<Configuration> AStar(const Configuration& init, 
-    const Configuration& goal, unsigned step /*= 90*/, unsigned bound /*= 1*/, 
+std::vector<Configuration> AStar(const Configuration& init,
+    const Configuration& goal, unsigned step /*= 90*/, unsigned bound /*= 1*/,
     EvalFunction& eval /*= Eval::trivial */, AlgorithmStat* stat /*= nullptr*/)
+{
+    return AStar(init, goal, step, bound, eval, SearchLimits{}, stat);
+}
+
+std::vector<Configuration> AStar(const Configuration& init,
+    const Configuration& goal, unsigned step, unsigned bound, EvalFunction& eval,
+    const SearchLimits& limits, AlgorithmStat* stat /*= nullptr*/)
 {
     ConfigPred pred;
     ConfigPool pool;
@@ -19,41 +26,57 @@ std::vector<Configuration> AStar(const Configuration& init,
     }
 
     std::priority_queue<EvalPair, std::vector<EvalPair>, EvalCompare> queue;
+    SearchBudget budget(limits);
 
     const Configuration* pointer = pool.insert(init);
     initDist[pointer] = 0;
     goalDist[pointer] = eval(init, goal);
     pred[pointer] = pointer;
     unsigned long maxQSize = 0;
+    unsigned long expanded = 0;
+
+    // Configuration with the lowest heuristic so far, the end of a partial path.
+    const Configuration* best = pointer;
+    double bestEval = goalDist[pointer];
+
+    auto finish = [&](std::vector<Configuration> path, bool partial) {
+        if (stat != nullptr)
+        {
+            stat->pathLength = path.size();
+            stat->queueSize = maxQSize;
+            stat->seenCfgs = pool.size();
+            stat->partial = partial;
+        }
+        return path;
+    };
 
     queue.push( {goalDist[pointer], pointer} );
 
     while (!queue.empty())
     {
+        if (budget.exhausted(pool.size()))
+            return finish(createPath(pred, best), true);
+        if (budget.reportDue())
+            budget.report({expanded, pool.size(), queue.size(), bestEval});
 
         maxQSize = std::max(maxQSize, queue.size());
         const auto [d, current] = queue.top();
         double currDist = initDist[current];
         queue.pop();
+        ++expanded;
 
 
         std::vector<Configuration> nextCfgs;
         next(*current, nextCfgs, step, bound);
         for (const auto& next : nextCfgs)
         {
-            const Configuration* pointerNext;
-            double newDist = currDist + 1 + eval(next, goal);
-            bool update = false;
+            double nextEval = eval(next, goal);
+            double newDist = currDist + 1 + nextEval;
 
-            if (!pool.has(next))
+            auto [pointerNext, update] = pool.insert_or_get(next);
+            if (update)
             {
-                pointerNext = pool.insert(next);
                 initDist[pointerNext] = currDist + 1;
-                update = true;
-            }
-            else
-            {
-                pointerNext = pool.get(next);
             }
 
             if ((currDist + 1 < initDist[pointerNext]) || update)
@@ -64,25 +87,17 @@ std::vector<Configuration> AStar(const Configuration& init,
                 queue.push({newDist, pointerNext});
             }
 
+            if (nextEval < bestEval)
+            {
+                bestEval = nextEval;
+                best = pointerNext;
+            }
+
             if (next == goal)
             {
-                auto path = createPath(pred, pointerNext);
-                if (stat != nullptr)
-                {
-                    stat->pathLength = path.size();
-                    stat->queueSize = maxQSize;
-                    stat->seenCfgs = pool.size();
-                }
-
-                return path;
+                return finish(createPath(pred, pointerNext), false);
             }
         }
     }
-    if (stat != nullptr)
-    {
-        stat->pathLength = 0;
-        stat->queueSize = maxQSize;
-        stat->seenCfgs = pool.size();
-    }
-    return {};
+    return finish({}, false);
 }
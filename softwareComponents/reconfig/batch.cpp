@@ -0,0 +1,372 @@
+#include "Batch.h"
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+std::optional<Algorithm> parseAlgorithm(const std::string& name)
+{
+    if ((name == "bfs") || (name == "BFS"))
+        return Algorithm::BFS;
+    if ((name == "astar") || (name == "AStar"))
+        return Algorithm::AStar;
+    if ((name == "rrt") || (name == "RRT"))
+        return Algorithm::RRT;
+    return std::nullopt;
+}
+
+std::string algorithmName(Algorithm alg)
+{
+    switch (alg)
+    {
+        case Algorithm::BFS:
+            return "bfs";
+        case Algorithm::AStar:
+            return "astar";
+        case Algorithm::RRT:
+            return "rrt";
+    }
+    return "";
+}
+
+EvalFunction* parseEval(const std::string& name)
+{
+    if (name == "dCenter")
+        return &Eval::centerDiff;
+    if (name == "dJoint")
+        return &Eval::jointDiff;
+    if (name == "dMatrix")
+        return &Eval::matrixDiff;
+    if (name == "dAction")
+        return &Eval::actionDiff;
+    if (name == "trivial")
+        return &Eval::trivial;
+    return nullptr;
+}
+
+std::vector<BatchTask> readManifest(std::istream& input, const std::string& baseDir)
+{
+    std::vector<BatchTask> tasks;
+    std::string line;
+    for (unsigned lineNo = 1; std::getline(input, line); ++lineNo)
+    {
+        std::istringstream lineInput(line);
+        std::vector<std::string> fields;
+        for (std::string field; lineInput >> field; )
+            fields.push_back(field);
+        if (fields.empty() || fields[0][0] == '#')
+            continue;
+
+        auto fail = [&](const std::string& what) {
+            throw std::runtime_error("Manifest line " + std::to_string(lineNo) + ": " + what);
+        };
+        auto number = [&](const std::string& field, const std::string& what) {
+            try
+            {
+                size_t end = 0;
+                unsigned long value = std::stoul(field, &end);
+                if (end == field.size() && value <= std::numeric_limits<unsigned>::max())
+                    return static_cast<unsigned>(value);
+            }
+            catch (const std::logic_error&) {}
+            fail(what + " is not a number");
+            return 0u;
+        };
+
+        if (fields.size() < 2)
+            fail("missing goal configuration");
+        if (fields.size() > 6)
+            fail("too many fields");
+
+        BatchTask task;
+        task.init = fields[0];
+        task.goal = fields[1];
+        if (fields.size() > 2)
+        {
+            auto parsed = parseAlgorithm(fields[2]);
+            if (!parsed.has_value())
+                fail("unknown algorithm '" + fields[2] + "'");
+            task.alg = parsed.value();
+        }
+        if (fields.size() > 3)
+        {
+            task.eval = fields[3];
+            if (parseEval(task.eval) == nullptr)
+                fail("unknown evaluation function '" + task.eval + "'");
+        }
+        if (fields.size() > 4)
+            task.step = number(fields[4], "step");
+        if (fields.size() > 5)
+            task.bound = number(fields[5], "bound");
+        if (task.step > 90)
+            fail("step must be in range <0,90>");
+        if (task.bound == 0)
+            fail("bound must be at least 1");
+
+        for (auto* path : {&task.init, &task.goal})
+        {
+            std::filesystem::path p(*path);
+            if (p.is_relative())
+                *path = (std::filesystem::path(baseDir) / p).string();
+        }
+        tasks.push_back(task);
+    }
+    return tasks;
+}
+
+namespace {
+
+enum class ChildStatus : int { Ok, NoPath, Invalid, OutOfMemory, Error };
+
+struct ChildReport {
+    ChildStatus status;
+    unsigned long pathLength;
+    unsigned long queueSize;
+    unsigned long seenCfgs;
+};
+
+ChildReport solve(const BatchTask& task, const BatchOptions& opts)
+{
+    ChildReport report{ChildStatus::Error, 0, 0, 0};
+    std::ifstream initInput(task.init), goalInput(task.goal);
+    Configuration init, goal;
+    if (!initInput.good() || !goalInput.good()
+        || !IO::readConfiguration(initInput, init) || !IO::readConfiguration(goalInput, goal))
+        return report;
+
+    if (!init.isValid() || !goal.isValid())
+    {
+        report.status = ChildStatus::Invalid;
+        return report;
+    }
+
+    AlgorithmStat stat;
+    std::vector<Configuration> path;
+    switch (task.alg)
+    {
+        case Algorithm::BFS:
+            path = BFS(init, goal, task.step, task.bound, &stat);
+            break;
+        case Algorithm::AStar:
+            if (opts.threads == 1)
+                path = AStar(init, goal, task.step, task.bound, *parseEval(task.eval), &stat);
+            else
+                path = ParallelAStar(init, goal, task.step, task.bound, *parseEval(task.eval),
+                    opts.threads, &stat);
+            break;
+        case Algorithm::RRT:
+            path = RRT(init, goal, task.step, &stat);
+            break;
+    }
+    report.status = path.empty() ? ChildStatus::NoPath : ChildStatus::Ok;
+    report.pathLength = stat.pathLength;
+    report.queueSize = stat.queueSize;
+    report.seenCfgs = stat.seenCfgs;
+    return report;
+}
+
+[[noreturn]] void runChild(const BatchTask& task, const BatchOptions& opts, int fd)
+{
+    if (opts.memoryLimit != 0)
+    {
+        rlim_t bytes = static_cast<rlim_t>(opts.memoryLimit) << 20;
+        rlimit limit{bytes, bytes};
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    setSuccessorThreads(opts.workers);
+
+    ChildReport report{ChildStatus::Error, 0, 0, 0};
+    try
+    {
+        report = solve(task, opts);
+    }
+    catch (const std::bad_alloc&)
+    {
+        report.status = ChildStatus::OutOfMemory;
+    }
+    catch (...)
+    {
+        report.status = ChildStatus::Error;
+    }
+
+    auto written = write(fd, &report, sizeof(report));
+    _exit(written == sizeof(report) ? 0 : 1);
+}
+
+struct Running {
+    size_t index;
+    pid_t pid;
+    int fd;
+    std::chrono::steady_clock::time_point start;
+    bool killed = false;
+};
+
+std::string statusName(ChildStatus status)
+{
+    switch (status)
+    {
+        case ChildStatus::Ok:
+            return "ok";
+        case ChildStatus::NoPath:
+            return "no-path";
+        case ChildStatus::Invalid:
+            return "invalid";
+        case ChildStatus::OutOfMemory:
+            return "out-of-memory";
+        case ChildStatus::Error:
+            return "error";
+    }
+    return "error";
+}
+
+void collect(Running& task, int waitStatus, const rusage& usage, BatchResult& result)
+{
+    using namespace std::chrono;
+    result.wallTime = duration<double>(steady_clock::now() - task.start).count();
+    result.peakRss = usage.ru_maxrss;
+
+    ChildReport report;
+    bool reported = read(task.fd, &report, sizeof(report)) == sizeof(report);
+    close(task.fd);
+
+    if (task.killed)
+        result.status = "timeout";
+    else if (!reported || !WIFEXITED(waitStatus))
+        result.status = "error";
+    else
+    {
+        result.status = statusName(report.status);
+        result.stat.pathLength = report.pathLength;
+        result.stat.queueSize = report.queueSize;
+        result.stat.seenCfgs = report.seenCfgs;
+    }
+}
+
+} // namespace
+
+std::vector<BatchResult> runBatch(const std::vector<BatchTask>& tasks, const BatchOptions& opts)
+{
+    using namespace std::chrono;
+    std::vector<BatchResult> results(tasks.size());
+    std::vector<Running> running;
+    size_t nextTask = 0;
+    unsigned jobs = std::max(1u, opts.jobs);
+
+    while (nextTask < tasks.size() || !running.empty())
+    {
+        while (nextTask < tasks.size() && running.size() < jobs)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+                throw std::runtime_error("Could not create a pipe for a batch task");
+            // Reports are tiny, so the child never blocks on a full pipe.
+            pid_t pid = fork();
+            if (pid < 0)
+                throw std::runtime_error("Could not fork a batch task");
+            if (pid == 0)
+            {
+                close(fds[0]);
+                runChild(tasks[nextTask], opts, fds[1]);
+            }
+            close(fds[1]);
+            running.push_back({nextTask, pid, fds[0], steady_clock::now()});
+            ++nextTask;
+        }
+
+        bool finished = false;
+        for (auto it = running.begin(); it != running.end();)
+        {
+            int waitStatus = 0;
+            rusage usage{};
+            if (wait4(it->pid, &waitStatus, WNOHANG, &usage) == it->pid)
+            {
+                collect(*it, waitStatus, usage, results[it->index]);
+                it = running.erase(it);
+                finished = true;
+                continue;
+            }
+            if (!it->killed && opts.timeout > 0
+                && duration<double>(steady_clock::now() - it->start).count() > opts.timeout)
+            {
+                kill(it->pid, SIGKILL);
+                it->killed = true;
+            }
+            ++it;
+        }
+        if (!finished)
+            std::this_thread::sleep_for(milliseconds(10));
+    }
+    return results;
+}
+
+void writeResultsJson(std::ostream& out, const std::vector<BatchTask>& tasks,
+    const std::vector<BatchResult>& results)
+{
+    auto json = nlohmann::json::array();
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        const auto& task = tasks[i];
+        const auto& res = results[i];
+        json.push_back({
+            {"init", task.init},
+            {"goal", task.goal},
+            {"algorithm", algorithmName(task.alg)},
+            {"eval", task.eval},
+            {"step", task.step},
+            {"bound", task.bound},
+            {"status", res.status},
+            {"pathLength", res.stat.pathLength},
+            {"storedConfigurations", res.stat.seenCfgs},
+            {"peakQueue", res.stat.queueSize},
+            {"wallTime", res.wallTime},
+            {"peakRssKiB", res.peakRss}
+        });
+    }
+    out << std::setw(4) << json << "\n";
+}
+
+namespace {
+
+// Quotes a field with a comma, quote or line break, doubling its quotes (RFC 4180)
+std::string csvField(const std::string& field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string::npos)
+        return field;
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+} // namespace
+
+void writeResultsCsv(std::ostream& out, const std::vector<BatchTask>& tasks,
+    const std::vector<BatchResult>& results)
+{
+    out << "init,goal,algorithm,eval,step,bound,status,pathLength,storedConfigurations,peakQueue,wallTime,peakRssKiB\n";
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        const auto& task = tasks[i];
+        const auto& res = results[i];
+        out << csvField(task.init) << ',' << csvField(task.goal) << ',' << algorithmName(task.alg) << ','
+            << task.eval << ',' << task.step << ',' << task.bound << ','
+            << res.status << ',' << res.stat.pathLength << ',' << res.stat.seenCfgs << ','
+            << res.stat.queueSize << ',' << res.wallTime << ',' << res.peakRss << '\n';
+    }
+}
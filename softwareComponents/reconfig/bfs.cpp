@@ -33,9 +33,9 @@ std::vector<Configuration> BFS(const Configuration& init, const Configuration& g
 
         for (const auto& next : nextCfgs)
         {
-            if (!pool.has(next))
+            auto [pointerNext, inserted] = pool.insert_or_get(next);
+            if (inserted)
             {
-                const Configuration* pointerNext = pool.insert(next);
                 pred.insert({pointerNext, current});
 
                 if (next == goal)
@@ -0,0 +1,125 @@
+#include "Algorithms.h"
+#include "Fingerprint.h"
+
+namespace {
+
+struct OpenCfg {
+    Configuration cfg;
+    Fingerprint fp;
+    uint32_t dist;
+};
+
+void fillStat(AlgorithmStat* stat, unsigned long pathLength, unsigned long maxQSize, const ClosedSet& closed)
+{
+    if (stat == nullptr)
+        return;
+    stat->pathLength = pathLength;
+    stat->queueSize = maxQSize;
+    stat->seenCfgs = closed.size();
+}
+
+} // namespace
+
+std::vector<Configuration> CompactBFS(const Configuration& init, const Configuration& goal,
+    unsigned step /*= 90*/, unsigned bound /*= 1*/, AlgorithmStat* stat /*= nullptr*/)
+{
+    if (init == goal)
+    {
+        return {init};
+    }
+
+    ClosedSet closed(step, bound);
+    unsigned long maxQSize = 0;
+
+    Fingerprint initFp = fingerprint(init);
+    closed.insertRoot(initFp);
+
+    std::queue<OpenCfg> queue;
+    queue.push({init, initFp, 0});
+
+    while (!queue.empty())
+    {
+        maxQSize = std::max(maxQSize, queue.size());
+        OpenCfg current = std::move(queue.front());
+        queue.pop();
+
+        std::vector<Configuration> nextCfgs;
+        next(current.cfg, nextCfgs, step, bound);
+
+        for (uint32_t i = 0; i < nextCfgs.size(); ++i)
+        {
+            Fingerprint fp = fingerprint(nextCfgs[i]);
+            if (!closed.relax(fp, current.fp, i, current.dist + 1))
+                continue;
+
+            if (nextCfgs[i] == goal)
+            {
+                auto path = closed.path(init, fp);
+                fillStat(stat, path.size(), maxQSize, closed);
+                return path;
+            }
+            queue.push({std::move(nextCfgs[i]), fp, current.dist + 1});
+        }
+    }
+    fillStat(stat, 0, maxQSize, closed);
+    return {};
+}
+
+std::vector<Configuration> CompactAStar(const Configuration& init, const Configuration& goal,
+    unsigned step /*= 90*/, unsigned bound /*= 1*/, EvalFunction& eval /*= Eval::trivial*/,
+    AlgorithmStat* stat /*= nullptr*/)
+{
+    if (init == goal)
+    {
+        return {init};
+    }
+
+    ClosedSet closed(step, bound);
+    unsigned long maxQSize = 0;
+
+    // Open configurations are owned by the heap; the closed set keeps
+    // only fingerprints.
+    std::vector<std::pair<double, OpenCfg>> open;
+    auto compare = [](const auto& a, const auto& b) { return a.first > b.first; };
+    auto push = [&](OpenCfg cfg, double value) {
+        open.emplace_back(value, std::move(cfg));
+        std::push_heap(open.begin(), open.end(), compare);
+    };
+
+    Fingerprint initFp = fingerprint(init);
+    closed.insertRoot(initFp);
+    push({init, initFp, 0}, eval(init, goal));
+
+    while (!open.empty())
+    {
+        maxQSize = std::max(maxQSize, open.size());
+        std::pop_heap(open.begin(), open.end(), compare);
+        OpenCfg current = std::move(open.back().second);
+        open.pop_back();
+
+        // Skip entries superseded by a shorter path pushed later.
+        if (closed.find(current.fp)->dist != current.dist)
+            continue;
+
+        std::vector<Configuration> nextCfgs;
+        next(current.cfg, nextCfgs, step, bound);
+
+        for (uint32_t i = 0; i < nextCfgs.size(); ++i)
+        {
+            Fingerprint fp = fingerprint(nextCfgs[i]);
+            if (!closed.relax(fp, current.fp, i, current.dist + 1))
+                continue;
+
+            if (nextCfgs[i] == goal)
+            {
+                auto path = closed.path(init, fp);
+                fillStat(stat, path.size(), maxQSize, closed);
+                return path;
+            }
+            double value = current.dist + 1 + eval(nextCfgs[i], goal);
+            push({std::move(nextCfgs[i]), fp, current.dist + 1}, value);
+        }
+    }
+    fillStat(stat, 0, maxQSize, closed);
+    return {};
+}
@@ -0,0 +1,287 @@
+#include "Algorithms.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+/* HASH-DISTRIBUTED A*
+ *
+ * Every configuration is owned by exactly one worker, chosen by its hash.
+ * A worker keeps the pool, distances and open list of the configurations
+ * it owns; successors owned by someone else are sent to the owner through
+ * its inbox. The search stops once no worker can expand a node cheaper
+ * than the best path found so far and no message is in flight. An idle
+ * worker sleeps until a message arrives or the search is over.
+ * */
+
+namespace {
+
+/**
+ * \brief Multi-producer single-consumer queue.
+ *
+ * Producers push with a single CAS on the head; the consumer takes
+ * the whole list at once and restores the push order.
+ */
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        Cell* cell = head.load(std::memory_order_acquire);
+        while (cell != nullptr) {
+            Cell* next = cell->next;
+            delete cell;
+            cell = next;
+        }
+    }
+
+    void push(T value) {
+        Cell* cell = new Cell{std::move(value), head.load(std::memory_order_relaxed)};
+        while (!head.compare_exchange_weak(cell->next, cell,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    void takeAll(std::vector<T>& res) {
+        Cell* cell = head.exchange(nullptr, std::memory_order_acquire);
+        auto first = res.size();
+        while (cell != nullptr) {
+            res.push_back(std::move(cell->value));
+            Cell* next = cell->next;
+            delete cell;
+            cell = next;
+        }
+        std::reverse(res.begin() + static_cast<std::ptrdiff_t>(first), res.end());
+    }
+
+private:
+    struct Cell {
+        T value;
+        Cell* next;
+    };
+
+    std::atomic<Cell*> head{nullptr};
+};
+
+struct Message {
+    Configuration cfg;
+    unsigned long dist;
+    const Configuration* pred;
+};
+
+struct Worker {
+    ConfigPool pool;
+    ConfigPred pred;
+    std::unordered_map<const Configuration*, unsigned long> initDist;
+    std::priority_queue<EvalPair, std::vector<EvalPair>, EvalCompare> queue;
+    MpscQueue<Message> inbox;
+    unsigned long maxQSize = 0;
+
+    // Guards the sleep of an idle worker; senders take it before
+    // notifying, so a push cannot slip in between the check and the wait.
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+};
+
+class ParallelSearch {
+public:
+    ParallelSearch(const Configuration& goal, unsigned step, unsigned bound,
+        EvalFunction& eval, unsigned threads)
+        : goal(goal), step(step), bound(bound), eval(eval), workers(threads)
+    {
+        for (auto& w : workers)
+            w = std::make_unique<Worker>();
+    }
+
+    std::vector<Configuration> run(const Configuration& init, AlgorithmStat* stat) {
+        auto& initOwner = *workers[owner(init)];
+        const Configuration* pointer = initOwner.pool.insert(init);
+        initOwner.initDist[pointer] = 0;
+        initOwner.pred[pointer] = pointer;
+        initOwner.queue.push({eval(init, goal), pointer});
+
+        work = workers.size();
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers.size(); ++i)
+            threads.emplace_back([this, i]{ loop(i); });
+        for (auto& t : threads)
+            t.join();
+
+        std::vector<Configuration> path;
+        if (goalPtr != nullptr) {
+            ConfigPred pred;
+            for (auto& w : workers)
+                pred.insert(w->pred.begin(), w->pred.end());
+            path = createPath(pred, goalPtr);
+        }
+
+        if (stat != nullptr) {
+            stat->pathLength = path.size();
+            stat->queueSize = 0;
+            stat->seenCfgs = 0;
+            for (auto& w : workers) {
+                stat->queueSize = std::max(stat->queueSize, w->maxQSize);
+                stat->seenCfgs += w->pool.size();
+            }
+        }
+        return path;
+    }
+
+private:
+    size_t owner(const Configuration& cfg) const {
+        // ConfigurationHash is a plain sum; mix it so that similar
+        // configurations spread over all workers.
+        uint64_t h = ConfigurationHash{}(cfg);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h % workers.size());
+    }
+
+    void offerGoal(const Configuration* cfg, unsigned long dist) {
+        std::lock_guard<std::mutex> lock(goalMutex);
+        if (dist < incumbent.load(std::memory_order_relaxed)) {
+            goalPtr = cfg;
+            incumbent.store(dist, std::memory_order_release);
+        }
+    }
+
+    void receive(Worker& self, Message& msg) {
+        auto [pointer, inserted] = self.pool.insert_or_get(msg.cfg);
+        if (!inserted && self.initDist[pointer] <= msg.dist)
+            return;
+
+        self.initDist[pointer] = msg.dist;
+        self.pred[pointer] = msg.pred;
+        if (*pointer == goal) {
+            offerGoal(pointer, msg.dist);
+            return;
+        }
+        self.queue.push({double(msg.dist) + eval(*pointer, goal), pointer});
+    }
+
+    void expand(size_t id, const Configuration* current) {
+        Worker& self = *workers[id];
+        unsigned long dist = self.initDist[current] + 1;
+        if (dist >= incumbent.load(std::memory_order_acquire))
+            return;
+
+        std::vector<Configuration> nextCfgs;
+        next(*current, nextCfgs, step, bound);
+        for (auto& cfg : nextCfgs) {
+            Message msg{std::move(cfg), dist, current};
+            size_t target = owner(msg.cfg);
+            if (target == id) {
+                receive(self, msg);
+                continue;
+            }
+            work.fetch_add(1, std::memory_order_acq_rel);
+            deliver(*workers[target], std::move(msg));
+        }
+    }
+
+    void deliver(Worker& target, Message msg) {
+        target.inbox.push(std::move(msg));
+        { std::lock_guard<std::mutex> lock(target.sleepMutex); }
+        target.wakeup.notify_one();
+    }
+
+    void wakeAll() {
+        for (auto& w : workers) {
+            { std::lock_guard<std::mutex> lock(w->sleepMutex); }
+            w->wakeup.notify_one();
+        }
+    }
+
+    void loop(size_t id) {
+        Worker& self = *workers[id];
+        bool active = true;
+        std::vector<Message> received;
+
+        while (true) {
+            if (!self.inbox.empty()) {
+                if (!active) {
+                    work.fetch_add(1, std::memory_order_acq_rel);
+                    active = true;
+                }
+                received.clear();
+                self.inbox.takeAll(received);
+                for (auto& msg : received)
+                    receive(self, msg);
+                work.fetch_sub(received.size(), std::memory_order_acq_rel);
+            }
+
+            self.maxQSize = std::max(self.maxQSize, self.queue.size());
+            if (!self.queue.empty()) {
+                auto [d, current] = self.queue.top();
+                if (d < double(incumbent.load(std::memory_order_acquire))) {
+                    self.queue.pop();
+                    expand(id, current);
+                    continue;
+                }
+            }
+
+            if (active) {
+                active = false;
+                // Only the last worker to go idle can finish the search
+                if (work.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    wakeAll();
+            }
+            std::unique_lock<std::mutex> lock(self.sleepMutex);
+            self.wakeup.wait(lock, [&]{
+                return !self.inbox.empty()
+                    || work.load(std::memory_order_acquire) == 0;
+            });
+            if (self.inbox.empty())
+                return;
+        }
+    }
+
+    const Configuration& goal;
+    unsigned step;
+    unsigned bound;
+    EvalFunction& eval;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Active workers plus messages in flight; the search is over when
+    // it drops to zero, since nothing can raise it again.
+    std::atomic<size_t> work{0};
+
+    std::atomic<unsigned long> incumbent{std::numeric_limits<unsigned long>::max()};
+    std::mutex goalMutex;
+    const Configuration* goalPtr = nullptr;
+};
+
+} // namespace
+
+std::vector<Configuration> ParallelAStar(const Configuration& init,
+    const Configuration& goal, unsigned step /*= 90*/, unsigned bound /*= 1*/,
+    EvalFunction& eval /*= Eval::trivial*/, unsigned threads /*= 0*/,
+    AlgorithmStat* stat /*= nullptr*/)
+{
+    if (init == goal)
+    {
+        if (stat != nullptr)
+        {
+            stat->pathLength = 1;
+            stat->queueSize = 0;
+            stat->seenCfgs = 1;
+        }
+        return {init};
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    ParallelSearch search(goal, step, bound, eval, threads);
+    return search.run(init, stat);
+}
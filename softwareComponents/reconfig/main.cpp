@@ -1,21 +1,25 @@
+#include <filesystem>
 #include <fstream>
 #include <cxxopts.hpp>
 #include <legacy/configuration/Configuration.h>
 #include <legacy/configuration/IO.h>
 #include "Algorithms.h"
+#include "Batch.h"
 
 using namespace IO;
 
-enum class Algorithm
-{
-    BFS, AStar, RRT
-};
-
 std::ifstream initInput, goalInput;
 unsigned step = 90;
 unsigned bound = 1;
+unsigned threads = 1;
+unsigned successorThreads = 1;
+SearchLimits limits;
+bool anytime = false;
+bool compact = false;
 Algorithm alg = Algorithm::BFS;
 EvalFunction* eval = Eval::trivial;
+std::string batchPath, outputPath;
+BatchOptions batchOpts;
 
 void parse(int argc, char* argv[])
 {
@@ -30,6 +34,17 @@ void parse(int argc, char* argv[])
             ("a,alg", "Algorithm for reconfiguration: bfs, astar, rrt", cxxopts::value<std::string>())
             ("e,eval", "Evaluation function for A* algorithm: dMatrix, dCenter, dJoint, dAction, trivial", cxxopts::value<std::string>())
             ("p,parallel", "How many parallel actions are allowed: <1,...>", cxxopts::value<unsigned>())
+            ("t,threads", "Number of threads for A* algorithm, 0 for all cores: <0,...>", cxxopts::value<unsigned>())
+            ("w,workers", "Number of threads checking successor configurations, 0 for all cores: <0,...>", cxxopts::value<unsigned>())
+            ("compact", "Keep only fingerprints of visited configurations (bfs, astar on one thread)")
+            ("time-budget", "Stop A* or RRT after this many seconds and print the best partial path", cxxopts::value<double>())
+            ("node-budget", "Stop A* or RRT after storing this many configurations and print the best partial path", cxxopts::value<unsigned long>())
+            ("progress", "Print search progress of A* or RRT to standard error every second")
+            ("b,batch", "Manifest of queries to run instead of '-i' and '-g'", cxxopts::value<std::string>())
+            ("j,jobs", "Number of batch queries running at once: <1,...>", cxxopts::value<unsigned>())
+            ("timeout", "Time limit of one batch query in seconds, 0 for none", cxxopts::value<double>())
+            ("memory", "Memory limit of one batch query in MiB, 0 for none", cxxopts::value<unsigned long>())
+            ("o,output", "File for batch results, .json or .csv (default JSON to standard output)", cxxopts::value<std::string>())
             ;
 
     try {
@@ -40,6 +55,39 @@ void parse(int argc, char* argv[])
             exit(0);
         }
 
+        if (result.count("batch") == 1) {
+            batchPath = result["batch"].as< std::string >();
+            if (result.count("init") != 0 || result.count("goal") != 0) {
+                std::cerr << "The option '--batch' cannot be combined with '--init' or '--goal'.\n";
+                exit(0);
+            }
+            // Step, algorithm, evaluation and bound come from the manifest
+            for (const char* name : {"step", "alg", "eval", "parallel", "compact",
+                                     "time-budget", "node-budget", "progress"}) {
+                if (result.count(name) != 0) {
+                    std::cerr << "The option '--" << name << "' is not available with '--batch'.\n";
+                    exit(0);
+                }
+            }
+            if (result.count("jobs") == 1)
+                batchOpts.jobs = std::max(1u, result["jobs"].as<unsigned>());
+            if (result.count("threads") == 1)
+                batchOpts.threads = result["threads"].as<unsigned>();
+            if (result.count("workers") == 1)
+                batchOpts.workers = result["workers"].as<unsigned>();
+            if (result.count("timeout") == 1)
+                batchOpts.timeout = result["timeout"].as<double>();
+            if (result.count("memory") == 1)
+                batchOpts.memoryLimit = result["memory"].as<unsigned long>();
+            if (result.count("output") == 1)
+                outputPath = result["output"].as< std::string >();
+            return;
+        }
+        if (result.count("batch") > 1) {
+            std::cerr << "There can be at most one '-b' or '--batch' option.\n";
+            exit(0);
+        }
+
         if (result.count("init") == 1) {
             std::string initPath(result["init"].as< std::string >());
             initInput.open(initPath);
@@ -80,23 +128,12 @@ void parse(int argc, char* argv[])
 
         if (result.count("alg") == 1) {
             std::string val = result["alg"].as< std::string >();
-            bool valid = false;
-            if ((val == "bfs") || (val == "BFS")) {
-                alg = Algorithm::BFS;
-                valid = true;
-            }
-            if ((val == "astar") || (val == "AStar")) {
-                alg = Algorithm::AStar;
-                valid = true;
-            }
-            if ((val == "rrt") || (val == "RRT")) {
-                alg = Algorithm::RRT;
-                valid = true;
-            }
-            if (!valid) {
+            auto parsed = parseAlgorithm(val);
+            if (!parsed.has_value()) {
                 std::cerr << "Not a valid argument for option '-a', '--alg': " << val << ".\n";
                 exit(0);
             }
+            alg = parsed.value();
         } else {
             if (result.count("alg") > 1) {
                 std::cerr << "There can be at most one '-a' or '--alg' option.\n";
@@ -112,28 +149,8 @@ void parse(int argc, char* argv[])
                 exit(0);
             }
             std::string val = result["eval"].as< std::string >();
-            bool valid = false;
-            if (val == "dCenter") {
-                eval = &Eval::centerDiff;
-                valid = true;
-            }
-            if (val == "dJoint") {
-                eval = &Eval::jointDiff;
-                valid = true;
-            }
-            if (val == "dMatrix") {
-                eval = &Eval::matrixDiff;
-                valid = true;
-            }
-            if (val == "dAction") {
-                eval = &Eval::actionDiff;
-                valid = true;
-            }
-            if (val == "trivial") {
-                eval = &Eval::trivial;
-                valid = true;
-            }
-            if (!valid) {
+            eval = parseEval(val);
+            if (eval == nullptr) {
                 std::cerr << "Not a valid argument for option '-e', '--eval': " << val << ".\n";
                 exit(0);
             }
@@ -159,6 +176,61 @@ void parse(int argc, char* argv[])
                 exit(0);
             }
         }
+
+        if (result.count("threads") == 1)
+        {
+            if (alg != Algorithm::AStar)
+            {
+                std::cerr << "The option '--threads' is available only with the option '--alg astar'.\n";
+                exit(0);
+            }
+            threads = result["threads"].as<unsigned>();
+        } else {
+            if (result.count("threads") > 1) {
+                std::cerr << "There can be at most one '-t' or '--threads' option.\n";
+                exit(0);
+            }
+        }
+
+        if (result.count("workers") == 1)
+        {
+            successorThreads = result["workers"].as<unsigned>();
+        } else {
+            if (result.count("workers") > 1) {
+                std::cerr << "There can be at most one '-w' or '--workers' option.\n";
+                exit(0);
+            }
+        }
+
+        if (result.count("time-budget") == 1) {
+            limits.timeBudget = result["time-budget"].as<double>();
+            anytime = true;
+        }
+        if (result.count("node-budget") == 1) {
+            limits.nodeBudget = result["node-budget"].as<unsigned long>();
+            anytime = true;
+        }
+        if (result.count("progress") != 0) {
+            limits.onProgress = [](const SearchProgress& p) {
+                std::cerr << "[" << std::fixed << std::setprecision(1) << p.elapsed << "s] "
+                          << "expanded " << p.expanded << ", cfgs " << p.seenCfgs
+                          << ", queue " << p.queueSize << ", best " << p.bestEval << "\n";
+            };
+            anytime = true;
+        }
+        if (result.count("compact") != 0) {
+            if (alg == Algorithm::RRT || threads != 1 || anytime) {
+                std::cerr << "The option '--compact' is available only with the option '--alg bfs' or"
+                          << " with '--alg astar' on one thread and without budgets.\n";
+                exit(0);
+            }
+            compact = true;
+        }
+        if (anytime && (alg == Algorithm::BFS || (alg == Algorithm::AStar && threads != 1))) {
+            std::cerr << "The options '--time-budget', '--node-budget' and '--progress' are available only with"
+                      << " the option '--alg rrt' or with '--alg astar' on one thread.\n";
+            exit(0);
+        }
     }
     catch ( cxxopts::exceptions::exception & e )
     {
@@ -167,10 +239,53 @@ void parse(int argc, char* argv[])
     }
 }
 
+int runBatchMode()
+{
+    std::ifstream manifest(batchPath);
+    if (!manifest.good())
+    {
+        std::cerr << "Coult not open file " << batchPath << ".\n";
+        return 0;
+    }
+
+    std::vector<BatchTask> tasks;
+    try
+    {
+        tasks = readManifest(manifest, std::filesystem::path(batchPath).parent_path().string());
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 0;
+    }
+
+    auto results = runBatch(tasks, batchOpts);
+
+    if (outputPath.empty())
+    {
+        writeResultsJson(std::cout, tasks, results);
+        return 0;
+    }
+    std::ofstream output(outputPath);
+    if (!output.good())
+    {
+        std::cerr << "Coult not open file " << outputPath << ".\n";
+        return 0;
+    }
+    if (std::filesystem::path(outputPath).extension() == ".csv")
+        writeResultsCsv(output, tasks, results);
+    else
+        writeResultsJson(output, tasks, results);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     parse(argc, argv);
 
+    if (!batchPath.empty())
+        return runBatchMode();
+
     Configuration init, goal;
 
     bool ok = true;
@@ -200,24 +315,42 @@ int main(int argc, char* argv[])
     }
 
 
+    setSuccessorThreads(successorThreads);
+
     std::vector<Configuration> path;
     AlgorithmStat stat;
     switch (alg)
     {
         case Algorithm::BFS:
-            path = BFS(init, goal, step, bound, &stat);
+            if (compact)
+                path = CompactBFS(init, goal, step, bound, &stat);
+            else
+                path = BFS(init, goal, step, bound, &stat);
             break;
         case Algorithm::AStar:
-            path = AStar(init, goal, step, bound, *eval, &stat);
+            if (compact)
+                path = CompactAStar(init, goal, step, bound, *eval, &stat);
+            else if (anytime)
+                path = AStar(init, goal, step, bound, *eval, limits, &stat);
+            else if (threads == 1)
+                path = AStar(init, goal, step, bound, *eval, &stat);
+            else
+                path = ParallelAStar(init, goal, step, bound, *eval, threads, &stat);
             break;
         case Algorithm::RRT:
-            path = RRT(init, goal, step, &stat);
+            path = anytime ? RRT(init, goal, step, limits, &stat) : RRT(init, goal, step, &stat);
             break;
     }
 
     std::cout << toString(path);
     std::cout << stat.toString();
 
+    if (stat.partial)
+    {
+        std::cout << "The search budget ran out; the path ends in the configuration closest to the goal.\n";
+        return 0;
+    }
+
     if (path.empty())
     {
         std::cout << "Could not find a path with given parameters from initial to goal configuration.\n";
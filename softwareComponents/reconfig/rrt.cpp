@@ -1,4 +1,5 @@
 #include "Algorithms.h"
+#include "VpTree.h"
 #include "test/test_rrt.h"
 
 namespace Distance
@@ -152,9 +153,9 @@ inline Configuration sampleFree(const std::vector<ID>& ids)
     return cfg;
 }
 
-inline const Configuration* getCfg(const std::unique_ptr<Configuration>& ptr)
+inline const Configuration* getCfg(const ConfigPool::Entry& entry)
 {
-    return ptr.get();
+    return entry.cfg.get();
 }
 
 inline const Configuration* getCfg(const Configuration& cfg)
@@ -166,19 +167,25 @@ inline const Configuration* getCfg(const Configuration& cfg)
 inline const Configuration* addToTree(ConfigPool& pool, ConfigEdges& edges,
     const Configuration* from, const Configuration& to)
 {
-    if (!pool.has(to))
+    auto [nextPtr, inserted] = pool.insert_or_get(to);
+    if (inserted)
     {
-        auto nextPtr = pool.insert(to);
         edges[nextPtr] = {};
 
         edges[from].push_back(nextPtr);
         edges[nextPtr].push_back(from);
-        return nextPtr;
-    }
-    else
-    {
-        return pool.get(to);
     }
+    return nextPtr;
+}
+
+inline const Configuration* addToTree(ConfigPool& pool, ConfigEdges& edges, VpTree& index,
+    const Configuration* from, const Configuration& to)
+{
+    auto poolSize = pool.size();
+    auto nextPtr = addToTree(pool, edges, from, to);
+    if (pool.size() != poolSize)
+        index.insert(nextPtr);
+    return nextPtr;
 }
 
 template<typename T>
@@ -223,20 +230,23 @@ inline Configuration steer(const Configuration& from, const Configuration& to, D
     double minDistance = dist(from, to);
     Configuration minCfg = from;
 
+    std::vector<Action> actions;
     for (auto& rot : subRot)
     {
         for (auto& rec : subRec)
         {
-            auto valid = executeIfValid(from, {rot, rec});
-            if (valid.has_value())
-            {
-                double newDistance = dist(from, valid.value());
-                if (newDistance < minDistance)
-                {
-                    minDistance = newDistance;
-                    minCfg = valid.value();
-                }
-            }
+            actions.emplace_back(rot, rec);
+        }
+    }
+    std::vector<Configuration> valid;
+    executeAllIfValid(from, actions, valid);
+    for (auto& cfg : valid)
+    {
+        double newDistance = dist(from, cfg);
+        if (newDistance < minDistance)
+        {
+            minDistance = newDistance;
+            minCfg = cfg;
         }
     }
     return minCfg;
@@ -361,14 +371,14 @@ inline void extendEdge(ConfigPool& pool, ConfigEdges& edges, const Configuration
     }
 }
 
-inline void extendPath(ConfigPool& pool, ConfigEdges& edges, const Configuration& cfg, unsigned step,
-    DistFunction* dist = Eval::matrixDiff)
+inline void extendPath(ConfigPool& pool, ConfigEdges& edges, VpTree& index,
+    const Configuration& cfg, unsigned step)
 {
-    const Configuration* near = nearest(cfg, pool, dist);
+    const Configuration* near = index.nearest(cfg);
     auto newPath = steerPath(*near, cfg, step);
     for (auto& newCfg : newPath)
     {
-        near = addToTree(pool, edges, near, newCfg);
+        near = addToTree(pool, edges, index, near, newCfg);
     }
 }
 
@@ -414,36 +424,53 @@ inline void extend2(ConfigPool& pool, ConfigEdges& edges, const Configuration& c
 
 std::vector<Configuration> RRT(const Configuration& init, const Configuration& goal,
     unsigned step /*= 90*/, AlgorithmStat* stat /*= nullptr*/)
+{
+    return RRT(init, goal, step, SearchLimits{}, stat);
+}
+
+std::vector<Configuration> RRT(const Configuration& init, const Configuration& goal,
+    unsigned step, const SearchLimits& limits, AlgorithmStat* stat /*= nullptr*/)
 {
     ConfigPool pool;
     ConfigEdges edges;
+    VpTree index(Eval::matrixDiff);
+    SearchBudget budget(limits);
 
     auto initPtr = pool.insert(init);
+    index.insert(initPtr);
 
-    while(true)
+    unsigned long iterations = 0;
+    bool partial = false;
+    while (!pool.has(goal))
     {
-        Configuration rand = sampleFree(init.getIDs());
+        if (budget.exhausted(pool.size()))
+        {
+            partial = true;
+            break;
+        }
+        if (budget.reportDue())
+        {
+            double bestEval = Eval::matrixDiff(*index.nearest(goal), goal);
+            budget.report({iterations, pool.size(), 0, bestEval});
+        }
 
-        extendPath(pool, edges, rand, step);
-        extendPath(pool, edges, goal, step);
+        Configuration rand = sampleFree(init.getIDs());
 
-        if (pool.has(goal))
-            break;
+        extendPath(pool, edges, index, rand, step);
+        extendPath(pool, edges, index, goal, step);
+        ++iterations;
     }
 
-    stat->queueSize = 0;
-    stat->seenCfgs = pool.size();
-    if (pool.has(goal))
+    // Without a budget the loop only ends at the goal; with one, the path
+    // leads to the tree node nearest to the goal.
+    const Configuration* end = partial ? index.nearest(goal) : pool.get(goal);
+    auto path = createPath(edges, initPtr, end);
+    if (stat != nullptr)
     {
-        const Configuration * goalPtr = pool.get(goal);
-        auto path = createPath(edges, initPtr, goalPtr);
-        if (stat != nullptr)
-        {
-            stat->pathLength = path.size();
-        }
-
-        return path;
+        stat->pathLength = path.size();
+        stat->queueSize = 0;
+        stat->seenCfgs = pool.size();
+        stat->partial = partial;
     }
-    stat->pathLength = 0;
-    return {};
+    return path;
 }
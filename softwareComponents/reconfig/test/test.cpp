@@ -1,6 +1,17 @@
 #include <catch2/catch.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <utility>
+#include <unistd.h>
 #include <legacy/configuration/Configuration.h>
 #include <legacy/configuration/Generators.h>
+#include "Algorithms.h"
+#include "Batch.h"
+#include "Fingerprint.h"
+#include "VpTree.h"
 #include "test_rrt.h"
 
 TEST_CASE("Connections")
@@ -391,3 +402,463 @@ TEST_CASE("Bugfix test -- disconnected double connected modules") {
     cfg.removeEdge({1, A, ZMinus, East, XPlus, B, 21});
     REQUIRE(!cfg.isValid());
 }
+
+TEST_CASE("Config pool deduplicates configurations") {
+    Configuration cfg;
+    cfg.addModule(0, 0, 0, 0);
+    cfg.addModule(0, 0, 0, 1);
+    cfg.addEdge({0, A, XPlus, North, XPlus, A, 1});
+
+    ConfigPool pool;
+    auto [first, inserted] = pool.insert_or_get(cfg);
+    REQUIRE(inserted);
+    REQUIRE(*first == cfg);
+
+    Configuration copy = cfg;
+    auto [second, insertedAgain] = pool.insert_or_get(copy);
+    REQUIRE(!insertedAgain);
+    REQUIRE(second == first);
+    REQUIRE(pool.get(copy) == first);
+    REQUIRE(pool.size() == 1);
+
+    Configuration other = cfg;
+    other.getModules().at(1).setJoint(Joint::Gamma, 90);
+    REQUIRE(!pool.has(other));
+    REQUIRE(pool.get(other) == nullptr);
+    REQUIRE(pool.insert(other) != first);
+    REQUIRE(pool.size() == 2);
+}
+
+TEST_CASE("Configuration does not depend on module insertion order") {
+    Configuration cfg1;
+    cfg1.addModule(0, 0, 0, 3);
+    cfg1.addModule(0, 90, 0, 1);
+    cfg1.addModule(0, 0, 90, 2);
+    cfg1.addEdge({3, A, XPlus, North, ZMinus, B, 1});
+    cfg1.addEdge({1, A, XPlus, North, ZMinus, B, 2});
+
+    Configuration cfg2;
+    cfg2.addModule(0, 0, 90, 2);
+    cfg2.addModule(0, 0, 0, 3);
+    cfg2.addModule(0, 90, 0, 1);
+    cfg2.addEdge({1, A, XPlus, North, ZMinus, B, 2});
+    cfg2.addEdge({3, A, XPlus, North, ZMinus, B, 1});
+
+    REQUIRE(cfg1 == cfg2);
+    REQUIRE(ConfigurationHash{}(cfg1) == ConfigurationHash{}(cfg2));
+    REQUIRE(cfg1.getIDs() == std::vector<ID>{1, 2, 3});
+
+    Configuration copy = cfg1;
+    REQUIRE(copy == cfg1);
+    copy.getModule(2).setJoint(Beta, 90);
+    REQUIRE(copy != cfg1);
+}
+
+TEST_CASE("Vantage-point tree finds the nearest configuration") {
+    std::vector<Configuration> cfgs;
+    for (int a : {-90, 0, 90}) {
+        for (int b : {-90, 0, 90}) {
+            for (int c : {-90, 0, 90, 180}) {
+                Configuration cfg;
+                cfg.addModule(a, b, c, 0);
+                cfg.addModule(b, c % 180, a, 1);
+                cfgs.push_back(cfg);
+            }
+        }
+    }
+
+    VpTree index(Eval::jointDiff);
+    for (const auto& cfg : cfgs)
+        index.insert(&cfg);
+    REQUIRE(index.size() == cfgs.size());
+
+    for (const auto& query : cfgs) {
+        Configuration shifted = query;
+        shifted.getModule(0).rotateJoint(Gamma, 30);
+        double best = Eval::jointDiff(shifted, cfgs.front());
+        for (const auto& cfg : cfgs)
+            best = std::min(best, Eval::jointDiff(shifted, cfg));
+        REQUIRE(Eval::jointDiff(shifted, *index.nearest(shifted)) == best);
+    }
+}
+
+static size_t distEvaluations = 0;
+
+static double countedJointDiff(const Configuration& curr, const Configuration& goal) {
+    ++distEvaluations;
+    return Eval::jointDiff(curr, goal);
+}
+
+TEST_CASE("Vantage-point tree stays balanced under RRT-like insertion") {
+    std::mt19937 random(42);
+    auto joint = [&](int limit) {
+        return static_cast<double>(static_cast<int>(random() % static_cast<unsigned>(2 * limit + 1)) - limit);
+    };
+
+    // RRT extends its nearest configuration by a short step towards a sample;
+    // repeated extensions towards the same sample grow a path away from the
+    // start, along which radii fixed by the first child are tiny.
+    const size_t count = 2000;
+    std::vector<std::unique_ptr<Configuration>> cfgs;
+    cfgs.push_back(std::make_unique<Configuration>());
+    cfgs.back()->addModule(-90, -90, 0, 0);
+    cfgs.back()->addModule(-90, -90, 0, 1);
+    VpTree index(countedJointDiff);
+    index.insert(cfgs.back().get());
+
+    distEvaluations = 0;
+    while (cfgs.size() < count) {
+        const Configuration& last = *cfgs.back();
+        auto next = std::make_unique<Configuration>(last);
+        for (ID id : {0, 1}) {
+            for (Joint j : {Alpha, Beta}) {
+                double step = 0.05 + std::abs(joint(5)) / 100;
+                next->getModule(id).setJoint(j, std::min(90.0, last.getModule(id).getJoint(j) + step));
+            }
+        }
+        index.insert(next.get());
+        cfgs.push_back(std::move(next));
+    }
+    REQUIRE(index.size() == count);
+    double logCount = std::log2(static_cast<double>(count));
+    // Amortized O(log^2 n) per insertion, a list would need O(n)
+    CHECK(static_cast<double>(distEvaluations) < static_cast<double>(count) * logCount * logCount);
+
+    distEvaluations = 0;
+    const int queries = 200;
+    for (int i = 0; i < queries; ++i) {
+        const Configuration& base = *cfgs[random() % cfgs.size()];
+        Configuration query = base;
+        query.getModule(0).setJoint(Gamma, joint(10));
+        const Configuration* nearest = index.nearest(query);
+
+        double best = std::numeric_limits<double>::infinity();
+        for (const auto& cfg : cfgs)
+            best = std::min(best, Eval::jointDiff(query, *cfg));
+        REQUIRE(Eval::jointDiff(query, *nearest) == Approx(best));
+    }
+    CHECK(static_cast<double>(distEvaluations) < queries * 8 * logCount);
+}
+
+TEST_CASE("Incremental validity matches full recomputation") {
+    Configuration config;
+    config.addModule(0, 90, 0, 0);
+    config.addModule(0, 0, 0, 1);
+    config.addModule(90, 0, 0, 2);
+    config.addModule(0, -90, 0, 3);
+    config.addModule(0, 0, 0, 4);
+    config.addModule(-90, 0, 0, 5);
+
+    REQUIRE(config.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(config.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(config.addEdge({2, B, ZMinus, 0, ZMinus, A, 3}));
+    REQUIRE(config.addEdge({3, B, ZMinus, 0, ZMinus, A, 4}));
+    REQUIRE(config.addEdge({4, B, ZMinus, 0, ZMinus, A, 5}));
+    REQUIRE(config.isValid());
+
+    std::unordered_map<ID, std::pair<ID, bool>> identity;
+    for (ID id : config.getIDs())
+        identity[id] = {id, false};
+
+    std::vector<Action::Rotate> rotations;
+    generateRotations(config, rotations, 90);
+    REQUIRE(!rotations.empty());
+    for (const auto& rotation : rotations) {
+        Configuration incremental = config;
+        if (!incremental.execute(Action(rotation)))
+            continue;
+        Configuration fresh = remappedConfig(incremental, identity);
+        REQUIRE(incremental.isValid() == fresh.isValid());
+    }
+
+    Configuration overlapping = config;
+    REQUIRE(overlapping.execute(Action(Action::Rotate{1, Beta, -90})));
+    REQUIRE(!overlapping.isValid());
+}
+
+// The quadratic check the shoe grid replaced
+static bool allPairsCollisionFree(const Configuration& config) {
+    std::vector<Matrix> shoes;
+    for (const auto& [id, ms] : config.getMatrices())
+        shoes.insert(shoes.end(), ms.begin(), ms.end());
+    for (size_t i = 0; i < shoes.size(); ++i) {
+        for (size_t j = i + 1; j < shoes.size(); ++j) {
+            if (centerSqDistance(shoes[i], shoes[j]) < 1)
+                return false;
+        }
+    }
+    return true;
+}
+
+static std::array<long, 3> gridCell(const Matrix& shoe) {
+    return { std::lround(std::floor(shoe(0, 3))),
+             std::lround(std::floor(shoe(1, 3))),
+             std::lround(std::floor(shoe(2, 3))) };
+}
+
+TEST_CASE("Shoe grid finds collisions across cells") {
+    // Shoe A of module 0 collides with shoe A of module 2 only
+    Configuration config;
+    config.addModule(-90, -60, 45, 0);
+    config.addModule(90, 90, 30, 1);
+    config.addModule(60, 60, 45, 2);
+    REQUIRE(config.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(config.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(config.computeMatrices());
+
+    const auto& matrices = config.getMatrices();
+    REQUIRE(centerSqDistance(matrices.at(0)[A], matrices.at(2)[A]) < 1);
+    REQUIRE(gridCell(matrices.at(0)[A]) != gridCell(matrices.at(2)[A]));
+    REQUIRE(!allPairsCollisionFree(config));
+
+    CHECK(!std::as_const(config).collisionFree());
+    CHECK(!config.collisionFree(std::vector<ID>{0}));
+    CHECK(!config.collisionFree(std::vector<ID>{2}));
+    // Module 1 is free, the collision of the other two is not checked
+    CHECK(config.collisionFree(std::vector<ID>{1}));
+    CHECK(config.collisionFree(std::vector<ID>{}));
+
+    std::vector<Action::Rotate> rotations;
+    generateRotations(config, rotations, 30);
+    REQUIRE(!rotations.empty());
+    for (const auto& rotation : rotations) {
+        Configuration rotated = config;
+        if (!rotated.execute(Action(rotation)) || !rotated.computeMatrices())
+            continue;
+        REQUIRE(std::as_const(rotated).collisionFree() == allPairsCollisionFree(rotated));
+    }
+}
+
+TEST_CASE("Parallel successor generation keeps the sequential order") {
+    Configuration config;
+    config.addModule(0, 90, 0, 0);
+    config.addModule(0, 0, 0, 1);
+    config.addModule(90, 0, 0, 2);
+    config.addModule(0, -90, 0, 3);
+    REQUIRE(config.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(config.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(config.addEdge({2, B, ZMinus, 0, ZMinus, A, 3}));
+    REQUIRE(config.isValid());
+
+    std::vector<Configuration> sequential;
+    setSuccessorThreads(1);
+    next(config, sequential, 90, 2);
+
+    std::vector<Configuration> parallel;
+    setSuccessorThreads(4);
+    next(config, parallel, 90, 2);
+    setSuccessorThreads(1);
+
+    REQUIRE(!sequential.empty());
+    REQUIRE(sequential == parallel);
+}
+
+TEST_CASE("Parallel successor generation rethrows in the caller") {
+    Configuration config;
+    config.addModule(0, 0, 0, 0);
+    config.addModule(0, 0, 0, 1);
+    REQUIRE(config.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(config.isValid());
+
+    // Rotating a module the configuration does not have throws std::out_of_range
+    std::vector<Action> actions;
+    for (ID id : {0, 1, 7, 0, 1})
+        actions.emplace_back(Action::Rotate(id, Alpha, 90));
+
+    setSuccessorThreads(GENERATE(1u, 4u));
+    std::vector<Configuration> res;
+    CHECK_THROWS_AS(executeAllIfValid(config, actions, res), std::out_of_range);
+    setSuccessorThreads(1);
+}
+
+TEST_CASE("Batch manifest fills defaults and resolves paths") {
+    std::istringstream manifest(
+        "# init goal algorithm eval step bound\n"
+        "a.in b.in\n"
+        "\n"
+        "/abs/a.in b.in astar dMatrix 45 2\n");
+    auto tasks = readManifest(manifest, "dir");
+    REQUIRE(tasks.size() == 2);
+
+    CHECK(tasks[0].init == "dir/a.in");
+    CHECK(tasks[0].goal == "dir/b.in");
+    CHECK(tasks[0].alg == Algorithm::BFS);
+    CHECK(tasks[0].eval == "trivial");
+    CHECK(tasks[0].step == 90);
+    CHECK(tasks[0].bound == 1);
+
+    CHECK(tasks[1].init == "/abs/a.in");
+    CHECK(tasks[1].alg == Algorithm::AStar);
+    CHECK(tasks[1].eval == "dMatrix");
+    CHECK(tasks[1].step == 45);
+    CHECK(tasks[1].bound == 2);
+
+    std::istringstream unknownAlg("a.in b.in dfs\n");
+    CHECK_THROWS_AS(readManifest(unknownAlg, "."), std::runtime_error);
+    std::istringstream badStep("a.in b.in bfs trivial 120\n");
+    CHECK_THROWS_AS(readManifest(badStep, "."), std::runtime_error);
+}
+
+TEST_CASE("Anytime A* respects its budget") {
+    Configuration init;
+    init.addModule(0, 0, 0, 0);
+    init.addModule(0, 0, 0, 1);
+    init.addModule(0, 0, 0, 2);
+    REQUIRE(init.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(init.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(init.isValid());
+
+    Configuration goal = init;
+    REQUIRE(goal.execute(Action(Action::Rotate{2, Gamma, 90})));
+    REQUIRE(goal.isValid());
+
+    SECTION("Stopped search returns a partial path") {
+        std::stop_source source;
+        source.request_stop();
+        SearchLimits limits;
+        limits.stop = source.get_token();
+
+        AlgorithmStat stat;
+        auto path = AStar(init, goal, 90, 1, Eval::matrixDiff, limits, &stat);
+        REQUIRE(stat.partial);
+        REQUIRE(path.size() == 1);
+        REQUIRE(path.front() == init);
+    }
+
+    SECTION("Search within the budget reports progress") {
+        unsigned events = 0;
+        SearchLimits limits;
+        limits.nodeBudget = 100000;
+        limits.progressInterval = 0;
+        limits.onProgress = [&](const SearchProgress&) { ++events; };
+
+        AlgorithmStat stat;
+        auto path = AStar(init, goal, 90, 1, Eval::matrixDiff, limits, &stat);
+        REQUIRE(!stat.partial);
+        REQUIRE(path.size() == 2);
+        REQUIRE(path.back() == goal);
+        REQUIRE(events > 0);
+    }
+}
+
+TEST_CASE("Compact search matches the pooled search") {
+    Configuration init;
+    init.addModule(0, 0, 0, 0);
+    init.addModule(0, 0, 0, 1);
+    init.addModule(0, 0, 0, 2);
+    REQUIRE(init.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(init.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(init.isValid());
+
+    Configuration goal = init;
+    REQUIRE(goal.execute(Action(Action::Rotate{0, Gamma, 90})));
+    REQUIRE(goal.execute(Action(Action::Rotate{2, Gamma, -90})));
+    REQUIRE(goal.isValid());
+
+    Configuration same = init;
+    REQUIRE(fingerprint(same) == fingerprint(init));
+    REQUIRE(fingerprint(goal) != fingerprint(init));
+
+    AlgorithmStat pooled, compact;
+    auto expected = BFS(init, goal, 90, 1, &pooled);
+    auto path = CompactBFS(init, goal, 90, 1, &compact);
+    REQUIRE(path.size() == expected.size());
+    REQUIRE(path.front() == init);
+    REQUIRE(path.back() == goal);
+    REQUIRE(compact.seenCfgs == pooled.seenCfgs);
+
+    auto astarPath = CompactAStar(init, goal, 90, 1, Eval::jointDiff);
+    REQUIRE(astarPath.size() == expected.size());
+    REQUIRE(astarPath.back() == goal);
+}
+
+TEST_CASE("Parallel A* finds a shortest valid path") {
+    Configuration init;
+    init.addModule(0, 0, 0, 0);
+    init.addModule(0, 0, 0, 1);
+    init.addModule(0, 0, 0, 2);
+    REQUIRE(init.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(init.addEdge({1, B, ZMinus, 0, ZMinus, A, 2}));
+    REQUIRE(init.isValid());
+
+    Configuration goal = init;
+    REQUIRE(goal.execute(Action(Action::Rotate{0, Gamma, 90})));
+    REQUIRE(goal.execute(Action(Action::Rotate{1, Alpha, 90})));
+    REQUIRE(goal.execute(Action(Action::Rotate{2, Gamma, -90})));
+    REQUIRE(goal.isValid());
+
+    auto expected = AStar(init, goal, 90, 1, Eval::jointDiff);
+    REQUIRE(expected.size() == 4);
+
+    unsigned threads = GENERATE(1u, 2u, 4u);
+    AlgorithmStat stat;
+    auto path = ParallelAStar(init, goal, 90, 1, Eval::jointDiff, threads, &stat);
+    REQUIRE(path.size() == expected.size());
+    REQUIRE(stat.pathLength == path.size());
+    REQUIRE(path.front() == init);
+    REQUIRE(path.back() == goal);
+
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        std::vector<Configuration> successors;
+        next(path[i], successors, 90, 1);
+        CHECK(std::find(successors.begin(), successors.end(), path[i + 1]) != successors.end());
+    }
+}
+
+TEST_CASE("Batch runs every task in its own process") {
+    Configuration init;
+    init.addModule(0, 0, 0, 0);
+    init.addModule(0, 0, 0, 1);
+    REQUIRE(init.addEdge({0, B, ZMinus, 0, ZMinus, A, 1}));
+    REQUIRE(init.isValid());
+
+    Configuration goal = init;
+    REQUIRE(goal.execute(Action(Action::Rotate{0, Gamma, 90})));
+    REQUIRE(goal.execute(Action(Action::Rotate{1, Alpha, 90})));
+    REQUIRE(goal.isValid());
+
+    auto dir = std::filesystem::temp_directory_path() / ("reconfig-batch-" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    std::ofstream((dir / "init.in").string()) << IO::toString(init);
+    std::ofstream((dir / "goal.in").string()) << IO::toString(goal);
+
+    std::istringstream manifest(
+        "init.in goal.in bfs\n"
+        "init.in goal.in astar dJoint\n"
+        "init.in missing.in\n");
+    auto tasks = readManifest(manifest, dir.string());
+
+    BatchOptions opts;
+    opts.jobs = 2;
+    opts.threads = GENERATE(1u, 2u);
+    opts.workers = GENERATE(1u, 2u);
+    auto results = runBatch(tasks, opts);
+    std::filesystem::remove_all(dir);
+
+    REQUIRE(results.size() == 3);
+    CHECK(results[0].status == "ok");
+    CHECK(results[0].stat.pathLength == 3);
+    CHECK(results[1].status == "ok");
+    CHECK(results[1].stat.pathLength == 3);
+    CHECK(results[2].status == "error");
+}
+
+TEST_CASE("Batch CSV quotes paths with separators") {
+    BatchTask plain, odd;
+    plain.init = "a.in";
+    plain.goal = "b.in";
+    odd.init = "dir,1/a.in";
+    odd.goal = "say \"b\".in";
+    std::vector<BatchResult> results(2, BatchResult{"ok", {}, 0, 0});
+
+    std::ostringstream out;
+    writeResultsCsv(out, {plain, odd}, results);
+    std::istringstream lines(out.str());
+    std::string header, first, second;
+    std::getline(lines, header);
+    std::getline(lines, first);
+    std::getline(lines, second);
+
+    CHECK(first.rfind("a.in,b.in,bfs,", 0) == 0);
+    CHECK(second.rfind("\"dir,1/a.in\",\"say \"\"b\"\".in\",bfs,", 0) == 0);
+}
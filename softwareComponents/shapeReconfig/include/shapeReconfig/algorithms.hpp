@@ -2,9 +2,16 @@
 
 #include <array>
 #include <cassert>
+#include <deque>
+#include <limits>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <stdexcept>
 #include <vector>
 #include <queue>
 
@@ -18,6 +25,8 @@
 #include <shapeReconfig/isomorphic.hpp>
 #include <shapeReconfig/equality.hpp>
 #include <shapeReconfig/hashing.hpp>
+#include <shapeReconfig/externalVisitedSet.hpp>
+#include <shapeReconfig/profiling.hpp>
 
 #include <nlohmann/json.hpp>
 namespace rofi::shapereconfig { // types and functions
@@ -29,8 +38,10 @@ namespace rofi::shapereconfig { // types and functions
  * their PCA decompositions; considers reflected shapes to be equal
  * ShapeStar - A* using complete shape symmetry and a heuristic based on
  * recognition of the shapes of individual modules of the RoFIBot
+ * ShapeIDAStar - iterative deepening variant of ShapeStar with memory linear in the depth
+ * ShapeBeam - beam search with the heuristic of ShapeStar keeping a bounded number of nodes
  */
-enum class Algorithm { BFStrict, BFShape, BFSEigen, ShapeStar };
+enum class Algorithm { BFStrict, BFShape, BFSEigen, ShapeStar, ShapeIDAStar, ShapeBeam };
 /**
  * Node type describes what each node in the state space is defined by:
  * World - the corresponding RoFIWorld
@@ -60,11 +71,47 @@ std::vector< rofi::configuration::RofiWorld > shapeStar(
     const rofi::configuration::RofiWorld& target,
     float step, Reporter& rep );
 
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > shapeIdaStar( 
+    const rofi::configuration::RofiWorld& start, 
+    const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, size_t nodeBudget = 0 );
+
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > shapeBeam( 
+    const rofi::configuration::RofiWorld& start, 
+    const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, size_t beamWidth, size_t nodeBudget = 0 );
+
 template < NodeType _NodeType >
 std::vector< Node > bfsTraverse( 
     const rofi::configuration::RofiWorld& start, 
     float step, size_t maxDepth = 0 );
 
+/**
+ * @brief Settings of the external-memory mode of BFS (see ExternalVisitedSet).
+ * directory - where the runs are stored (in a temporary subdirectory removed afterwards)
+ * layersInMemory - number of most recent BFS layers of fingerprints kept in RAM
+ * nodesInMemory - maximal number of worlds kept in RAM while a layer is generated
+ */
+struct ExternalMemoryOptions
+{
+    std::filesystem::path directory;
+    size_t layersInMemory = 2;
+    size_t nodesInMemory = 1 << 12;
+};
+
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > bfsExternal( 
+    const rofi::configuration::RofiWorld& start, 
+    const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, const ExternalMemoryOptions& opts, size_t maxDepth = 0 );
+
+template < NodeType _NodeType, typename Visitor >
+size_t bfsTraverseExternal( 
+    const rofi::configuration::RofiWorld& start, 
+    float step, const ExternalMemoryOptions& opts, Visitor&& onNode, size_t maxDepth = 0 );
+
 struct Node
 {
     NodeId nid;
@@ -81,6 +128,7 @@ struct Node
         distFromStart( distFromStart_ ),
         predecessorId( predecessorId_ ) 
         {
+            detail::ScopedPhase timer( Phase::Pca );
             Vector cloudEigenVals;
             switch ( nt ) // each node type stores different information
             {
@@ -115,6 +163,7 @@ struct EqualNode< NodeType::World >
 {
     bool operator()( const Node& n1, const Node& n2 ) const
     {
+        ScopedPhase timer( Phase::Equality );
         return equalConfiguration( n1.world, n2.world );
     }
 };
@@ -124,6 +173,7 @@ struct EqualNode< NodeType::Shape >
 {
     bool operator()( const Node& n1, const Node& n2 ) const
     {
+        ScopedPhase timer( Phase::Equality );
         return n1.shape == n2.shape;
     }
 };
@@ -133,6 +183,7 @@ struct EqualNode< NodeType::Eigen >
 {
     bool operator()( const Node& n1, const Node& n2 ) const
     {
+        ScopedPhase timer( Phase::Equality );
         return n1.eigenVals == n2.eigenVals;
     }
 };
@@ -142,6 +193,7 @@ struct EqualNode< NodeType::EigenCloud >
 {
     bool operator()( const Node& n1, const Node& n2 ) const
     {
+        ScopedPhase timer( Phase::Equality );
         // Comparing eigenvalues is very quick but not complete (reflections have same eigenvalues), 
         // isometry of clouds is costly but completely precise
         // Most nodes are not equal, so isometry does not have to be used most of the time (lazy evaluation)
@@ -154,7 +206,11 @@ struct EqualNodePtr
 {
     bool operator()( const Node* n1, const Node* n2 ) const
     {
-        return EqualNode< _NodeType >{}( *n1, *n2 );
+        // Visited sets compare (cached) hashes first, so a mismatch here is a hash collision
+        bool equal = EqualNode< _NodeType >{}( *n1, *n2 );
+        if ( !equal )
+            onHashCollision();
+        return equal;
     }
 };
 
@@ -166,6 +222,7 @@ struct HashNodePtr< NodeType::World >
 {
     size_t operator()( const Node* nodePtr ) const
     {
+        ScopedPhase timer( Phase::Hashing );
         return RofiWorldHash{}( nodePtr->world );
     }
 };
@@ -175,6 +232,7 @@ struct HashNodePtr< NodeType::Shape >
 {
     size_t operator()( const Node* nodePtr ) const
     {
+        ScopedPhase timer( Phase::Hashing );
         return HashCloud{}( nodePtr->shape );
     }
 };
@@ -184,6 +242,7 @@ struct HashNodePtr< NodeType::Eigen >
 {
     size_t operator()( const Node* nodePtr ) const
     {
+        ScopedPhase timer( Phase::Hashing );
         return HashArray< int, 4 >{}( nodePtr->eigenVals );
     }
 };
@@ -193,10 +252,60 @@ struct HashNodePtr< NodeType::EigenCloud >
 {
     size_t operator()( const Node* nodePtr ) const
     {
+        ScopedPhase timer( Phase::Hashing );
         return HashArray< int, 4 >{}( nodePtr->eigenVals );
     }
 };
 
+template < NodeType _NodeType >
+struct FingerprintNode;
+
+template <>
+struct FingerprintNode< NodeType::World >
+{
+    Fingerprint operator()( const Node& n ) const
+    {
+        return fingerprintRofiWorld( n.world );
+    }
+};
+
+template <>
+struct FingerprintNode< NodeType::Shape >
+{
+    Fingerprint operator()( const Node& n ) const
+    {
+        return fingerprintCloud( n.shape );
+    }
+};
+
+template <>
+struct FingerprintNode< NodeType::Eigen >
+{
+    Fingerprint operator()( const Node& n ) const
+    {
+        FingerprintBuilder builder;
+        for ( int eigenVal : n.eigenVals )
+            builder.add( eigenVal );
+        return builder.get();
+    }
+};
+
+template <>
+struct FingerprintNode< NodeType::EigenCloud >
+{
+    Fingerprint operator()( const Node& n ) const
+    {
+        // The stored cloud is not canonical; equal nodes are isometric clouds,
+        // which share the canonical form
+        Fingerprint cloudPrint = fingerprintCloud( canonCloud( n.shape ) );
+        FingerprintBuilder builder;
+        for ( int eigenVal : n.eigenVals )
+            builder.add( eigenVal );
+        builder.add( static_cast< int64_t >( cloudPrint.high ) ).add( static_cast< int64_t >( cloudPrint.low ) );
+        return builder.get();
+    }
+};
+
 template < typename _Type >
 struct PriorityPairComparator
 {
@@ -240,6 +349,32 @@ inline std::vector< std::vector< float > > generateParameters( size_t degreeOfFr
     return result;
 }
 
+/**
+ * @brief Copies given world, measured as Phase::WorldCopy.
+ */
+inline rofi::configuration::RofiWorld copyWorld( const rofi::configuration::RofiWorld& world )
+{
+    ScopedPhase timer( Phase::WorldCopy );
+    return world;
+}
+
+inline atoms::Result< std::monostate > prepareWorld( rofi::configuration::RofiWorld& world )
+{
+    ScopedPhase timer( Phase::Prepare );
+    return world.prepare();
+}
+
+/**
+ * @brief Prepares given world and checks it for collisions; each part is measured as its own phase.
+ */
+inline bool prepareValid( rofi::configuration::RofiWorld& world )
+{
+    if ( !prepareWorld( world ).has_value() )
+        return false;
+    ScopedPhase timer( Phase::IsValid );
+    return world.isValid().has_value();
+}
+
 /**
  * @brief Descendants generated by changing joint parameters (e. g. rotation of a module)
  */
@@ -256,7 +391,7 @@ inline std::vector< rofi::configuration::RofiWorld > getDescendantsRotate(
             // For only universal modules, should not be too expensive
             for ( auto& possRot : generateParameters( currJoint->positions().size(), step ) )
             {                
-                rofi::configuration::RofiWorld newBot = current;
+                rofi::configuration::RofiWorld newBot = copyWorld( current );
 
                 // Shouldnt work - is const
                 // newBot.getModule(  modInf.module->getId() )->joints()[j].joint->changePositions( possRot );
@@ -265,7 +400,7 @@ inline std::vector< rofi::configuration::RofiWorld > getDescendantsRotate(
                 if ( !newBot.getModule( rModule.getId() )->changeJointPositionsBy( int(j), possRot ).has_value() )
                     continue;
 
-                if ( newBot.prepare().has_value() && newBot.isValid() )
+                if ( prepareValid( newBot ) )
                     result.push_back( newBot );
             }
         }
@@ -288,25 +423,67 @@ inline std::vector< rofi::configuration::RofiWorld > getDescendantsDisconnect(
     
     for ( auto start = allConnects.begin(); start != allConnects.end(); ++start )
     {
-        rofi::configuration::RofiWorld newBot = current;
+        rofi::configuration::RofiWorld newBot = copyWorld( current );
         newBot.disconnect( start.get_handle() );
 
-        if ( newBot.prepare().has_value() && newBot.isValid() )
+        if ( prepareValid( newBot ) )
             result.push_back( newBot );
     }
 
     return result;
 }
 
-inline std::unordered_set< std::pair< int, int >, HashPairIntInt > occupiedRoficoms( 
-    const rofi::configuration::RofiWorld& world )
+/**
+ * @brief Position of a RoFICoM quantized to the ERROR_MARGIN grid,
+ * (center of the connector face, same as in decomposeModule).
+ * Adjacent RoFICoMs have equal positions, so it can be used as a hash key.
+ */
+using ConnectorPosition = std::array< int, 3 >;
+
+/**
+ * @brief RoFICoM identified by the id of its module and its component index
+ */
+using ModuleConnector = std::pair< int, int >;
+
+using FreeConnectors = std::unordered_map< ConnectorPosition, std::vector< ModuleConnector >, HashArray< int, 3 > >;
+
+inline ConnectorPosition connectorPosition( const Component& rConnector )
 {
-    std::unordered_set< std::pair< int, int >, HashPairIntInt > result;
+    Vector position = ( rConnector.getPosition() * matrices::translate( { -0.5, 0, 0 } ) ).col(3);
+    return { static_cast<int>( std::round( position(0) / ERROR_MARGIN ) ),
+             static_cast<int>( std::round( position(1) / ERROR_MARGIN ) ),
+             static_cast<int>( std::round( position(2) / ERROR_MARGIN ) ) };
+}
+
+/**
+ * @brief Unoccupied roficoms of given (prepared) world grouped by their quantized position.
+ * Built in a single pass over the connectors; connected roficoms are then erased
+ * from their buckets, so no auxiliary set of occupied connectors is needed.
+ */
+inline FreeConnectors freeConnectors( const rofi::configuration::RofiWorld& world )
+{
+    FreeConnectors result;
+
+    for ( const Module& rModule : world.modules() )
+        for ( const Component& rConnector : rModule.connectors() )
+        {
+            assert( rConnector.type == ComponentType::Roficom );
+            result[ connectorPosition( rConnector ) ].emplace_back( rModule.getId(), rModule.componentIdx( rConnector ) );
+        }
+
+    auto eraseConnector = [ &result ]( const Module& rModule, int compId )
+    {
+        auto bucket = result.find( connectorPosition( rModule.components()[ compId ] ) );
+        assert( bucket != result.end() );
+        std::erase( bucket->second, ModuleConnector( rModule.getId(), compId ) );
+        if ( bucket->second.empty() )
+            result.erase( bucket );
+    };
 
     for ( const auto& rofiJoint : world.roficomConnections() )
     {
-        result.insert( std::make_pair( rofiJoint.getSourceModule(world).getId(), rofiJoint.sourceConnector ) );
-        result.insert( std::make_pair( rofiJoint.getDestModule(world).getId(), rofiJoint.destConnector ) );
+        eraseConnector( rofiJoint.getSourceModule( world ), rofiJoint.sourceConnector );
+        eraseConnector( rofiJoint.getDestModule( world ), rofiJoint.destConnector );
     }
 
     return result;
@@ -323,42 +500,6 @@ inline std::vector< rofi::configuration::RofiWorld > getDescendantsConnect(
 
     std::vector< rofi::configuration::RofiWorld > result;
 
-    using ModCompPos = std::tuple< int, int, Vector >;
-
-    std::vector< ModCompPos > roficomPositions;
-    std::unordered_set< std::pair< int, int >, HashPairIntInt > occupied = occupiedRoficoms( parentWorld );
-    auto connections = parentWorld.roficomConnections();
-
-    for ( const Module& rModule : parentWorld.modules() )
-        for ( const Component& rConnector : rModule.connectors() )
-        {
-            assert( rConnector.type == ComponentType::Roficom );
-
-            int modId = rModule.getId();
-            int compId = rModule.componentIdx( rConnector );
-
-            if ( occupied.contains( std::make_pair( modId, compId ) ) )
-                continue;
-
-            Vector position = arma::round( ( rConnector.getPosition() * matrices::translate( { -0.5, 0, 0 } ) ).col(3) / ERROR_MARGIN ) * ERROR_MARGIN;
-
-            roficomPositions.push_back( std::make_tuple( modId, compId, position ) );
-        }
-
-    auto compareModCompPos = []( const ModCompPos& modCompPos1, const ModCompPos& modCompPos2 )
-    {
-        const Vector& pos1 = std::get<2>( modCompPos1 );
-        const Vector& pos2 = std::get<2>( modCompPos2 );
-
-        return pos1(0) < pos2(0) || 
-            ( pos1(0) == pos2(0) && ( pos1(1) < pos2(1) || 
-            ( pos1(1) == pos2(1) && pos1(2) < pos2(2) ) ) );
-    };
-
-    // By sorting unoccupied roficoms by their position, only those adjacent 
-    // in the container can possibly make a connection - only size()-1 connections to consider
-    std::sort( roficomPositions.begin(), roficomPositions.end(), compareModCompPos );
-
     static constexpr auto allOrientations = std::array{ 
         roficom::Orientation::North,
         roficom::Orientation::East,
@@ -366,37 +507,38 @@ inline std::vector< rofi::configuration::RofiWorld > getDescendantsConnect(
         roficom::Orientation::West 
     };
 
-    assert( roficomPositions.size() > 0 );
-    for ( size_t i = 0; i < roficomPositions.size() - 1; ++i ) 
+    // Only free roficoms sharing a position can make a connection;
+    // in a valid world each bucket contains at most two of them
+    for ( const auto& [ position, connectors ] : freeConnectors( parentWorld ) )
     {
-        auto& [ currModId, currCompId, currPos ] = roficomPositions[ i ];
-        auto& [ nextModId, nextCompId, nextPos ] = roficomPositions[ i + 1 ];
-
-        if ( !equals( currPos, nextPos ) )
-            continue; // roficoms are not adjacent
-
-        const Matrix& currCompAbsPos = parentWorld.getModulePosition( currModId ) * parentWorld.getModule( currModId )->getComponentRelativePosition( currCompId );
-        const Matrix& nextCompAbsPos = parentWorld.getModulePosition( nextModId ) * parentWorld.getModule( nextModId )->getComponentRelativePosition( nextCompId );
-        
-        for ( roficom::Orientation o : allOrientations ) 
-        {
-            if ( !equals( currCompAbsPos * orientationToTransform( o ), nextCompAbsPos ) ) 
-                continue; // current orientation does not fit
-
-            rofi::configuration::RofiWorld nextWorld = parentWorld;
-            connect( 
-                nextWorld.getModule( currModId )->components()[ currCompId ], 
-                nextWorld.getModule( nextModId )->components()[ nextCompId ],
-                o );
-
-            auto prepared = nextWorld.prepare();
-            // roficoms are adjacent and have the right orientation;
-            // if the world was valid before, it should be valid now
-            assert( prepared );
-            result.push_back( nextWorld );
-            ++i; // each roficom is adjacent to at most one other roficom
-            break; // only one orientation fits per possible connection
-        }
+        for ( size_t i = 0; i < connectors.size(); ++i )
+            for ( size_t j = i + 1; j < connectors.size(); ++j )
+            {
+                auto [ currModId, currCompId ] = connectors[ i ];
+                auto [ nextModId, nextCompId ] = connectors[ j ];
+
+                const Matrix& currCompAbsPos = parentWorld.getModulePosition( currModId ) * parentWorld.getModule( currModId )->getComponentRelativePosition( currCompId );
+                const Matrix& nextCompAbsPos = parentWorld.getModulePosition( nextModId ) * parentWorld.getModule( nextModId )->getComponentRelativePosition( nextCompId );
+
+                for ( roficom::Orientation o : allOrientations ) 
+                {
+                    if ( !equals( currCompAbsPos * orientationToTransform( o ), nextCompAbsPos ) ) 
+                        continue; // current orientation does not fit
+
+                    rofi::configuration::RofiWorld nextWorld = copyWorld( parentWorld );
+                    connect( 
+                        nextWorld.getModule( currModId )->components()[ currCompId ], 
+                        nextWorld.getModule( nextModId )->components()[ nextCompId ],
+                        o );
+
+                    auto prepared = prepareWorld( nextWorld );
+                    // roficoms are adjacent and have the right orientation;
+                    // if the world was valid before, it should be valid now
+                    assert( prepared );
+                    result.push_back( nextWorld );
+                    break; // only one orientation fits per possible connection
+                }
+            }
     }
 
     return result;
@@ -444,12 +586,65 @@ inline std::vector< rofi::configuration::RofiWorld > getPredecessors(
     return plan;
 }
 
+/**
+ * @brief Layered BFS with an ExternalVisitedSet. The current and the next layer
+ * are stored as runs of worlds in <directory>; at most <nodesInMemory> worlds
+ * are kept in memory at once. Each layer is generated whole, sorted by fingerprints
+ * (in chunks merged afterwards) and only then checked against the visited layers.
+ * Calls <onNewNode> for every unique node (including start); stops when it returns true.
+ * The predecessors of the nodes are kept only in <visited> (predecessorId is not set).
+ * 
+ * @returns fingerprint of the node at which the search was stopped
+ */
+template < NodeType _NodeType, typename OnNewNode >
+std::optional< Fingerprint > externalLayeredBfs( 
+    const rofi::configuration::RofiWorld& start, float step, 
+    ExternalVisitedSet& visited, const std::filesystem::path& directory, size_t nodesInMemory,
+    size_t maxDepth, Reporter* rep, OnNewNode&& onNewNode );
+
+/**
+ * @brief Reconstructs the path from <start> to the node <targetPrint> in layer <depth>
+ * of <visited> by following the stored predecessors and regenerating the worlds
+ * (descendants with the matching fingerprints) forward from <start>.
+ */
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > replayPath( 
+    const rofi::configuration::RofiWorld& start, float step,
+    const ExternalVisitedSet& visited, size_t depth, Fingerprint targetPrint )
+{
+    std::vector< Fingerprint > prints = { targetPrint };
+    for ( size_t layer = depth; layer > 0; --layer )
+    {
+        std::optional< Fingerprint > pred = visited.predecessor( layer, prints.back() );
+        if ( !pred.has_value() )
+            throw std::logic_error( fmt::format( "No predecessor stored for a node in layer {}", layer ) );
+        prints.push_back( *pred );
+    }
+    std::reverse( prints.begin(), prints.end() );
+
+    std::vector< rofi::configuration::RofiWorld > plan = { start };
+    for ( size_t layer = 1; layer < prints.size(); ++layer )
+    {
+        std::vector< rofi::configuration::RofiWorld > descendants = getDescendants( plan.back(), step );
+        auto next = std::ranges::find_if( descendants, [ & ]( const rofi::configuration::RofiWorld& child ) {
+            return FingerprintNode< _NodeType >{}( Node( _NodeType, 0, child, layer, 0 ) ) == prints[ layer ];
+        } );
+        if ( next == descendants.end() )
+            throw std::logic_error( fmt::format( "No descendant matches the stored node in layer {}", layer ) );
+        plan.push_back( std::move( *next ) );
+    }
+
+    return plan;
+}
+
 } // namespace rofi::shapereconfig::detail
 
 namespace rofi::shapereconfig {
 
 class Reporter
 {
+    Profiler _profiler;
+    bool _profiling = false;
     std::vector< size_t > _layerNodes;
     size_t _maxQueueSize = 0;
     size_t _descendantsGenerated = 0;
@@ -457,10 +652,28 @@ class Reporter
     size_t _maxDescendants = 0;
     bool _pathFound = false;
     size_t _pathLength = 0;
+    bool _budgetExhausted = false;
+    size_t _bestEstimate = 0;
 
 public:
     Reporter() = default;
 
+    /**
+     * @brief Turns on measuring of the search phases (see Phase), reported under "profile".
+     */
+    void enableProfiling()
+    {
+        _profiling = true;
+    }
+
+    /**
+     * @brief Profiler to be made active by the algorithms, nullptr if profiling is off.
+     */
+    Profiler* profiler()
+    {
+        return _profiling ? &_profiler : nullptr;
+    }
+
     void onNewNode( const Node& n )
     {
         ++_nodesTotal;
@@ -492,6 +705,16 @@ public:
         _maxQueueSize = std::max( _maxQueueSize, priorQueue.size() );
     }
 
+    void onUpdateQueue( const std::vector< Node >& bfsLayer )
+    {
+        _maxQueueSize = std::max( _maxQueueSize, bfsLayer.size() );
+    }
+
+    void onUpdateQueue( size_t queueSize )
+    {
+        _maxQueueSize = std::max( _maxQueueSize, queueSize );
+    }
+
     void onGenerateDescendants( const std::vector< rofi::configuration::RofiWorld >& desc )
     {
         _maxDescendants = std::max( _maxDescendants, desc.size() );
@@ -504,11 +727,33 @@ public:
         _pathLength = finalNode.distFromStart + 1;
     }
 
+    /**
+     * @brief The node budget ran out; <bestNode> ends the returned partial plan,
+     * <estimate> is its heuristic distance to the target.
+     */
+    void onBudgetExhausted( const Node& bestNode, size_t estimate )
+    {
+        _budgetExhausted = true;
+        _pathLength = bestNode.distFromStart + 1;
+        _bestEstimate = estimate;
+    }
+
+    /**
+     * @brief Whether the returned plan is only partial since the node budget ran out.
+     */
+    bool budgetExhausted() const
+    {
+        return _budgetExhausted;
+    }
+
     nlohmann::json toJSON() const
     {
         nlohmann::json res;
         res[ "foundPath" ] = _pathFound;
         res[ "pathLength" ] = _pathLength;
+        res[ "budgetExhausted" ] = _budgetExhausted;
+        if ( _budgetExhausted )
+            res[ "bestEstimate" ] = _bestEstimate;
         res[ "maxDistFromStart" ] = _layerNodes.size();
         res[ "totalNodes" ] = _nodesTotal;
         res[ "maxQSize" ] = _maxQueueSize;
@@ -517,6 +762,8 @@ public:
         res[ "layerNodes" ] = nlohmann::json::array();
         for ( size_t i = 0; i < _layerNodes.size(); ++i ) 
             res[ "layerNodes" ].push_back( _layerNodes[ i ] );
+        if ( _profiling )
+            res[ "profile" ] = _profiler.toJSON();
         
         return res;
     }
@@ -537,6 +784,7 @@ std::vector< rofi::configuration::RofiWorld > bfs(
 {
     using namespace rofi::shapereconfig::detail;
 
+    ActiveProfiler profiling( rep.profiler() );
     std::vector< std::unique_ptr< Node > > nodePtrs;
     std::unordered_set< Node*, HashNodePtr< _NodeType >, EqualNodePtr< _NodeType > > visitedNodes;
 
@@ -649,6 +897,215 @@ std::vector< Node > bfsTraverse(
     return result;
 }
 
+template < NodeType _NodeType, typename OnNewNode >
+std::optional< Fingerprint > detail::externalLayeredBfs( 
+    const rofi::configuration::RofiWorld& start, float step, 
+    ExternalVisitedSet& visited, const std::filesystem::path& directory, size_t nodesInMemory,
+    size_t maxDepth, Reporter* rep, OnNewNode&& onNewNode )
+{
+    using namespace rofi::shapereconfig::detail;
+
+    nodesInMemory = std::max( nodesInMemory, size_t( 1 ) );
+    auto frontierPath = [ & ]( size_t depth ) { return directory / fmt::format( "frontier-{}.run", depth ); };
+    auto candidatePath = [ & ]( size_t run ) { return directory / fmt::format( "candidates-{}.run", run ); };
+
+    Node startNode( _NodeType, 0, start, 0, 0 );
+    Fingerprint startPrint = FingerprintNode< _NodeType >{}( startNode );
+    visited.pushLayer( { LayerEntry{ startPrint, startPrint } } );
+    if ( rep )
+        rep->onNewNode( startNode );
+    if ( onNewNode( startNode ) )
+        return startPrint;
+
+    NodeRunWriter startFrontier( frontierPath( 0 ) );
+    startFrontier.write( LayerEntry{ startPrint, startPrint }, start );
+    startFrontier.close();
+    size_t frontierSize = startFrontier.size();
+
+    for ( size_t depth = 1; frontierSize > 0; ++depth )
+    {
+        if ( maxDepth > 0 && depth > maxDepth )
+            break;
+
+        // Generate the whole next layer first, duplicates are resolved afterwards.
+        // Candidates are sorted and deduplicated in chunks, each chunk is written as a run.
+        std::vector< LayerEntry > chunkPrints;
+        std::vector< rofi::configuration::RofiWorld > chunkWorlds;
+        size_t runCount = 0;
+        auto flushChunk = [ & ]() {
+            std::vector< size_t > order( chunkPrints.size() );
+            std::iota( order.begin(), order.end(), 0 );
+            std::ranges::stable_sort( order, {}, [ & ]( size_t i ) { return chunkPrints[ i ].fingerprint; } );
+            auto [ first, last ] = std::ranges::unique( order, {}, [ & ]( size_t i ) { return chunkPrints[ i ].fingerprint; } );
+            order.erase( first, last );
+
+            NodeRunWriter run( candidatePath( runCount++ ) );
+            for ( size_t i : order )
+                run.write( chunkPrints[ i ], chunkWorlds[ i ] );
+            run.close();
+            chunkPrints.clear();
+            chunkWorlds.clear();
+        };
+
+        NodeRunReader frontier( frontierPath( depth - 1 ) );
+        LayerEntry current;
+        rofi::configuration::RofiWorld currentWorld;
+        while ( frontier.read( current, currentWorld ) )
+        {
+            std::vector< rofi::configuration::RofiWorld > descendants = getDescendants( currentWorld, step );
+            if ( rep )
+                rep->onGenerateDescendants( descendants );
+
+            for ( rofi::configuration::RofiWorld& child : descendants )
+            {
+                Fingerprint childPrint = FingerprintNode< _NodeType >{}( Node( _NodeType, 0, child, depth, 0 ) );
+                chunkPrints.push_back( { childPrint, current.fingerprint } );
+                chunkWorlds.push_back( std::move( child ) );
+                if ( chunkWorlds.size() >= nodesInMemory )
+                    flushChunk();
+            }
+        }
+        if ( !chunkWorlds.empty() )
+            flushChunk();
+        std::filesystem::remove( frontierPath( depth - 1 ) );
+
+        // Merge the runs; of equal fingerprints the one from the earliest run
+        // (i. e. the first generated) is kept
+        std::vector< NodeRunReader > runs;
+        std::vector< std::pair< LayerEntry, rofi::configuration::RofiWorld > > heads( runCount );
+        using Head = std::pair< Fingerprint, size_t >;
+        std::priority_queue< Head, std::vector< Head >, std::greater< Head > > mergeQueue;
+        for ( size_t run = 0; run < runCount; ++run )
+        {
+            runs.emplace_back( candidatePath( run ) );
+            if ( runs.back().read( heads[ run ].first, heads[ run ].second ) )
+                mergeQueue.push( { heads[ run ].first.fingerprint, run } );
+        }
+
+        // Unique candidates are checked against the visited layers in chunks
+        ExternalVisitedSet::Layer newLayer;
+        NodeRunWriter nextFrontier( frontierPath( depth ) );
+        std::optional< Fingerprint > stoppedAt;
+        auto checkChunk = [ & ]() {
+            std::vector< Fingerprint > sortedPrints;
+            sortedPrints.reserve( chunkPrints.size() );
+            for ( const LayerEntry& entry : chunkPrints )
+                sortedPrints.push_back( entry.fingerprint );
+            std::vector< bool > alreadyVisited = visited.contains( sortedPrints );
+
+            for ( size_t k = 0; k < chunkPrints.size() && !stoppedAt; ++k )
+            {
+                if ( alreadyVisited[ k ] )
+                    continue;
+                newLayer.push_back( chunkPrints[ k ] );
+
+                Node child( _NodeType, newLayer.size() - 1, chunkWorlds[ k ], depth, 0 );
+                if ( rep )
+                    rep->onNewNode( child );
+                if ( onNewNode( child ) )
+                    stoppedAt = chunkPrints[ k ].fingerprint;
+                nextFrontier.write( chunkPrints[ k ], chunkWorlds[ k ] );
+            }
+            chunkPrints.clear();
+            chunkWorlds.clear();
+        };
+
+        std::optional< Fingerprint > lastPrint;
+        while ( !mergeQueue.empty() && !stoppedAt )
+        {
+            size_t run = mergeQueue.top().second;
+            mergeQueue.pop();
+            auto& [ entry, world ] = heads[ run ];
+            if ( entry.fingerprint != lastPrint )
+            {
+                lastPrint = entry.fingerprint;
+                chunkPrints.push_back( entry );
+                chunkWorlds.push_back( std::move( world ) );
+                if ( chunkWorlds.size() >= nodesInMemory )
+                    checkChunk();
+            }
+            if ( runs[ run ].read( entry, world ) )
+                mergeQueue.push( { entry.fingerprint, run } );
+        }
+        if ( !chunkWorlds.empty() && !stoppedAt )
+            checkChunk();
+
+        runs.clear();
+        for ( size_t run = 0; run < runCount; ++run )
+            std::filesystem::remove( candidatePath( run ) );
+        nextFrontier.close();
+        frontierSize = nextFrontier.size();
+
+        visited.pushLayer( std::move( newLayer ) );
+        if ( stoppedAt )
+            return stoppedAt;
+        if ( rep )
+            rep->onUpdateQueue( frontierSize );
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * @brief BFS from initial to target RoFIWorlds with the visited set in external memory
+ * (see ExternalVisitedSet); nodes are identified by 128-bit fingerprints,
+ * the BFS layers of worlds are stored in runs on disk as well.
+ * Returns the found path in the same form as bfs.
+ * 
+ * @tparam _NodeType defines how to store, compare, and fingerprint the explored nodes.
+ */
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > bfsExternal( 
+    const rofi::configuration::RofiWorld& start, const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, const ExternalMemoryOptions& opts, size_t maxDepth )
+{
+    using namespace rofi::shapereconfig::detail;
+
+    ActiveProfiler profiling( rep.profiler() );
+    // Avoids repeatedly creating the same node for comparison, which might be costly
+    Node targetNode( _NodeType, 0, target, 0, 0 );
+    TemporaryDirectory directory( opts.directory );
+    ExternalVisitedSet visited( directory.path() / "visited", opts.layersInMemory );
+
+    size_t targetDepth = 0;
+    std::optional< Fingerprint > found = externalLayeredBfs< _NodeType >( start, step, visited, 
+        directory.path(), opts.nodesInMemory, maxDepth, &rep,
+        [ & ]( const Node& node ) {
+            if ( !EqualNode< _NodeType >{}( node, targetNode ) )
+                return false;
+            rep.onPathFound( node );
+            targetDepth = node.distFromStart;
+            return true;
+        } );
+
+    if ( !found )
+        return {};
+    return replayPath< _NodeType >( start, step, visited, targetDepth, *found );
+}
+
+/**
+ * @brief Complete BFS traversal with the visited set in external memory,
+ * usable for state spaces which do not fit into RAM.
+ * Calls <onNode> for every unique node of the state space (with distFromStart set).
+ * 
+ * @returns the number of unique nodes
+ */
+template < NodeType _NodeType, typename Visitor >
+size_t bfsTraverseExternal( 
+    const rofi::configuration::RofiWorld& start, 
+    float step, const ExternalMemoryOptions& opts, Visitor&& onNode, size_t maxDepth )
+{
+    TemporaryDirectory directory( opts.directory );
+    ExternalVisitedSet visited( directory.path() / "visited", opts.layersInMemory );
+    detail::externalLayeredBfs< _NodeType >( start, step, visited, 
+        directory.path(), opts.nodesInMemory, maxDepth, nullptr,
+        [ & ]( const Node& node ) {
+            onNode( node );
+            return false;
+        } );
+    return visited.size();
+}
+
 /**
  * @brief Given nodes which form a shape state space (result of bfsTraverse), 
  * generates a table of shortest paths between all of the shapes
@@ -801,6 +1258,33 @@ inline size_t modShapesDistanceWithTable( std::vector< size_t > shapeCounts1, co
     return result;
 }
 
+/**
+ * @brief The heuristic used by shapeStar (modShapesDistanceWithTable)
+ * with the conversion table and the target histogram computed once.
+ */
+class ModShapesHeuristic
+{
+    arma::Mat< size_t > _convTable;
+    std::unordered_map< Cloud, size_t, HashCloud > _modShapeIds;
+    std::vector< size_t > _targetModShapes;
+
+public:
+    ModShapesHeuristic( const rofi::configuration::RofiWorld& target, float step )
+    {
+        rofi::configuration::RofiWorld oneModRofi;
+        oneModRofi.insert( UniversalModule( 0 ) ); 
+        rofi::parsing::fixateRofiWorld( oneModRofi );
+        oneModRofi.prepare().get_or_throw_as< std::logic_error >();
+        std::tie( _convTable, _modShapeIds ) = createConversionTable( bfsTraverse< NodeType::Shape >( oneModRofi, step ), step );
+        _targetModShapes = countModShapes( target, _modShapeIds );
+    }
+
+    size_t operator()( const rofi::configuration::RofiWorld& rw ) const
+    {
+        return modShapesDistanceWithTable( countModShapes( rw, _modShapeIds ), _targetModShapes, _convTable );
+    }
+};
+
 // Experimental eigenvalues heuristics for Eigen and EigenCloud node types
 inline size_t eigenDistance( const Cloud& n1, const Cloud& n2 )
 {
@@ -835,16 +1319,14 @@ std::vector< rofi::configuration::RofiWorld > shapeStar(
     Reporter& rep )
 {
     using namespace rofi::shapereconfig::detail;
+
+    ActiveProfiler profiling( rep.profiler() );
     
     // We are not able to gain or lose modules while reconfiguring
     if ( start.modules().size() != target.modules().size() )
         return {};
 
-    rofi::configuration::RofiWorld oneModRofi;
-    oneModRofi.insert( UniversalModule( 0 ) ); 
-    rofi::parsing::fixateRofiWorld( oneModRofi );
-    oneModRofi.prepare().get_or_throw_as< std::logic_error >();
-    auto [ convTable, modShapeIds ] = createConversionTable( bfsTraverse< NodeType::Shape >( oneModRofi, step ), step );
+    ModShapesHeuristic heuristic( target, step );
 
     // Node ID is the position in the vector
     std::vector< std::unique_ptr< Node > > nodePtrs;
@@ -857,11 +1339,8 @@ std::vector< rofi::configuration::RofiWorld > shapeStar(
 
     // Avoids repeatedly creating the same node for comparison, which might be costly
     Node targetNode( _NodeType, 0, target, 0, 0 );
-    std::vector< size_t > targetModShapes = countModShapes( target, modShapeIds );
 
-    distanceToTarget.insert( { 
-        startId, modShapesDistanceWithTable( countModShapes( start, modShapeIds ), targetModShapes, convTable )
-    } );
+    distanceToTarget.insert( { startId, heuristic( start ) } );
 
     std::priority_queue< 
         std::pair< NodeId, size_t >,
@@ -912,10 +1391,7 @@ std::vector< rofi::configuration::RofiWorld > shapeStar(
             } else 
                 childId = (*childIter)->nid;
 
-            size_t estimatedDistance = modShapesDistanceWithTable( 
-                countModShapes( childWorld, modShapeIds ), 
-                targetModShapes, 
-                convTable );
+            size_t estimatedDistance = heuristic( childWorld );
             size_t newDistance = currentNode.distFromStart + 1 + estimatedDistance;
 
             // Node is already in queue, and has a shorter path to target than we found now - skip it
@@ -949,4 +1425,289 @@ std::vector< rofi::configuration::RofiWorld > shapeStar(
     return {};
 }
 
+/**
+ * @brief Iterative deepening A* (IDA*) with the heuristic of shapeStar.
+ * Keeps only the current path (and the descendants of its nodes) in memory;
+ * repeated nodes are detected only along the current path.
+ * Every iteration regenerates the search tree of the previous one; the Reporter
+ * sees only the nodes generated for the first time, so it counts the nodes of the
+ * final search tree (a world reached along several paths counts once per path).
+ * The node budget counts all generations.
+ * 
+ * @param nodeBudget maximal number of generated nodes (0 for no limit);
+ * when it runs out, returns the path to the node with the lowest estimated
+ * distance to target found so far (see Reporter::onBudgetExhausted)
+ * 
+ * @returns the found path in the form of a sequence of RofiWorlds (see shapeStar)
+ */
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > shapeIdaStar(
+    const rofi::configuration::RofiWorld& start, 
+    const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, size_t nodeBudget )
+{
+    using namespace rofi::shapereconfig::detail;
+
+    ActiveProfiler profiling( rep.profiler() );
+
+    // We are not able to gain or lose modules while reconfiguring
+    if ( start.modules().size() != target.modules().size() )
+        return {};
+
+    ModShapesHeuristic heuristic( target, step );
+    // Avoids repeatedly creating the same node for comparison, which might be costly
+    Node targetNode( _NodeType, 0, target, 0, 0 );
+
+    struct Frame
+    {
+        Node node;
+        std::vector< rofi::configuration::RofiWorld > descendants;
+        // Expanded by the previous iteration too, so its descendants are already reported
+        bool expandedBefore = false;
+        size_t nextChild = 0;
+    };
+
+    // Deque keeps the nodes in place, so they can be referenced by onPath
+    std::deque< Frame > path;
+    std::unordered_set< const Node*, HashNodePtr< _NodeType >, EqualNodePtr< _NodeType > > onPath;
+
+    auto currentPlan = [ & ]() {
+        std::vector< rofi::configuration::RofiWorld > plan;
+        for ( const Frame& frame : path )
+            plan.push_back( frame.node.world );
+        return plan;
+    };
+
+    size_t startEstimate = heuristic( start );
+    std::vector< rofi::configuration::RofiWorld > bestPlan = { start };
+    size_t bestEstimate = startEstimate;
+    Node bestNode( _NodeType, 0, start, 0, 0 );
+    size_t generated = 1;
+
+    Node startNode( _NodeType, 0, start, 0, 0 );
+    rep.onNewNode( startNode );
+    if ( EqualNode< _NodeType >{}( startNode, targetNode ) )
+    {
+        rep.onPathFound( startNode );
+        return { start };
+    }
+
+    size_t threshold = startEstimate;
+    std::optional< size_t > previousThreshold;
+    while ( true )
+    {
+        size_t nextThreshold = std::numeric_limits< size_t >::max();
+
+        path.clear();
+        onPath.clear();
+        path.push_back( Frame{ startNode, getDescendants( start, step ), previousThreshold.has_value() } );
+        if ( !path.back().expandedBefore )
+            rep.onGenerateDescendants( path.back().descendants );
+        onPath.insert( &path.back().node );
+
+        while ( !path.empty() )
+        {
+            Frame& top = path.back();
+            if ( top.nextChild == top.descendants.size() )
+            {
+                onPath.erase( &top.node );
+                path.pop_back();
+                continue;
+            }
+
+            if ( nodeBudget > 0 && generated >= nodeBudget )
+            {
+                rep.onBudgetExhausted( bestNode, bestEstimate );
+                return bestPlan;
+            }
+
+            rofi::configuration::RofiWorld& childWorld = top.descendants[ top.nextChild++ ];
+            Node child( _NodeType, generated++, childWorld, top.node.distFromStart + 1, top.node.nid );
+            if ( onPath.contains( &child ) )
+                continue;
+            if ( !top.expandedBefore )
+                rep.onNewNode( child );
+
+            if ( EqualNode< _NodeType >{}( child, targetNode ) )
+            {
+                rep.onPathFound( child );
+                std::vector< rofi::configuration::RofiWorld > plan = currentPlan();
+                plan.push_back( childWorld );
+                return plan;
+            }
+
+            size_t estimate = heuristic( childWorld );
+            if ( estimate < bestEstimate )
+            {
+                bestEstimate = estimate;
+                bestNode = child;
+                bestPlan = currentPlan();
+                bestPlan.push_back( childWorld );
+            }
+
+            size_t totalDistance = child.distFromStart + estimate;
+            if ( totalDistance > threshold )
+            {
+                nextThreshold = std::min( nextThreshold, totalDistance );
+                continue;
+            }
+
+            bool expandedBefore = top.expandedBefore && totalDistance <= *previousThreshold;
+            std::vector< rofi::configuration::RofiWorld > descendants = getDescendants( childWorld, step );
+            if ( !expandedBefore )
+                rep.onGenerateDescendants( descendants );
+            path.push_back( Frame{ std::move( child ), std::move( descendants ), expandedBefore } );
+            onPath.insert( &path.back().node );
+        }
+
+        // No node exceeded the threshold - the whole state space was searched
+        if ( nextThreshold == std::numeric_limits< size_t >::max() )
+            return {};
+        previousThreshold = threshold;
+        threshold = nextThreshold;
+    }
+}
+
+/**
+ * @brief Beam search with the heuristic of shapeStar. Each layer keeps only
+ * <beamWidth> nodes with the lowest estimated distance to target. Nodes of the earlier
+ * layers are freed; only their fingerprints (to skip repeated nodes) and the worlds
+ * on the paths to the nodes of the current beam are kept.
+ * Not complete - the target may be missed.
+ * 
+ * @param nodeBudget maximal number of generated nodes (0 for no limit);
+ * when it runs out, returns the path to the node with the lowest estimated
+ * distance to target found so far (see Reporter::onBudgetExhausted)
+ * 
+ * @returns the found path in the form of a sequence of RofiWorlds (see shapeStar)
+ */
+template < NodeType _NodeType >
+std::vector< rofi::configuration::RofiWorld > shapeBeam(
+    const rofi::configuration::RofiWorld& start, 
+    const rofi::configuration::RofiWorld& target,
+    float step, Reporter& rep, size_t beamWidth, size_t nodeBudget )
+{
+    using namespace rofi::shapereconfig::detail;
+
+    assert( beamWidth > 0 );
+    ActiveProfiler profiling( rep.profiler() );
+
+    // We are not able to gain or lose modules while reconfiguring
+    if ( start.modules().size() != target.modules().size() )
+        return {};
+
+    ModShapesHeuristic heuristic( target, step );
+    // Avoids repeatedly creating the same node for comparison, which might be costly
+    Node targetNode( _NodeType, 0, target, 0, 0 );
+
+    // World of a node which made it into some beam with the link to its parent;
+    // a trail is freed once no node of the current beam descends from it
+    struct Trail
+    {
+        rofi::configuration::RofiWorld world;
+        size_t distFromStart;
+        std::shared_ptr< const Trail > parent;
+    };
+
+    auto tracePlan = []( const Trail* trail ) {
+        std::vector< rofi::configuration::RofiWorld > plan;
+        for ( ; trail != nullptr; trail = trail->parent.get() )
+            plan.push_back( trail->world );
+        std::reverse( plan.begin(), plan.end() );
+        return plan;
+    };
+
+    Node startNode( _NodeType, 0, start, 0, 0 );
+    rep.onNewNode( startNode );
+    if ( EqualNode< _NodeType >{}( startNode, targetNode ) )
+    {
+        rep.onPathFound( startNode );
+        return { start };
+    }
+
+    // Fingerprints of all nodes which made it into some beam
+    std::set< Fingerprint > stored = { FingerprintNode< _NodeType >{}( startNode ) };
+
+    auto startTrail = std::make_shared< const Trail >( Trail{ start, 0, nullptr } );
+    std::shared_ptr< const Trail > bestTrail = startTrail;
+    Node bestNode = startNode;
+    size_t bestEstimate = heuristic( start );
+    size_t generated = 1;
+
+    struct Candidate
+    {
+        Node node;
+        Fingerprint fingerprint;
+        size_t estimate;
+        std::shared_ptr< const Trail > parent;
+    };
+
+    std::vector< std::shared_ptr< const Trail > > beam = { startTrail };
+    startTrail.reset();
+    while ( !beam.empty() )
+    {
+        std::vector< Candidate > candidates;
+
+        for ( const std::shared_ptr< const Trail >& current : beam )
+        {
+            std::vector< rofi::configuration::RofiWorld > descendants = getDescendants( current->world, step );
+            rep.onGenerateDescendants( descendants );
+
+            for ( const rofi::configuration::RofiWorld& childWorld : descendants )
+            {
+                if ( nodeBudget > 0 && generated >= nodeBudget )
+                {
+                    rep.onBudgetExhausted( bestNode, bestEstimate );
+                    return tracePlan( bestTrail.get() );
+                }
+
+                Node child( _NodeType, generated++, childWorld, current->distFromStart + 1, 0 );
+                Fingerprint fingerprint = FingerprintNode< _NodeType >{}( child );
+                if ( stored.contains( fingerprint ) )
+                    continue;
+
+                if ( EqualNode< _NodeType >{}( child, targetNode ) )
+                {
+                    rep.onNewNode( child );
+                    rep.onPathFound( child );
+                    std::vector< rofi::configuration::RofiWorld > plan = tracePlan( current.get() );
+                    plan.push_back( childWorld );
+                    return plan;
+                }
+
+                size_t estimate = heuristic( childWorld );
+                candidates.push_back( Candidate{ std::move( child ), fingerprint, estimate, current } );
+            }
+        }
+
+        std::ranges::stable_sort( candidates, {}, &Candidate::estimate );
+
+        // Replacing the beam frees the trails of the previous layer
+        // which have no descendant in the new one
+        beam.clear();
+        for ( Candidate& candidate : candidates )
+        {
+            if ( beam.size() >= beamWidth )
+                break;
+
+            if ( !stored.insert( candidate.fingerprint ).second )
+                continue; // the same node was generated earlier in this layer
+
+            rep.onNewNode( candidate.node );
+            beam.push_back( std::make_shared< const Trail >( 
+                Trail{ candidate.node.world, candidate.node.distFromStart, std::move( candidate.parent ) } ) );
+            if ( candidate.estimate < bestEstimate )
+            {
+                bestEstimate = candidate.estimate;
+                bestNode = std::move( candidate.node );
+                bestTrail = beam.back();
+            }
+        }
+        rep.onUpdateQueue( beam.size() );
+    }
+
+    // The beam died out without reaching the target
+    return {};
+}
+
 } // namespace rofi::shapereconfig
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <configuration/rofiworld.hpp>
 
 namespace rofi::shapereconfig {
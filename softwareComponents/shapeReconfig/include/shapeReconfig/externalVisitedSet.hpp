@@ -0,0 +1,160 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#include <configuration/rofiworld.hpp>
+#include <shapeReconfig/hashing.hpp>
+
+namespace rofi::shapereconfig {
+
+/**
+ * @brief Node of a BFS layer as stored by ExternalVisitedSet.
+ */
+struct LayerEntry
+{
+    Fingerprint fingerprint;
+    Fingerprint predecessor;
+};
+
+/**
+ * @brief Visited set of a layered (breadth-first) search which keeps only
+ * the most recent layers in memory and spills the older ones into sorted runs
+ * on disk (one file per layer).
+ * 
+ * Duplicates are detected in a delayed manner (as in external BFS): a whole
+ * new layer is checked at once, so each run on disk is read sequentially
+ * only once per layer.
+ */
+class ExternalVisitedSet
+{
+public:
+    using Layer = std::vector< LayerEntry >;
+
+    /**
+     * @param directory Directory for the runs; created if it does not exist.
+     * @param layersInMemory Number of most recent layers kept in memory.
+     */
+    ExternalVisitedSet( std::filesystem::path directory, size_t layersInMemory = 2 );
+    ~ExternalVisitedSet();
+
+    ExternalVisitedSet( const ExternalVisitedSet& ) = delete;
+    ExternalVisitedSet& operator=( const ExternalVisitedSet& ) = delete;
+
+    /**
+     * @brief Decides for each of the <sorted> fingerprints whether it is contained
+     * in any of the layers pushed so far. Assumes <sorted> is sorted.
+     * Each run is read from the position of the first fingerprint only, so
+     * a long sorted sequence can be checked in consecutive chunks.
+     */
+    std::vector< bool > contains( const std::vector< Fingerprint >& sorted ) const;
+
+    /**
+     * @brief Appends a new layer, assumes its entries are sorted by fingerprint and unique.
+     * Layers over the in-memory limit are written to disk.
+     */
+    void pushLayer( Layer layer );
+
+    /**
+     * @brief Predecessor of the node with fingerprint <fp> in the layer <depth>.
+     */
+    std::optional< Fingerprint > predecessor( size_t depth, const Fingerprint& fp ) const;
+
+    size_t layerCount() const
+    {
+        return _diskLayers + _memoryLayers.size();
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    size_t diskLayers() const
+    {
+        return _diskLayers;
+    }
+
+private:
+    std::filesystem::path runPath( size_t depth ) const;
+    void spillOldestLayer();
+
+    std::filesystem::path _directory;
+    size_t _layersInMemory;
+    std::deque< Layer > _memoryLayers; // layers [_diskLayers, layerCount())
+    size_t _diskLayers = 0; // layers [0, _diskLayers) are stored in runs
+    size_t _size = 0;
+};
+
+/**
+ * @brief Directory with a unique name created inside <parent>;
+ * it is removed together with its contents when the object is destroyed.
+ */
+class TemporaryDirectory
+{
+public:
+    explicit TemporaryDirectory( const std::filesystem::path& parent );
+    ~TemporaryDirectory();
+
+    TemporaryDirectory( const TemporaryDirectory& ) = delete;
+    TemporaryDirectory& operator=( const TemporaryDirectory& ) = delete;
+
+    const std::filesystem::path& path() const
+    {
+        return _path;
+    }
+
+private:
+    std::filesystem::path _path;
+};
+
+/**
+ * @brief Writes a sequence of BFS nodes (entry and world) into a file,
+ * so that whole layers of worlds do not have to be kept in memory.
+ */
+class NodeRunWriter
+{
+public:
+    explicit NodeRunWriter( std::filesystem::path path );
+
+    void write( const LayerEntry& entry, const rofi::configuration::RofiWorld& world );
+
+    /**
+     * @brief Flushes the run; throws if any of the writes failed.
+     */
+    void close();
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    std::filesystem::path _path;
+    std::ofstream _file;
+    size_t _size = 0;
+};
+
+/**
+ * @brief Reads the nodes written by NodeRunWriter in the same order.
+ */
+class NodeRunReader
+{
+public:
+    explicit NodeRunReader( const std::filesystem::path& path );
+
+    /**
+     * @brief Reads the next node into <entry> and <world> (prepared);
+     * returns false at the end of the run.
+     */
+    bool read( LayerEntry& entry, rofi::configuration::RofiWorld& world );
+
+private:
+    std::filesystem::path _path;
+    std::ifstream _file;
+};
+
+} // namespace rofi::shapereconfig
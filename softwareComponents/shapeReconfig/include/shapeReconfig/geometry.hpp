@@ -19,6 +19,53 @@ using Vector = arma::vec4;
  */
 class Cloud;
 
+/**
+ * @brief Orthogonal rotation of integer points by multiples of 90 degrees,
+ * given as a signed permutation of axes: rotated[i] = sign[i] * pt[axis[i]].
+ */
+struct AxisRotation
+{
+    std::array< size_t, 3 > axis;
+    std::array< int, 3 > sign;
+};
+
+namespace detail {
+
+constexpr std::array< AxisRotation, 24 > generateAxisRotations()
+{
+    constexpr std::array< std::array< size_t, 3 >, 6 > permutations = { {
+        { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, // even
+        { 0, 2, 1 }, { 2, 1, 0 }, { 1, 0, 2 }  // odd
+    } };
+
+    std::array< AxisRotation, 24 > result {};
+    size_t count = 0;
+    for ( size_t p = 0; p < permutations.size(); ++p )
+    {
+        int parity = p < 3 ? 1 : -1;
+        for ( int signs = 0; signs < 8; ++signs )
+        {
+            std::array< int, 3 > sign = { 
+                signs & 1 ? -1 : 1, 
+                signs & 2 ? -1 : 1, 
+                signs & 4 ? -1 : 1 };
+            // Determinant of a signed permutation is its parity times the product of signs;
+            // keep only rotations (reflections could change the shape)
+            if ( parity * sign[0] * sign[1] * sign[2] != 1 )
+                continue;
+            result[ count++ ] = AxisRotation{ permutations[ p ], sign };
+        }
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief All 24 orthogonal rotations in third dimension, identity first.
+ */
+inline constexpr std::array< AxisRotation, 24 > AXIS_ROTATIONS = detail::generateAxisRotations();
+
 /**
  * @brief Calculate the centroid (unweighted average) of given points.
  * Assumes the container is not empty.
@@ -33,7 +80,7 @@ Vector centroid( const std::vector< Vector >& pts );
  * Attempts to find an orthogonal rotation
  * which transforms one cloud into the other.
  */
-bool isometric( const Cloud& cop1, Cloud cop2 );
+bool isometric( const Cloud& cop1, const Cloud& cop2 );
 
 /**
  * @brief Generates a container of 24 Clouds which have the same shape as the given Cloud.
@@ -100,6 +147,19 @@ public:
         sortSpherePoints();
     }
 
+    /**
+     * @brief Rotates the points by given rotation from AXIS_ROTATIONS.
+     */
+    void rotateBy( const AxisRotation& rot )
+    {
+        for ( auto& [ radius, spherePoints ] : _spheres )
+            for ( Point& pt : spherePoints )
+                pt = { rot.sign[0] * pt[ rot.axis[0] ], 
+                       rot.sign[1] * pt[ rot.axis[1] ], 
+                       rot.sign[2] * pt[ rot.axis[2] ] };
+        sortSpherePoints();
+    }
+
     /**
      * @brief Permutate axes (X -> Y -> Z -> X).
      */
@@ -1,3 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
 #include <configuration/rofiworld.hpp>
 
 #include <shapeReconfig/geometry.hpp>
@@ -16,9 +20,10 @@ struct HashArray
 {
     size_t operator()( const std::array< ItemType, ArrLen >& arr ) const
     {
-        std::vector< size_t > tranArr( ArrLen );
-        std::ranges::transform( arr, tranArr.begin(), std::hash< ItemType >{} );
-        return std::accumulate( tranArr.begin(), tranArr.end(), size_t{}, combineHash );
+        size_t result = 0;
+        for ( const ItemType& item : arr )
+            result = combineHash( result, std::hash< ItemType >{}( item ) );
+        return result;
     }
 };
 
@@ -45,4 +50,46 @@ struct HashPairIntInt
     } 
 };
 
+/**
+ * @brief 128-bit fingerprint identifying a node of the state space
+ * without storing the node itself (used by the external-memory search).
+ */
+struct Fingerprint
+{
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    auto operator<=>( const Fingerprint& ) const = default;
+};
+
+/**
+ * @brief Accumulates integral values into a Fingerprint;
+ * two independently mixed 64-bit lanes make accidental collisions negligible.
+ */
+class FingerprintBuilder
+{
+    uint64_t _high = 0x9e3779b97f4a7c15;
+    uint64_t _low = 0xc2b2ae3d27d4eb4f;
+
+public:
+    FingerprintBuilder& add( int64_t value );
+
+    Fingerprint get() const
+    {
+        return { _high, _low };
+    }
+};
+
+/**
+ * @brief Fingerprint consistent with equalConfiguration
+ * (joint positions are rounded the same way as in RofiWorldHash).
+ */
+Fingerprint fingerprintRofiWorld( const rofi::configuration::RofiWorld& rw );
+
+/**
+ * @brief Fingerprint of the points of given cloud; to identify a shape,
+ * the cloud has to be in its canonical form (see canonCloud).
+ */
+Fingerprint fingerprintCloud( const Cloud& cop );
+
 } // namespace rofi::isoreconfig
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <configuration/rofiworld.hpp>
 #include <shapeReconfig/geometry.hpp>
 
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+namespace rofi::shapereconfig {
+
+/**
+ * @brief Phases of the search whose duration is measured by the Profiler.
+ * WorldCopy - copying a RofiWorld when generating descendants
+ * Prepare - computing positions of modules (RofiWorld::prepare)
+ * IsValid - collision checks (RofiWorld::isValid)
+ * Pca - decomposition of a world into points and their PCA (constructing a Node)
+ * Hashing - hashing of nodes in the visited sets
+ * Equality - equality checks of nodes
+ */
+enum class Phase { WorldCopy, Prepare, IsValid, Pca, Hashing, Equality };
+
+inline constexpr size_t PHASE_COUNT = 6;
+
+std::string_view phaseName( Phase phase );
+
+/**
+ * @brief Call count and duration distribution of one phase.
+ * Durations are kept in a logarithmic histogram (8 buckets per power of two),
+ * so percentiles are approximate but memory is constant.
+ */
+class PhaseStats
+{
+    static constexpr size_t SUB_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = 1 << SUB_BITS;
+    std::array< uint64_t, 65 * SUB_BUCKETS > _histogram {};
+    uint64_t _calls = 0;
+    uint64_t _totalNs = 0;
+    uint64_t _maxNs = 0;
+
+    static size_t bucketOf( uint64_t ns )
+    {
+        auto exponent = static_cast< size_t >( std::bit_width( ns ) );
+        if ( exponent <= SUB_BITS )
+            return static_cast< size_t >( ns );
+        return exponent * SUB_BUCKETS + ( ( ns >> ( exponent - SUB_BITS - 1 ) ) & ( SUB_BUCKETS - 1 ) );
+    }
+
+    static uint64_t bucketUpperBound( size_t bucket );
+
+public:
+    void add( uint64_t ns )
+    {
+        ++_calls;
+        _totalNs += ns;
+        _maxNs = std::max( _maxNs, ns );
+        ++_histogram[ bucketOf( ns ) ];
+    }
+
+    uint64_t calls() const
+    {
+        return _calls;
+    }
+
+    uint64_t totalNs() const
+    {
+        return _totalNs;
+    }
+
+    /**
+     * @brief Approximate duration (in ns) not exceeded by <fraction> of the calls.
+     */
+    uint64_t percentileNs( double fraction ) const;
+
+    nlohmann::json toJSON() const;
+};
+
+/**
+ * @brief Collects PhaseStats of all phases and the number of hash collisions
+ * (equality checks in visited sets which found different nodes with equal hashes).
+ */
+class Profiler
+{
+    std::array< PhaseStats, PHASE_COUNT > _phases;
+    uint64_t _hashCollisions = 0;
+
+public:
+    void record( Phase phase, uint64_t ns )
+    {
+        _phases[ static_cast< size_t >( phase ) ].add( ns );
+    }
+
+    void onHashCollision()
+    {
+        ++_hashCollisions;
+    }
+
+    const PhaseStats& stats( Phase phase ) const
+    {
+        return _phases[ static_cast< size_t >( phase ) ];
+    }
+
+    uint64_t hashCollisions() const
+    {
+        return _hashCollisions;
+    }
+
+    nlohmann::json toJSON() const;
+};
+
+namespace detail {
+
+/**
+ * @brief Profiler of the search running in the current thread, nullptr if profiling is off.
+ * Hashers and equality functors are stateless, so they reach the profiler through it.
+ */
+inline thread_local Profiler* activeProfiler = nullptr;
+
+/**
+ * @brief Makes given profiler (may be nullptr) active for the lifetime of the object.
+ */
+class ActiveProfiler
+{
+    Profiler* _previous;
+
+public:
+    explicit ActiveProfiler( Profiler* profiler ) : _previous( activeProfiler )
+    {
+        activeProfiler = profiler;
+    }
+
+    ~ActiveProfiler()
+    {
+        activeProfiler = _previous;
+    }
+
+    ActiveProfiler( const ActiveProfiler& ) = delete;
+    ActiveProfiler& operator=( const ActiveProfiler& ) = delete;
+};
+
+/**
+ * @brief Measures the duration of its scope as the given phase of the active profiler.
+ * Does not even read the clock if no profiler is active.
+ */
+class ScopedPhase
+{
+    using Clock = std::chrono::steady_clock;
+
+    Profiler* _profiler;
+    Phase _phase;
+    Clock::time_point _start;
+
+public:
+    explicit ScopedPhase( Phase phase ) : _profiler( activeProfiler ), _phase( phase )
+    {
+        if ( _profiler )
+            _start = Clock::now();
+    }
+
+    ~ScopedPhase()
+    {
+        if ( _profiler )
+            _profiler->record( _phase, static_cast< uint64_t >( 
+                std::chrono::duration_cast< std::chrono::nanoseconds >( Clock::now() - _start ).count() ) );
+    }
+
+    ScopedPhase( const ScopedPhase& ) = delete;
+    ScopedPhase& operator=( const ScopedPhase& ) = delete;
+};
+
+inline void onHashCollision()
+{
+    if ( activeProfiler )
+        activeProfiler->onHashCollision();
+}
+
+} // namespace detail
+
+} // namespace rofi::shapereconfig
@@ -17,9 +17,18 @@ int main(int argc, char** argv)
         .choice( Algorithm::BFStrict, "bfstrict", "BFS for state space of RoFIWorlds" )
         .choice( Algorithm::BFShape, "bfshape", "BFS for state space of Shapes" )
         .choice( Algorithm::BFSEigen, "bfseigen", "BFS for state space of PCA eigenvalues (shapes ignoring reflections)" )
-        .choice( Algorithm::ShapeStar, "shapestar", "A* with module shape heuristic for the state space of Shapes" );
+        .choice( Algorithm::ShapeStar, "shapestar", "A* with module shape heuristic for the state space of Shapes" )
+        .choice( Algorithm::ShapeIDAStar, "shapeidastar", "Iterative deepening A* with module shape heuristic (memory linear in depth)" )
+        .choice( Algorithm::ShapeBeam, "shapebeam", "Beam search with module shape heuristic (bounded number of stored nodes)" );
         
     auto & maxDepth = cli.opt<size_t>("m max", 0).desc("Maximum depth for the BFS algorithm to reach; 0 for no limit");
+    auto & nodeBudget = cli.opt<size_t>("budget", 0)
+        .desc("Maximum number of nodes generated by shapeidastar and shapebeam; 0 for no limit. "
+              "When exhausted, the search fails unless --partial is given");
+    auto & partial = cli.opt< bool >( "partial", false )
+        .desc( "When the node budget runs out, write the best partial path found instead of failing "
+               "(marked by budgetExhausted in the JSON output)" );
+    auto & beamWidth = cli.opt<size_t>("beam-width", 100).desc("Number of nodes kept in each layer by shapebeam");
 
     auto & startInputFile = cli.opt< std::filesystem::path >( "<start_world_file>" )
         .defaultDesc( {} )
@@ -53,6 +62,17 @@ int main(int argc, char** argv)
 
     auto & step = cli.opt<int>("step", 90).desc("Degree of rotation for 1 step");
 
+    auto & externalDir = cli.opt< std::filesystem::path >( "external" )
+        .valueDesc( "directory" )
+        .desc( "Run BFS in the external-memory mode, storing older layers of visited nodes and the BFS frontier in given directory" );
+    auto & memoryLayers = cli.opt< size_t >( "memory-layers", 2 )
+        .desc( "Number of most recent BFS layers kept in memory in the external-memory mode" );
+    auto & memoryNodes = cli.opt< size_t >( "memory-nodes", ExternalMemoryOptions{}.nodesInMemory )
+        .desc( "Maximal number of RofiWorlds kept in memory at once in the external-memory mode" );
+
+    auto & profile = cli.opt< bool >( "profile", false )
+        .desc( "Measure individual phases of the search (world copying, prepare, isValid, PCA, hashing, equality) and report them in the JSON output" );
+
     if (!cli.parse(argc, argv))
         return cli.printError(std::cerr); // prints error and returns cli.exitCode()
 
@@ -87,29 +107,77 @@ int main(int argc, char** argv)
     }
 
     Reporter rep;
+    if ( *profile )
+        rep.enableProfiling();
     std::vector< RofiWorld > result;
 
-    switch ( *algo )
+    if ( !externalDir->empty() )
+    {
+        ExternalMemoryOptions opts{ *externalDir, *memoryLayers, *memoryNodes };
+        switch ( *algo )
+        {
+        case Algorithm::BFStrict:
+            result = bfsExternal< NodeType::World >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, opts, *maxDepth );
+            break;
+        case Algorithm::BFShape:
+            result = bfsExternal< NodeType::EigenCloud >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, opts, *maxDepth );
+            break;
+        case Algorithm::BFSEigen:
+            result = bfsExternal< NodeType::Eigen >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, opts, *maxDepth );
+            break;
+        case Algorithm::ShapeStar:
+        case Algorithm::ShapeIDAStar:
+        case Algorithm::ShapeBeam:
+            cli.fail( EXIT_FAILURE, "External-memory mode is supported only by the BFS algorithms" );
+            return cli.printError(std::cerr);
+        }
+    }
+    else
     {
-    case Algorithm::BFStrict:
-        result = bfs< NodeType::World >( *start, *target, 
-            Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
-        break;
-    case Algorithm::BFShape:
-        result = bfs< NodeType::EigenCloud >( *start, *target, 
-            Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
-        break;
-    case Algorithm::BFSEigen:
-        result = bfs< NodeType::Eigen >( *start, *target, 
-            Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
-        break;
-    case Algorithm::ShapeStar:
-        result = shapeStar< NodeType::EigenCloud >( *start, *target, 
-            Angle::deg( static_cast<float>( *step ) ).rad(), rep );
-        break;
+        switch ( *algo )
+        {
+        case Algorithm::BFStrict:
+            result = bfs< NodeType::World >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
+            break;
+        case Algorithm::BFShape:
+            result = bfs< NodeType::EigenCloud >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
+            break;
+        case Algorithm::BFSEigen:
+            result = bfs< NodeType::Eigen >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, *maxDepth );
+            break;
+        case Algorithm::ShapeStar:
+            result = shapeStar< NodeType::EigenCloud >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep );
+            break;
+        case Algorithm::ShapeIDAStar:
+            result = shapeIdaStar< NodeType::EigenCloud >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, *nodeBudget );
+            break;
+        case Algorithm::ShapeBeam:
+            if ( *beamWidth == 0 ) {
+                cli.fail( EXIT_FAILURE, "Beam width has to be positive" );
+                return cli.printError(std::cerr);
+            }
+            result = shapeBeam< NodeType::EigenCloud >( *start, *target, 
+                Angle::deg( static_cast<float>( *step ) ).rad(), rep, *beamWidth, *nodeBudget );
+            break;
+        }
     }
 
     std::cout << rep.toJSON().dump() << "\n";
+    if ( rep.budgetExhausted() && !*partial )
+    {
+        cli.fail( EXIT_FAILURE, "Node budget ran out before the target was reached",
+            "use --partial to write the best partial plan found" );
+        return cli.printError(std::cerr);
+    }
+
     std::ofstream out( *outputPath );
     if ( auto written = writeRofiWorldSeq( out, result, *outputFormat ); !written )
     {
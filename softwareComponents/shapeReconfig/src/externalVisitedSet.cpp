@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <configuration/serialization.hpp>
+#include <shapeReconfig/externalVisitedSet.hpp>
+
+namespace rofi::shapereconfig {
+
+namespace {
+
+constexpr size_t RUN_CHUNK_SIZE = 1 << 16;
+
+bool entryLess( const LayerEntry& entry, const Fingerprint& fp )
+{
+    return entry.fingerprint < fp;
+}
+
+/**
+ * @brief Marks fingerprints of <sorted> (starting from <pos>) equal to some entry
+ * of the sorted range [<first>, <last>); returns the position to continue from.
+ */
+size_t markContained( const std::vector< Fingerprint >& sorted, std::vector< bool >& result, 
+    size_t pos, const LayerEntry* first, const LayerEntry* last )
+{
+    while ( pos < sorted.size() && first != last )
+    {
+        if ( sorted[ pos ] < first->fingerprint )
+            ++pos;
+        else if ( first->fingerprint < sorted[ pos ] )
+            ++first;
+        else
+            result[ pos++ ] = true;
+    }
+    return pos;
+}
+
+/**
+ * @brief Index of the first entry of the <run> (with <count> entries)
+ * whose fingerprint is not less than <fp>; found by binary search in the file.
+ */
+size_t runLowerBound( std::ifstream& run, size_t count, const Fingerprint& fp )
+{
+    size_t low = 0;
+    size_t high = count;
+    LayerEntry entry;
+    while ( low < high )
+    {
+        size_t mid = low + ( high - low ) / 2;
+        run.seekg( static_cast< std::streamoff >( mid * sizeof( LayerEntry ) ) );
+        run.read( reinterpret_cast< char* >( &entry ), sizeof( LayerEntry ) );
+        if ( entry.fingerprint < fp )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+} // namespace
+
+ExternalVisitedSet::ExternalVisitedSet( std::filesystem::path directory, size_t layersInMemory ) :
+    _directory( std::move( directory ) ),
+    _layersInMemory( std::max( layersInMemory, size_t( 1 ) ) )
+{
+    std::filesystem::create_directories( _directory );
+}
+
+ExternalVisitedSet::~ExternalVisitedSet()
+{
+    std::error_code ec; // Ignore errors, the runs are only temporary
+    for ( size_t depth = 0; depth < _diskLayers; ++depth )
+        std::filesystem::remove( runPath( depth ), ec );
+}
+
+std::filesystem::path ExternalVisitedSet::runPath( size_t depth ) const
+{
+    return _directory / fmt::format( "layer-{}.run", depth );
+}
+
+std::vector< bool > ExternalVisitedSet::contains( const std::vector< Fingerprint >& sorted ) const
+{
+    assert( std::ranges::is_sorted( sorted ) );
+    std::vector< bool > result( sorted.size(), false );
+    if ( sorted.empty() )
+        return result;
+
+    for ( const Layer& layer : _memoryLayers )
+    {
+        auto first = std::lower_bound( layer.begin(), layer.end(), sorted.front(), entryLess );
+        markContained( sorted, result, 0, std::to_address( first ), layer.data() + layer.size() );
+    }
+
+    // Each run is read sequentially in chunks (from the first fingerprint on)
+    // and merged with the sorted fingerprints
+    std::vector< LayerEntry > chunk( RUN_CHUNK_SIZE );
+    for ( size_t depth = 0; depth < _diskLayers; ++depth )
+    {
+        std::ifstream run( runPath( depth ), std::ios::binary | std::ios::ate );
+        if ( !run )
+            throw std::runtime_error( fmt::format( "Cannot open run '{}'", runPath( depth ).string() ) );
+
+        size_t count = static_cast< size_t >( run.tellg() ) / sizeof( LayerEntry );
+        size_t first = runLowerBound( run, count, sorted.front() );
+        run.clear();
+        run.seekg( static_cast< std::streamoff >( first * sizeof( LayerEntry ) ) );
+
+        size_t pos = 0;
+        while ( pos < sorted.size() && run )
+        {
+            run.read( reinterpret_cast< char* >( chunk.data() ), 
+                static_cast< std::streamsize >( chunk.size() * sizeof( LayerEntry ) ) );
+            auto count = static_cast< size_t >( run.gcount() ) / sizeof( LayerEntry );
+            pos = markContained( sorted, result, pos, chunk.data(), chunk.data() + count );
+        }
+    }
+
+    return result;
+}
+
+void ExternalVisitedSet::pushLayer( Layer layer )
+{
+    assert( std::ranges::is_sorted( layer, {}, &LayerEntry::fingerprint ) );
+    _size += layer.size();
+    _memoryLayers.push_back( std::move( layer ) );
+
+    while ( _memoryLayers.size() > _layersInMemory )
+        spillOldestLayer();
+}
+
+void ExternalVisitedSet::spillOldestLayer()
+{
+    assert( !_memoryLayers.empty() );
+    const Layer& layer = _memoryLayers.front();
+
+    std::ofstream run( runPath( _diskLayers ), std::ios::binary | std::ios::trunc );
+    run.write( reinterpret_cast< const char* >( layer.data() ), 
+        static_cast< std::streamsize >( layer.size() * sizeof( LayerEntry ) ) );
+    if ( !run )
+        throw std::runtime_error( fmt::format( "Cannot write run '{}'", runPath( _diskLayers ).string() ) );
+
+    _memoryLayers.pop_front();
+    ++_diskLayers;
+}
+
+std::optional< Fingerprint > ExternalVisitedSet::predecessor( size_t depth, const Fingerprint& fp ) const
+{
+    if ( depth >= layerCount() )
+        return std::nullopt;
+
+    if ( depth >= _diskLayers )
+    {
+        const Layer& layer = _memoryLayers[ depth - _diskLayers ];
+        auto it = std::lower_bound( layer.begin(), layer.end(), fp, entryLess );
+        if ( it == layer.end() || it->fingerprint != fp )
+            return std::nullopt;
+        return it->predecessor;
+    }
+
+    // Binary search directly in the run
+    std::ifstream run( runPath( depth ), std::ios::binary | std::ios::ate );
+    if ( !run )
+        throw std::runtime_error( fmt::format( "Cannot open run '{}'", runPath( depth ).string() ) );
+
+    size_t count = static_cast< size_t >( run.tellg() ) / sizeof( LayerEntry );
+    size_t index = runLowerBound( run, count, fp );
+    if ( index == count )
+        return std::nullopt;
+
+    LayerEntry entry;
+    run.seekg( static_cast< std::streamoff >( index * sizeof( LayerEntry ) ) );
+    run.read( reinterpret_cast< char* >( &entry ), sizeof( LayerEntry ) );
+    if ( entry.fingerprint != fp )
+        return std::nullopt;
+    return entry.predecessor;
+}
+
+TemporaryDirectory::TemporaryDirectory( const std::filesystem::path& parent )
+{
+    std::filesystem::create_directories( parent );
+    std::random_device random;
+    for ( int attempt = 0; attempt < 100; ++attempt )
+    {
+        std::filesystem::path candidate = parent / fmt::format( "bfs-{:08x}", random() );
+        if ( std::filesystem::create_directory( candidate ) )
+        {
+            _path = std::move( candidate );
+            return;
+        }
+    }
+    throw std::runtime_error( fmt::format( "Cannot create a temporary directory in '{}'", parent.string() ) );
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+    std::error_code ec; // Never throw from the destructor, the directory is only temporary
+    std::filesystem::remove_all( _path, ec );
+}
+
+NodeRunWriter::NodeRunWriter( std::filesystem::path path ) :
+    _path( std::move( path ) ),
+    _file( _path, std::ios::binary | std::ios::trunc )
+{
+    if ( !_file )
+        throw std::runtime_error( fmt::format( "Cannot create run '{}'", _path.string() ) );
+}
+
+void NodeRunWriter::write( const LayerEntry& entry, const rofi::configuration::RofiWorld& world )
+{
+    std::vector< std::uint8_t > data = nlohmann::json::to_cbor( rofi::configuration::serialization::toJSON( world ) );
+    uint64_t length = data.size();
+    _file.write( reinterpret_cast< const char* >( &entry ), sizeof( LayerEntry ) );
+    _file.write( reinterpret_cast< const char* >( &length ), sizeof( length ) );
+    _file.write( reinterpret_cast< const char* >( data.data() ), static_cast< std::streamsize >( length ) );
+    ++_size;
+}
+
+void NodeRunWriter::close()
+{
+    _file.close();
+    if ( !_file )
+        throw std::runtime_error( fmt::format( "Cannot write run '{}'", _path.string() ) );
+}
+
+NodeRunReader::NodeRunReader( const std::filesystem::path& path ) :
+    _path( path ),
+    _file( path, std::ios::binary )
+{
+    if ( !_file )
+        throw std::runtime_error( fmt::format( "Cannot open run '{}'", _path.string() ) );
+}
+
+bool NodeRunReader::read( LayerEntry& entry, rofi::configuration::RofiWorld& world )
+{
+    uint64_t length = 0;
+    if ( !_file.read( reinterpret_cast< char* >( &entry ), sizeof( LayerEntry ) ) )
+        return false;
+    std::vector< std::uint8_t > data;
+    if ( _file.read( reinterpret_cast< char* >( &length ), sizeof( length ) ) )
+    {
+        data.resize( length );
+        _file.read( reinterpret_cast< char* >( data.data() ), static_cast< std::streamsize >( length ) );
+    }
+    if ( !_file )
+        throw std::runtime_error( fmt::format( "Truncated run '{}'", _path.string() ) );
+
+    world = rofi::configuration::serialization::fromJSON( nlohmann::json::from_cbor( data ) );
+    world.prepare().get_or_throw_as< std::runtime_error >();
+    return true;
+}
+
+} // namespace rofi::shapereconfig
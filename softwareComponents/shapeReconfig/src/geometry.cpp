@@ -15,54 +15,148 @@ Vector centroid( const std::vector< Vector >& pts )
     return result;
 }
 
-bool isometric( const Cloud& cop1, Cloud cop2 )
+namespace {
+
+using Point = std::array< int, 3 >;
+
+/**
+ * @brief Points of one sphere of a Cloud stored as three flat coordinate arrays,
+ * so rotating them is a plain (vectorizable) copy with a sign per axis.
+ */
+struct FlatSphere
+{
+    size_t radius;
+    std::array< std::vector< int >, 3 > coords;
+
+    size_t size() const
+    {
+        return coords[0].size();
+    }
+};
+
+std::vector< FlatSphere > flattenCloud( const Cloud& cop )
+{
+    std::vector< FlatSphere > result;
+    result.reserve( cop.size() );
+
+    for ( const auto& [ radius, spherePoints ] : cop )
+    {
+        FlatSphere& sphere = result.emplace_back();
+        sphere.radius = radius;
+        for ( size_t ax = 0; ax < 3; ++ax )
+        {
+            sphere.coords[ ax ].resize( spherePoints.size() );
+            for ( size_t i = 0; i < spherePoints.size(); ++i )
+                sphere.coords[ ax ][ i ] = spherePoints[ i ][ ax ];
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Rotates the points of given sphere into <out> and sorts them.
+ */
+void rotateSphere( const FlatSphere& sphere, const AxisRotation& rot, std::vector< Point >& out )
+{
+    out.resize( sphere.size() );
+    for ( size_t ax = 0; ax < 3; ++ax )
+    {
+        const int* src = sphere.coords[ rot.axis[ ax ] ].data();
+        int sign = rot.sign[ ax ];
+        for ( size_t i = 0; i < out.size(); ++i )
+            out[ i ][ ax ] = sign * src[ i ];
+    }
+    std::ranges::sort( out );
+}
+
+} // namespace
+
+bool isometric( const Cloud& cop1, const Cloud& cop2 )
 {
     // Assume different number of points implies nonequal shapes
     // (even if points overlap)
     if ( cop1.size() != cop2.size() )
         return false;
 
-    // Go through 24 orthogonal rotations in third dimension
-    // (8 octants, each of which can have the axes arranged in 3 ways)
-    for ( size_t hp = 0; hp < 2; ++hp ) 
+    // Rotations preserve the radii and sizes of spheres
+    if ( !std::equal( cop1.begin(), cop1.end(), cop2.begin(), 
+            []( const auto& sphere1, const auto& sphere2 ) {
+                return sphere1.first == sphere2.first && sphere1.second.size() == sphere2.second.size();
+            } ) )
+        return false;
+
+    std::vector< FlatSphere > flat2 = flattenCloud( cop2 );
+    std::vector< Point > rotated;
+
+    // Go through 24 orthogonal rotations in third dimension,
+    // stop comparing a rotation at the first sphere which does not match
+    for ( const AxisRotation& rot : AXIS_ROTATIONS )
     {
-        for ( size_t rot = 0; rot < 4; ++rot ) 
+        bool matches = true;
+        auto sphere1 = cop1.begin();
+        for ( const FlatSphere& sphere2 : flat2 )
         {
-            for ( size_t permut = 0; permut < 3; ++permut )  
+            rotateSphere( sphere2, rot, rotated );
+            if ( rotated != sphere1->second )
             {
-                if ( cop1 == cop2 ) 
-                    return true;
-                
-                cop2.permutateAxes(); // Permute axes in current octant
+                matches = false;
+                break;
             }
-            cop2.rotateBy90Around( 0 ); // Rotating Y and Z around X
+            ++sphere1;
         }
-        cop2.rotateBy180Around( 2 ); // Rotate X upside down along Z (bottom octants)
+
+        if ( matches )
+            return true;
     }
     
     return false;
 }
 
+std::vector< Cloud > sameShapeClouds( Cloud cop )
+{
+    std::vector< Cloud > result;
+    result.reserve( AXIS_ROTATIONS.size() );
+
+    for ( const AxisRotation& rot : AXIS_ROTATIONS )
+    {
+        result.push_back( cop );
+        result.back().rotateBy( rot );
+    }
+
+    return result;
+}
+
 Cloud canonCloud( Cloud cop )
 {
-    Cloud res = cop;
+    std::vector< FlatSphere > flat = flattenCloud( cop );
 
-    for ( size_t hp = 0; hp < 2; ++hp ) 
+    // Rotations which still produce the largest cloud;
+    // spheres are compared one by one and the rotations giving a smaller sphere
+    // are dropped, so their remaining spheres are never rotated and sorted
+    std::vector< size_t > candidates( AXIS_ROTATIONS.size() );
+    std::iota( candidates.begin(), candidates.end(), 0 );
+    std::vector< std::vector< Point > > rotated( AXIS_ROTATIONS.size() );
+
+    auto sphere = cop.begin();
+    for ( const FlatSphere& flatSphere : flat )
     {
-        for ( size_t rot = 0; rot < 4; ++rot ) 
+        size_t best = candidates.front();
+        for ( size_t rotId : candidates )
         {
-            for ( size_t permut = 0; permut < 3; ++permut )  
-            {
-                res = std::max( res, cop );
-                
-                cop.permutateAxes(); // Permute axes in current octant
-            }
-            cop.rotateBy90Around( 0 ); // Rotating Y and Z around X
+            rotateSphere( flatSphere, AXIS_ROTATIONS[ rotId ], rotated[ rotId ] );
+            if ( rotated[ rotId ] > rotated[ best ] )
+                best = rotId;
         }
-        cop.rotateBy180Around( 2 ); // Rotate X upside down along Z (bottom octants)
+
+        std::erase_if( candidates, [ & ]( size_t rotId ) { return rotated[ rotId ] != rotated[ best ]; } );
+        assert( !candidates.empty() );
+
+        sphere->second.swap( rotated[ best ] );
+        ++sphere;
     }
 
-    return res;
+    return cop;
 }
 
 } // namespace rofi::shapereconfig
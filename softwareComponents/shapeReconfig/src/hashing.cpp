@@ -91,4 +91,78 @@ size_t HashCloud::operator()( const Cloud& cop ) const
     return std::accumulate( transCop.begin(), transCop.end(), size_t{}, combineHash );
 }
 
+namespace {
+
+uint64_t mixBits( uint64_t x )
+{
+    // Finalizer of splitmix64
+    x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9;
+    x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111eb;
+    return x ^ ( x >> 31 );
+}
+
+int64_t roundRad( float rads )
+{
+    return static_cast< int64_t >( round( rads * 100 ) );
+}
+
+void addJoint( FingerprintBuilder& builder, const rofi::configuration::Joint& j )
+{
+    for ( const auto& [ lower, upper ] : j.jointLimits() )
+        builder.add( roundRad( lower ) ).add( roundRad( upper ) );
+    for ( float pos : j.positions() )
+        builder.add( roundRad( pos ) );
+}
+
+} // namespace
+
+FingerprintBuilder& FingerprintBuilder::add( int64_t value )
+{
+    auto bits = static_cast< uint64_t >( value );
+    _high = mixBits( _high ^ bits ) + 0x632be59bd9b4e019;
+    _low = mixBits( _low + bits * 0xff51afd7ed558ccd ) ^ ( _low >> 29 );
+    return *this;
+}
+
+Fingerprint fingerprintRofiWorld( const rofi::configuration::RofiWorld& rw )
+{
+    FingerprintBuilder builder;
+
+    for ( const rofi::configuration::Module& rModule : rw.modules() )
+    {
+        builder.add( static_cast< int64_t >( rModule.type ) ).add( rModule.getId() );
+        for ( const rofi::configuration::ComponentJoint& cj : rModule.joints() )
+        {
+            builder.add( cj.sourceComponent ).add( cj.destinationComponent );
+            addJoint( builder, *cj.joint );
+        }
+    }
+
+    for ( const rofi::configuration::RoficomJoint& rj : rw.roficomConnections() )
+    {
+        builder.add( static_cast< int64_t >( rj.orientation ) )
+            .add( static_cast< int64_t >( rj.sourceModule ) )
+            .add( static_cast< int64_t >( rj.destModule ) )
+            .add( rj.sourceConnector )
+            .add( rj.destConnector );
+        addJoint( builder, rj );
+    }
+
+    return builder.get();
+}
+
+Fingerprint fingerprintCloud( const Cloud& cop )
+{
+    FingerprintBuilder builder;
+
+    for ( const auto& [ radius, spherePoints ] : cop )
+    {
+        builder.add( static_cast< int64_t >( radius ) ).add( static_cast< int64_t >( spherePoints.size() ) );
+        for ( const std::array< int, 3 >& pt : spherePoints )
+            builder.add( pt[0] ).add( pt[1] ).add( pt[2] );
+    }
+
+    return builder.get();
+}
+
 } // namespace rofi::shapereconfig
@@ -0,0 +1,77 @@
+#include <cassert>
+#include <cmath>
+
+#include <shapeReconfig/profiling.hpp>
+
+namespace rofi::shapereconfig {
+
+std::string_view phaseName( Phase phase )
+{
+    switch ( phase )
+    {
+    case Phase::WorldCopy:
+        return "worldCopy";
+    case Phase::Prepare:
+        return "prepare";
+    case Phase::IsValid:
+        return "isValid";
+    case Phase::Pca:
+        return "pca";
+    case Phase::Hashing:
+        return "hashing";
+    case Phase::Equality:
+        return "equality";
+    }
+    assert( false && "Unknown phase" );
+    return "unknown";
+}
+
+uint64_t PhaseStats::bucketUpperBound( size_t bucket )
+{
+    if ( bucket < ( SUB_BITS + 1 ) * SUB_BUCKETS )
+        return bucket;
+    size_t exponent = bucket / SUB_BUCKETS;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    // Values in the bucket have <exponent> bits, the top ones of them are 1<sub>
+    return ( ( SUB_BUCKETS + sub + 1 ) << ( exponent - SUB_BITS - 1 ) ) - 1;
+}
+
+uint64_t PhaseStats::percentileNs( double fraction ) const
+{
+    if ( _calls == 0 )
+        return 0;
+
+    auto threshold = static_cast< uint64_t >( std::ceil( fraction * static_cast< double >( _calls ) ) );
+    uint64_t seen = 0;
+    for ( size_t bucket = 0; bucket < _histogram.size(); ++bucket )
+    {
+        seen += _histogram[ bucket ];
+        if ( seen >= threshold && seen > 0 )
+            return std::min( bucketUpperBound( bucket ), _maxNs );
+    }
+    return _maxNs;
+}
+
+nlohmann::json PhaseStats::toJSON() const
+{
+    nlohmann::json res;
+    res[ "calls" ] = _calls;
+    res[ "totalMs" ] = static_cast< double >( _totalNs ) / 1e6;
+    res[ "meanNs" ] = _calls == 0 ? 0 : _totalNs / _calls;
+    res[ "p50Ns" ] = percentileNs( 0.5 );
+    res[ "p90Ns" ] = percentileNs( 0.9 );
+    res[ "p99Ns" ] = percentileNs( 0.99 );
+    res[ "maxNs" ] = _maxNs;
+    return res;
+}
+
+nlohmann::json Profiler::toJSON() const
+{
+    nlohmann::json res;
+    for ( size_t i = 0; i < PHASE_COUNT; ++i )
+        res[ std::string( phaseName( Phase( i ) ) ) ] = _phases[ i ].toJSON();
+    res[ "hashCollisions" ] = _hashCollisions;
+    return res;
+}
+
+} // namespace rofi::shapereconfig
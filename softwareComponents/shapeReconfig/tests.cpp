@@ -3,6 +3,7 @@
 #include <configuration/universalModule.hpp> 
 #include <configuration/serialization.hpp>
 
+#include <shapeReconfig/algorithms.hpp>
 #include <shapeReconfig/isomorphic.hpp>
 #include <shapeReconfig/equality.hpp>
 
@@ -432,10 +433,138 @@ void testStrictEquality()
     assert( equalConfiguration( A1Copy, A1 ) );
 }
 
+void testCanonCloud()
+{
+    // Canonical clouds must agree with isometry
+    assert( rofiWorldToShape( A1 ) == rofiWorldToShape( A2 ) );
+    assert( rofiWorldToShape( A1 ) == rofiWorldToShape( A4 ) );
+    assert( rofiWorldToShape( TripleA1 ) == rofiWorldToShape( TripleA2 ) );
+    assert( rofiWorldToShape( A1 ) != rofiWorldToShape( B1 ) );
+    assert( rofiWorldToShape( TripleA1 ) != rofiWorldToShape( TripleB1 ) );
+
+    // Every rotation of a cloud has the same canonical form
+    Cloud cloud = rofiWorldToCloud( TripleA1 );
+    Cloud canon = canonCloud( cloud );
+    for ( const Cloud& rotated : sameShapeClouds( cloud ) )
+    {
+        assert( isometric( cloud, rotated ) );
+        assert( canonCloud( rotated ) == canon );
+    }
+}
+
+template < NodeType _NodeType >
+void testExternalBfsPair( const RofiWorld& start, const RofiWorld& target )
+{
+    // Tiny limits, so that layers are spilled and candidates are merged from several runs
+    auto directory = std::filesystem::temp_directory_path() / "rofi-shapereconfig-test";
+    ExternalMemoryOptions opts{ directory, 1, 4 };
+    float step = Angle::deg( 90 ).rad();
+
+    Reporter rep;
+    std::vector< RofiWorld > expected = bfs< _NodeType >( start, target, step, rep );
+    Reporter externalRep;
+    std::vector< RofiWorld > path = bfsExternal< _NodeType >( start, target, step, externalRep, opts );
+
+    assert( !expected.empty() );
+    assert( path.size() == expected.size() );
+    assert( equalConfiguration( path.front(), start ) );
+    assert( detail::EqualNode< _NodeType >{}( Node( _NodeType, 0, path.back(), 0, 0 ), Node( _NodeType, 0, target, 0, 0 ) ) );
+
+    // The runs are removed together with their temporary directory
+    assert( std::filesystem::is_empty( directory ) );
+    std::filesystem::remove( directory );
+}
+
+RofiWorld rofiWorldFromString( const std::string& text )
+{
+    std::istringstream input( text );
+    RofiWorld result = readOldConfigurationFormat( input );
+
+    const auto identity = arma::mat(4, 4, arma::fill::eye);
+    connect< RigidJoint >( (*result.modules().begin()).bodies().front(), { 0, 0, 0 }, identity );
+    result.prepare().get_or_throw_as< std::runtime_error >();
+
+    return result;
+}
+
+void testExternalBfs()
+{
+    auto pairStart = rofiWorldFromString( "C\nM 0 0 0 0\nM 1 0 0 0\nE 0 A -Z N -Z B 1\n" );
+    auto pairTarget = rofiWorldFromString( "C\nM 0 0 0 90\nM 1 0 0 90\nE 0 A -Z N -Z B 1\n" );
+
+    testExternalBfsPair< NodeType::World >( A1, A3 );
+    testExternalBfsPair< NodeType::World >( pairStart, pairTarget );
+    testExternalBfsPair< NodeType::EigenCloud >( pairStart, pairTarget );
+}
+
+bool isPlan( const std::vector< RofiWorld >& plan, const RofiWorld& start, float step )
+{
+    if ( plan.empty() || !equalConfiguration( plan.front(), start ) )
+        return false;
+    for ( size_t i = 0; i + 1 < plan.size(); ++i )
+    {
+        std::vector< RofiWorld > descendants = detail::getDescendants( plan[ i ], step );
+        bool isDescendant = std::ranges::any_of( descendants, [ & ]( const RofiWorld& world ) {
+            return equalConfiguration( world, plan[ i + 1 ] );
+        } );
+        if ( !isDescendant )
+            return false;
+    }
+    return true;
+}
+
+void testMemoryBoundedSearch()
+{
+    auto start = rofiWorldFromString( "C\nM 0 0 0 0\nM 1 0 0 0\nE 0 A -Z N -Z B 1\n" );
+    auto target = rofiWorldFromString( "C\nM 0 90 0 0\nM 1 0 -90 90\nE 0 A -Z N -Z B 1\n" );
+    float step = Angle::deg( 90 ).rad();
+    Node targetNode( NodeType::EigenCloud, 0, target, 0, 0 );
+    auto reachesTarget = [ & ]( const std::vector< RofiWorld >& plan ) {
+        return detail::EqualNode< NodeType::EigenCloud >{}( Node( NodeType::EigenCloud, 0, plan.back(), 0, 0 ), targetNode );
+    };
+
+    Reporter bfsRep;
+    std::vector< RofiWorld > shortest = bfs< NodeType::EigenCloud >( start, target, step, bfsRep );
+    assert( shortest.size() > 2 );
+
+    // IDA* is optimal and reports every node of its final search tree once
+    Reporter idaRep;
+    std::vector< RofiWorld > idaPlan = shapeIdaStar< NodeType::EigenCloud >( start, target, step, idaRep );
+    assert( isPlan( idaPlan, start, step ) );
+    assert( reachesTarget( idaPlan ) );
+    assert( idaPlan.size() == shortest.size() );
+    assert( !idaRep.budgetExhausted() );
+    auto idaJson = idaRep.toJSON();
+    size_t layerSum = 0;
+    for ( size_t count : idaJson[ "layerNodes" ] )
+        layerSum += count;
+    assert( layerSum == idaJson[ "totalNodes" ] );
+
+    Reporter beamRep;
+    std::vector< RofiWorld > beamPlan = shapeBeam< NodeType::EigenCloud >( start, target, step, beamRep, 64 );
+    assert( isPlan( beamPlan, start, step ) );
+    assert( reachesTarget( beamPlan ) );
+    assert( beamPlan.size() >= shortest.size() );
+
+    // An exhausted budget gives a partial plan, not a failure
+    Reporter idaBudgetRep;
+    std::vector< RofiWorld > idaPartial = shapeIdaStar< NodeType::EigenCloud >( start, target, step, idaBudgetRep, 3 );
+    assert( idaBudgetRep.budgetExhausted() );
+    assert( isPlan( idaPartial, start, step ) );
+
+    Reporter beamBudgetRep;
+    std::vector< RofiWorld > beamPartial = shapeBeam< NodeType::EigenCloud >( start, target, step, beamBudgetRep, 64, 3 );
+    assert( beamBudgetRep.budgetExhausted() );
+    assert( isPlan( beamPartial, start, step ) );
+}
+
 int main(int argc, char** argv) 
 {
     testOne90();
     testThree();
     testStrictEquality();
+    testCanonCloud();
+    testExternalBfs();
+    testMemoryBoundedSearch();
     std::cout << "All tests have passed.\n";
 }
@@ -1,8 +1,11 @@
 #include <z3++.h>
 #include "smtReconfig.hpp"
+#include "smtDiscrete.hpp"
 #include <IO.h>
+#include <iterator>
 #include <vector>
 #include <string>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <chrono>
@@ -10,6 +13,15 @@
 #include <cmath>
 #include <cstdlib>
 #include <cxxopts.hpp>
+#include <climits>
+#include <csignal>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 struct StopWatch {
     void start() {
@@ -29,24 +41,28 @@ struct StopWatch {
 };
 
 struct YicesProcSolver {
-    YicesProcSolver( z3::solver& s ): _solver( s ) {}
+    YicesProcSolver( z3::solver& s, std::string name = "/tmp/yices" ):
+        _solver( s ), _name( std::move( name ) )
+    {}
 
     z3::check_result check() {
-        std::ofstream outputFile( "/tmp/yicesFormula.smt2" );
+        const std::string formulaFile = _name + "Formula.smt2";
+        const std::string resultFile = _name + "Output.txt";
+        std::ofstream outputFile( formulaFile );
         outputFile << _solver.to_smt2() << "\n(get-model)\n";
         outputFile.close();
 
-        int r = system( "sed -i \"2i (set-logic QF_NRA )\" /tmp/yicesFormula.smt2" );
+        int r = system( fmt::format( "sed -i \"2i (set-logic QF_NRA )\" {}",
+            formulaFile ).c_str() );
         if ( r )
             return z3::unknown;
-        r = system( "yices-smt2 /tmp/yicesFormula.smt2 > /tmp/yicesOutput.txt" );
-        if ( r )
+        if ( !_run( formulaFile, resultFile ) )
             return z3::unknown;
-        std::ifstream in( "/tmp/yicesOutput.txt" );
+        std::ifstream in( resultFile );
         std::string result;
         std::getline( in, result );
         if ( result.find( "unknown" ) == 0 )
-            return z3::sat;
+            return z3::unknown;
         if ( result.find( "unsat" ) == 0 )
             return z3::unsat;
         // Process model
@@ -57,6 +73,47 @@ struct YicesProcSolver {
         return z3::sat;
     }
 
+    // Removes the formula and output files written by check()
+    void removeFiles() const {
+        std::error_code ignored;
+        std::filesystem::remove( _name + "Formula.smt2", ignored );
+        std::filesystem::remove( _name + "Output.txt", ignored );
+    }
+
+    // Kills the running yices process; a pending check returns unknown
+    void cancel() {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _cancelled = true;
+        if ( _pid > 0 )
+            kill( _pid, SIGKILL );
+    }
+
+    bool _run( const std::string& formulaFile, const std::string& resultFile ) {
+        std::unique_lock< std::mutex > lock( _mutex );
+        if ( _cancelled )
+            return false;
+        pid_t pid = fork();
+        if ( pid < 0 )
+            return false;
+        if ( pid == 0 ) {
+            int fd = open( resultFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+            if ( fd < 0 )
+                _exit( 127 );
+            dup2( fd, STDOUT_FILENO );
+            execlp( "yices-smt2", "yices-smt2", formulaFile.c_str(), nullptr );
+            _exit( 127 );
+        }
+        _pid = pid;
+        lock.unlock();
+
+        int status = 0;
+        waitpid( pid, &status, 0 );
+
+        lock.lock();
+        _pid = 0;
+        return !_cancelled && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+    }
+
     void _parseModelLine( const std::string& line ) {
         std::istringstream s( line );
         std::string prefix;
@@ -87,6 +144,8 @@ struct YicesProcSolver {
     }
 
     bool getBool( const z3::expr& var ) const {
+        if ( var.is_true() || var.is_false() )
+            return var.is_true();
         auto val = getString( var );
         if ( val == "true" )
             return true;
@@ -101,7 +160,11 @@ struct YicesProcSolver {
     }
 
     z3::solver& _solver;
+    std::string _name;
     std::map< std::string, std::string > _model;
+    std::mutex _mutex;
+    pid_t _pid = 0;
+    bool _cancelled = false;
 };
 
 float radToDeg( float val ) {
@@ -175,6 +238,34 @@ Configuration reconstruct( const rofi::smtr::SmtConfiguration& smtCfg,
     return cfg;
 }
 
+Configuration reconstruct( const rofi::smtr::DiscreteConfiguration& dCfg,
+    const z3::model& model )
+{
+    using namespace rofi::smtr;
+
+    auto angle = [&]( const z3::expr& quarterTurns ) -> float {
+        unsigned k = model.eval( quarterTurns, true ).get_numeral_uint();
+        return k == 3 ? -90 : 90.0 * k;
+    };
+
+    Configuration cfg;
+    for ( int i = 0; i != std::ssize( dCfg.modules ); i++ ) {
+        const auto& module = dCfg.modules[ i ];
+        cfg.addModule( angle( module.alpha ), angle( module.beta ), angle( module.gamma ), i );
+    }
+
+    for ( auto [ m, ms, n, ns ] : allShoePairs( dCfg.modules.size() ) ) {
+        for ( auto [ mc, nc, o ] : allShoeConnections() ) {
+            const z3::expr& conn = dCfg.graph.connection( m, ms, mc, n, ns, nc, o );
+            if ( !model.eval( conn, true ).is_true() )
+                continue;
+            cfg.addEdge( Edge{ m, ms, mc, o, nc, ns, n } );
+        }
+    }
+
+    return cfg;
+}
+
 z3::check_result yicesSolve( z3::solver& s ) {
     std::ofstream outputFile( "/tmp/yicesFormula.smt2" );
     outputFile << s.to_smt2() << "\n(get-model)\n";
@@ -221,13 +312,13 @@ int runReconfig( Configuration& init, Configuration& target, int length,
     rofi::smtr::Parameters params )
 {
     using namespace IO;
-    for ( int i = 2; i != length; i++ ) {
+    for ( int i = 2; length == -1 || i <= length; i++ ) {
         std::cerr << "Trying length " << i << "\n";
         StopWatch formulaTime;
         formulaTime.start();
         rofi::smtr::Context ctx( params );
         z3::solver s( ctx.ctx, "QF_NRA" );
-        auto [ phi, cfgs ] = buildFormula( ctx, init, target, length );
+        auto [ phi, cfgs ] = buildFormula( ctx, init, target, i );
         s.add( phi );
         formulaTime.stop();
 
@@ -255,11 +346,285 @@ int runReconfig( Configuration& init, Configuration& target, int length,
         for ( auto cfg : cfgs ) {
             std::cout << toString( reconstruct( cfg, ys ) ) << "\n";
         }
-        break;
+        return 0;
     }
+    std::cerr << "No plan up to length " << length << " found\n";
+    return 1;
+}
+
+int runDiscreteSmt( Configuration& init, Configuration& target, int length,
+    rofi::smtr::Parameters params )
+{
+    StopWatch formulaTime;
+    formulaTime.start();
+    rofi::smtr::Context ctx( params );
+    z3::solver s( ctx.ctx, "QF_BV" );
+    auto [ phi, cfgs ] = rofi::smtr::discreteReconfig( ctx, length, init, target );
+    s.add( phi );
+    formulaTime.stop();
+
+    std::cout << s.to_smt2() << "\n(get-model)\n";
+    std::cerr << "Formula build-time: " << formulaTime.ms() << " ms\n";
     return 0;
 }
 
+int runDiscreteReconfig( Configuration& init, Configuration& target, int length,
+    rofi::smtr::Parameters params )
+{
+    using namespace IO;
+    for ( int i = 2; i <= length; i++ ) {
+        std::cerr << "Trying length " << i << "\n";
+        StopWatch formulaTime;
+        formulaTime.start();
+        rofi::smtr::Context ctx( params );
+        z3::solver s( ctx.ctx, "QF_BV" );
+        auto [ phi, cfgs ] = rofi::smtr::discreteReconfig( ctx, i, init, target );
+        s.add( phi );
+        formulaTime.stop();
+
+        StopWatch solverTime;
+        solverTime.start();
+        std::cerr << "    Formula build-time: " << formulaTime.ms() << " ms\n";
+        auto res = s.check();
+        solverTime.stop();
+        std::cerr << "    Result: " << res << " in " << solverTime.ms() << " ms\n";
+
+        if ( res != z3::sat )
+            continue;
+
+        z3::model model = s.get_model();
+        for ( const auto& cfg : cfgs ) {
+            std::cout << toString( reconstruct( cfg, model ) ) << "\n";
+        }
+        return 0;
+    }
+    std::cerr << "No plan up to length " << length << " found\n";
+    return 1;
+}
+
+int runIncrementalReconfig( Configuration& init, Configuration& target, int length,
+    rofi::smtr::Parameters params )
+{
+    using namespace IO;
+    rofi::smtr::Context ctx( params );
+    z3::solver s( ctx.ctx );
+    rofi::smtr::IncrementalReconfig reconfig( ctx, s, init, target );
+    while ( true ) {
+        std::cerr << "Trying length " << reconfig.length() << "\n";
+        StopWatch solverTime;
+        solverTime.start();
+        auto res = reconfig.check();
+        solverTime.stop();
+        std::cerr << "    Result: " << res << " in " << solverTime.ms() << " ms\n";
+
+        if ( res == z3::sat ) {
+            z3::model model = s.get_model();
+            for ( const auto& cfg : reconfig.configurations() )
+                std::cout << toString( reconstruct( cfg, model ) ) << "\n";
+            return 0;
+        }
+        if ( length != -1 && reconfig.length() >= length ) {
+            std::cerr << "No plan up to length " << length << " found\n";
+            return 1;
+        }
+
+        StopWatch formulaTime;
+        formulaTime.start();
+        reconfig.extend();
+        formulaTime.stop();
+        std::cerr << "    Formula extension-time: " << formulaTime.ms() << " ms\n";
+    }
+}
+
+/* PORTFOLIO
+ *
+ * Every combination of a solver and a formula length is one run. A pool of
+ * worker threads takes the runs in the order of increasing length, so the
+ * short (and likely unsatisfiable) formulas are solved first. A result
+ * cancels the runs it makes useless: unsat cancels the other solvers of the
+ * same length, sat cancels all runs of the same or greater length. The plan
+ * is printed once every shorter length is proven unsat or given up by all
+ * solvers.
+ * */
+class Portfolio {
+public:
+    static const std::vector< std::string >& solvers() {
+        static const std::vector< std::string > names = { "z3", "z3-nlsat", "yices" };
+        return names;
+    }
+
+    Portfolio( const Configuration& init, const Configuration& target,
+        rofi::smtr::Parameters params ):
+        _init( init ), _target( target ), _params( params )
+    {}
+
+    int run( const std::vector< std::string >& solvers, int length, unsigned jobs ) {
+        for ( int i = 2; i <= length; i++ ) {
+            for ( const auto& solver : solvers )
+                _runs.push_back( { solver, i, {}, false } );
+        }
+
+        std::vector< std::thread > workers;
+        for ( unsigned i = 0; i != std::max( jobs, 1u ); i++ )
+            workers.emplace_back( [this] { _worker(); } );
+        for ( auto& w : workers )
+            w.join();
+
+        if ( _best == INT_MAX ) {
+            std::cerr << "No plan up to length " << length << " found\n";
+            return 1;
+        }
+        for ( int i = 2; i < _best; i++ ) {
+            if ( _unsat.count( i ) == 0 )
+                std::cerr << "Warning: length " << i << " was not decided\n";
+        }
+        std::cerr << "Plan of length " << _best << " found by " << _bestSolver << "\n";
+        for ( const auto& cfg : _plan )
+            std::cout << cfg << "\n";
+        return 0;
+    }
+
+private:
+    struct Run {
+        std::string solver;
+        int length;
+        std::function< void() > cancel; // Set while the run is solving
+        bool cancelled = false;
+    };
+
+    bool _useless( const Run& run ) const {
+        return run.cancelled || run.length >= _best || _unsat.count( run.length );
+    }
+
+    void _worker() {
+        while ( true ) {
+            size_t idx;
+            {
+                std::lock_guard< std::mutex > lock( _mutex );
+                while ( _next != _runs.size() && _useless( _runs[ _next ] ) )
+                    _next++;
+                if ( _next == _runs.size() )
+                    return;
+                idx = _next++;
+            }
+            _solve( idx );
+        }
+    }
+
+    // Registers the cancellation of a run; false if it is already useless
+    bool _start( size_t idx, std::function< void() > cancel ) {
+        std::lock_guard< std::mutex > lock( _mutex );
+        if ( _useless( _runs[ idx ] ) )
+            return false;
+        _runs[ idx ].cancel = std::move( cancel );
+        return true;
+    }
+
+    void _stop( size_t idx ) {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _runs[ idx ].cancel = nullptr;
+    }
+
+    void _log( size_t idx, const std::string& msg ) {
+        std::lock_guard< std::mutex > lock( _mutex );
+        std::cerr << "[" << _runs[ idx ].solver << ", length " << _runs[ idx ].length
+                  << "] " << msg << "\n";
+    }
+
+    void _solve( size_t idx ) {
+        using namespace IO;
+        const std::string solver = _runs[ idx ].solver;
+        const int length = _runs[ idx ].length;
+
+        StopWatch formulaTime;
+        formulaTime.start();
+        rofi::smtr::Context ctx( _params );
+        z3::solver s = solver == "z3-nlsat"
+            ? z3::tactic( ctx.ctx, "qfnra-nlsat" ).mk_solver()
+            : z3::solver( ctx.ctx, "QF_NRA" );
+        auto [ phi, cfgs ] = buildFormula( ctx, _init, _target, length );
+        s.add( phi );
+        formulaTime.stop();
+        _log( idx, fmt::format( "Formula build-time: {} ms", formulaTime.ms() ) );
+
+        StopWatch solverTime;
+        solverTime.start();
+        z3::check_result res = z3::unknown;
+        std::vector< std::string > plan;
+        if ( solver == "yices" ) {
+            YicesProcSolver ys( s, fmt::format( "/tmp/yices_{}_{}_", getpid(), idx ) );
+            if ( !_start( idx, [&]{ ys.cancel(); } ) )
+                return;
+            res = ys.check();
+            _stop( idx );
+            // Every run has its own files, do not leave them behind
+            ys.removeFiles();
+            if ( res == z3::sat ) {
+                for ( const auto& cfg : cfgs )
+                    plan.push_back( toString( reconstruct( cfg, ys ) ) );
+            }
+        }
+        else {
+            if ( !_start( idx, [&]{ ctx.ctx.interrupt(); } ) )
+                return;
+            try {
+                res = s.check();
+            } catch ( const z3::exception& ) {
+                // Interrupted
+                res = z3::unknown;
+            }
+            _stop( idx );
+            if ( res == z3::sat ) {
+                z3::model model = s.get_model();
+                for ( const auto& cfg : cfgs )
+                    plan.push_back( toString( reconstruct( cfg, model ) ) );
+            }
+        }
+        solverTime.stop();
+        _finish( idx, res, std::move( plan ), solverTime.ms() );
+    }
+
+    void _finish( size_t idx, z3::check_result res, std::vector< std::string > plan,
+        int ms )
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        Run& run = _runs[ idx ];
+        if ( run.cancelled )
+            res = z3::unknown;
+        std::cerr << "[" << run.solver << ", length " << run.length << "] Result: "
+                  << res << ( run.cancelled ? " (cancelled)" : "" )
+                  << " in " << ms << " ms\n";
+
+        if ( res == z3::unsat )
+            _unsat.insert( run.length );
+        if ( res == z3::sat && run.length < _best ) {
+            _best = run.length;
+            _bestSolver = run.solver;
+            _plan = std::move( plan );
+        }
+        if ( res == z3::unknown )
+            return;
+        for ( auto& other : _runs ) {
+            if ( &other == &run || other.cancelled || !_useless( other ) )
+                continue;
+            other.cancelled = true;
+            if ( other.cancel )
+                other.cancel();
+        }
+    }
+
+    Configuration _init, _target;
+    rofi::smtr::Parameters _params;
+
+    std::mutex _mutex;
+    std::vector< Run > _runs;
+    size_t _next = 0;
+    std::set< int > _unsat;
+    int _best = INT_MAX;
+    std::string _bestSolver;
+    std::vector< std::string > _plan;
+};
+
 template < typename Args >
 std::string getCommand( Args& args ) {
     if ( !args.count("positional") )
@@ -282,12 +647,25 @@ int main( int argc, char **argv ) {
             cxxopts::value< std::string >( final ) )
         ( "i, initial", "file with initial configuration",
             cxxopts::value< std::string >( initial ) )
-        ( "l, length", "either upper bound for the smt command or the formula length",
+        ( "l, length", "smt: the formula length; reconfig: the maximal length "
+                       "(number of configurations) of the plan, all lengths up to it "
+                       "are tried in increasing order",
             cxxopts::value< int >( length ), "N" )
         ( "s, simplify", "simplify the formula")
         ( "shoeLimitConstrain", "" )
         ( "connectorLimitConstrain", "" )
-        ( "90degReconfig", "");
+        ( "90degReconfig", "")
+        ( "bitvector", "with 90degReconfig, encode joints and shoes as bit-vectors (QF_BV)" )
+        ( "symmetryBreaking", "prune impossible connections and fix the sign "
+                              "of shoe orientations" )
+        ( "incremental", "reconfig: extend one z3 solver length by length "
+                         "instead of building a new formula for each length" )
+        ( "portfolio", "reconfig: race solvers on all lengths up to --length in parallel" )
+        ( "solvers", "solvers of the portfolio (z3, z3-nlsat, yices)",
+            cxxopts::value< std::vector< std::string > >()->default_value( "z3,z3-nlsat" ) )
+        ( "j, jobs", "number of portfolio runs solved at once",
+            cxxopts::value< unsigned >()->default_value(
+                std::to_string( std::max( 1u, std::thread::hardware_concurrency() ) ) ) );
     options.parse_positional( { "positional" } );
 
     auto args = options.parse( argc, argv );
@@ -311,19 +689,63 @@ int main( int argc, char **argv ) {
     params.simplify = args.count( "simplify" );
     params.connectorLimitConstrain = args.count( "connectorLimitConstrain" );
     params.shoeLimitConstain = args.count( "shoeLimitConstrain" );
+    params.symmetryBreaking = args.count( "symmetryBreaking" );
     if ( args.count( "90degReconfig" ) ) {
         params.stepSize = rofi::smtr::Parameters::StepSize::Step90;
     }
 
+    bool bitvector = args.count( "bitvector" );
+    if ( bitvector && params.stepSize != rofi::smtr::Parameters::StepSize::Step90 ) {
+        std::cerr << "--bitvector requires --90degReconfig\n";
+        return 1;
+    }
+    bool portfolio = args.count( "portfolio" );
+    bool incremental = args.count( "incremental" );
+    if ( bitvector && ( portfolio || incremental ) ) {
+        std::cerr << "--bitvector cannot be combined with --portfolio or --incremental\n";
+        return 1;
+    }
+    if ( portfolio && incremental ) {
+        std::cerr << "--portfolio cannot be combined with --incremental\n";
+        return 1;
+    }
+
     auto command = getCommand( args );
     if ( command == "smt" ) {
         if ( length == -1 ) {
             std::cerr << "--lenght or -l is required but was not specified\n";
             return 1;
         }
+        if ( bitvector )
+            return runDiscreteSmt( init, target, length, params );
         return runSmt( init, target, length, params );
     }
+    if ( command == "reconfig" && bitvector ) {
+        if ( length == -1 ) {
+            std::cerr << "--length is required by --bitvector\n";
+            return 1;
+        }
+        return runDiscreteReconfig( init, target, length, params );
+    }
     if ( command == "reconfig" ) {
+        if ( portfolio ) {
+            if ( length == -1 ) {
+                std::cerr << "--length is required by --portfolio\n";
+                return 1;
+            }
+            auto solvers = args[ "solvers" ].as< std::vector< std::string > >();
+            for ( const auto& solver : solvers ) {
+                const auto& known = Portfolio::solvers();
+                if ( std::find( known.begin(), known.end(), solver ) == known.end() ) {
+                    std::cerr << "Unknown solver '" << solver << "'\n";
+                    return 1;
+                }
+            }
+            Portfolio portfolio( init, target, params );
+            return portfolio.run( solvers, length, args[ "jobs" ].as< unsigned >() );
+        }
+        if ( incremental )
+            return runIncrementalReconfig( init, target, length, params );
         return runReconfig( init, target, length, params );
     }
 
@@ -0,0 +1,376 @@
+#include "smtDiscrete.hpp"
+#include <fmt/format.h>
+#include <cmath>
+#include <stdexcept>
+
+namespace rofi::smtr {
+
+namespace {
+
+using Matrix = DiscreteTables::Matrix;
+using Vector = DiscreteTables::Vector;
+
+const unsigned rotWidth = 5;
+
+struct Quaternion {
+    double a, b, c, d;
+};
+
+Matrix toMatrix( const Quaternion& q ) {
+    auto r = []( double v ) { return static_cast< int >( std::lround( v ) ); };
+    const auto [ a, b, c, d ] = q;
+    return {{
+        { r( a*a + b*b - c*c - d*d ), r( 2 * ( b*c - a*d ) ), r( 2 * ( b*d + a*c ) ) },
+        { r( 2 * ( b*c + a*d ) ), r( a*a - b*b + c*c - d*d ), r( 2 * ( c*d - a*b ) ) },
+        { r( 2 * ( b*d - a*c ) ), r( 2 * ( c*d + a*b ) ), r( a*a - b*b - c*c + d*d ) }
+    }};
+}
+
+Matrix operator*( const Matrix& x, const Matrix& y ) {
+    Matrix res{};
+    for ( int i = 0; i != 3; i++ )
+        for ( int j = 0; j != 3; j++ )
+            for ( int k = 0; k != 3; k++ )
+                res[ i ][ j ] += x[ i ][ k ] * y[ k ][ j ];
+    return res;
+}
+
+Vector operator*( const Matrix& x, const Vector& v ) {
+    Vector res{};
+    for ( int i = 0; i != 3; i++ )
+        for ( int k = 0; k != 3; k++ )
+            res[ i ] += x[ i ][ k ] * v[ k ];
+    return res;
+}
+
+// Rotation of shoe B relative to shoe A; phiShoeConsistent with shoe A in
+// the identity
+Quaternion bodyRotation( int alpha, int beta, int gamma ) {
+    auto sh = []( int k ) { return std::sin( k * M_PI / 4 ); };
+    auto ch = []( int k ) { return std::cos( k * M_PI / 4 ); };
+    double sa = sh( alpha ), ca = ch( alpha ), sb = sh( beta ), cb = ch( beta ),
+           sg = sh( gamma ), cg = ch( gamma );
+    return {
+          ca * sb * sg + sa * cb * sg,
+        - ca * cb * sg + sa * sb * sg,
+          ca * cb * cg + sa * sb * cg,
+        - ca * sb * cg + sa * cb * cg
+    };
+}
+
+// Rotation of the other shoe of a connection; solved from
+// otherShoeOrientation with shoe A in the identity
+Quaternion connectionRotation( ConnectorId mc, ConnectorId nc, Orientation o ) {
+    Context ctx;
+    auto num = [&]( int v ) { return ctx.ctx.real_val( v ); };
+    Shoe a{ num( 0 ), num( 0 ), num( 0 ), num( 1 ), num( 0 ), num( 0 ), num( 0 ) };
+    auto var = [&]( const char* name ) { return ctx.ctx.real_const( name ); };
+    Shoe b{ var( "x" ), var( "y" ), var( "z" ), var( "qa" ), var( "qb" ), var( "qc" ), var( "qd" ) };
+
+    z3::solver s( ctx.ctx );
+    s.add( ctx.constraints() && ctx.sqrt2 > 0 && ctx.sqrt3 > 0 );
+    s.add( otherShoeOrientation( ctx, a, b, mc, nc, o ) );
+    if ( s.check() != z3::sat )
+        throw std::logic_error( "Connection has no orientation" );
+    z3::model m = s.get_model();
+    auto value = [&]( const z3::expr& e ) {
+        return std::stod( m.eval( e, true ).get_decimal_string( 8 ) );
+    };
+    return { value( b.qa ), value( b.qb ), value( b.qc ), value( b.qd ) };
+}
+
+DiscreteTables buildTables() {
+    DiscreteTables t;
+    std::vector< Matrix > generators;
+    for ( int a = 0; a != 4; a++ )
+        for ( int b = 0; b != 4; b++ )
+            for ( int g = 0; g != 4; g++ )
+                generators.push_back( toMatrix( bodyRotation( a, b, g ) ) );
+    for ( ConnectorId mc : { XPlus, XMinus, ZMinus } )
+        for ( ConnectorId nc : { XPlus, XMinus, ZMinus } )
+            for ( Orientation o : { North, East, South, West } )
+                generators.push_back( toMatrix( connectionRotation( mc, nc, o ) ) );
+
+    t.rotations.push_back( {{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }} );
+    for ( size_t i = 0; i != t.rotations.size(); i++ ) {
+        for ( const auto& g : generators ) {
+            Matrix m = t.rotations[ i ] * g;
+            if ( t.index( m ) == -1 )
+                t.rotations.push_back( m );
+        }
+    }
+    if ( t.rotations.size() != 24 )
+        throw std::logic_error( "Step90 orientations do not form the cube group" );
+
+    int gen = 0;
+    for ( int a = 0; a != 4; a++ )
+        for ( int b = 0; b != 4; b++ )
+            for ( int g = 0; g != 4; g++ )
+                t.body[ a ][ b ][ g ] = t.index( generators[ gen++ ] );
+    for ( ConnectorId mc : { XPlus, XMinus, ZMinus } )
+        for ( ConnectorId nc : { XPlus, XMinus, ZMinus } )
+            for ( Orientation o : { North, East, South, West } )
+                t.connection[ mc ][ nc ][ o ] = t.index( generators[ gen++ ] );
+
+    for ( const auto& x : t.rotations ) {
+        t.compose.push_back( {} );
+        for ( const auto& y : t.rotations )
+            t.compose.back().push_back( t.index( x * y ) );
+    }
+    return t;
+}
+
+template < typename... Args >
+z3::expr bvVar( z3::context& c, unsigned width, const std::string& format, Args... args ) {
+    return c.bv_const( fmt::format( format, args... ).c_str(), width );
+}
+
+// Value of `values[ index ]` as an ite chain; indices past the end map to
+// the last value
+z3::expr lookup( const z3::expr& index, const std::vector< int >& values,
+    unsigned width )
+{
+    z3::context& c = index.ctx();
+    unsigned indexWidth = index.get_sort().bv_size();
+    z3::expr res = c.bv_val( values.back(), width );
+    for ( int i = static_cast< int >( values.size() ) - 2; i >= 0; i-- ) {
+        res = z3::ite( index == c.bv_val( i, indexWidth ),
+            c.bv_val( values[ i ], width ), res );
+    }
+    return res;
+}
+
+// Orientation after rotating shoe orientation `rot` by rotation `by`
+z3::expr compose( const z3::expr& rot, const z3::expr& by ) {
+    const auto& t = discreteTables();
+    std::vector< int > values( 32 * t.rotations.size(), 0 );
+    for ( size_t x = 0; x != t.rotations.size(); x++ )
+        for ( size_t y = 0; y != t.rotations.size(); y++ )
+            values[ 32 * x + y ] = t.compose[ x ][ y ];
+    return lookup( z3::concat( rot, by ), values, rotWidth );
+}
+
+z3::expr compose( const z3::expr& rot, int by ) {
+    const auto& t = discreteTables();
+    std::vector< int > values;
+    for ( size_t x = 0; x != t.rotations.size(); x++ )
+        values.push_back( t.compose[ x ][ by ] );
+    return lookup( rot, values, rotWidth );
+}
+
+// Position of `shoe` shifted by `offset` rotated into the orientation of
+// the shoe; `offset` gives the vector for each value of `selector`
+z3::expr shifted( const DiscreteShoe& shoe, const DiscreteShoe& other,
+    const z3::expr& selector, const std::vector< Vector >& offsets,
+    unsigned posWidth )
+{
+    const auto& t = discreteTables();
+    unsigned selWidth = selector.get_sort().bv_size();
+    std::array< std::vector< int >, 3 > values;
+    for ( size_t r = 0; r != t.rotations.size(); r++ ) {
+        for ( size_t s = 0; s != ( 1u << selWidth ); s++ ) {
+            Vector v = t.rotations[ r ] * offsets[ std::min( s, offsets.size() - 1 ) ];
+            for ( int i = 0; i != 3; i++ )
+                values[ i ].push_back( v[ i ] );
+        }
+    }
+    z3::expr index = z3::concat( shoe.rot, selector );
+    return other.x == shoe.x + lookup( index, values[ 0 ], posWidth )
+        && other.y == shoe.y + lookup( index, values[ 1 ], posWidth )
+        && other.z == shoe.z + lookup( index, values[ 2 ], posWidth );
+}
+
+z3::expr samePosition( const DiscreteShoe& a, const DiscreteShoe& b ) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+} // namespace
+
+int DiscreteTables::index( const Matrix& m ) const {
+    for ( size_t i = 0; i != rotations.size(); i++ ) {
+        if ( rotations[ i ] == m )
+            return i;
+    }
+    return -1;
+}
+
+const DiscreteTables& discreteTables() {
+    static const DiscreteTables tables = buildTables();
+    return tables;
+}
+
+DiscreteConfiguration buildDiscreteConfiguration( Context& ctx,
+    const Configuration& cfg, int cfgId )
+{
+    DiscreteConfiguration dCfg{ buildConfiguration( ctx, cfg, cfgId ), {}, 2 };
+    std::vector moduleIds = cfg.getIDs();
+    std::sort( moduleIds.begin(), moduleIds.end() );
+
+    // Shoes lie within 2n of the root; positions have to tell apart points
+    // up to 4n apart
+    while ( ( 1u << ( dCfg.posWidth - 1 ) ) <= 2 * moduleIds.size() )
+        dCfg.posWidth++;
+
+    auto shoe = [&]( int moduleId, const std::string& name ) {
+        const std::string prefix = "cfg{}_m{}_s" + name + "_d";
+        return DiscreteShoe{
+            bvVar( ctx.ctx, dCfg.posWidth, prefix + "x", cfgId, moduleId ),
+            bvVar( ctx.ctx, dCfg.posWidth, prefix + "y", cfgId, moduleId ),
+            bvVar( ctx.ctx, dCfg.posWidth, prefix + "z", cfgId, moduleId ),
+            bvVar( ctx.ctx, rotWidth, prefix + "rot", cfgId, moduleId )
+        };
+    };
+    for ( const auto& moduleId : moduleIds ) {
+        const std::string modulePrefix = "cfg{}_m{}_";
+        dCfg.modules.push_back( {
+            bvVar( ctx.ctx, 2, modulePrefix + "alpha", cfgId, moduleId ),
+            bvVar( ctx.ctx, 2, modulePrefix + "beta", cfgId, moduleId ),
+            bvVar( ctx.ctx, 2, modulePrefix + "gamma", cfgId, moduleId ),
+            { shoe( moduleId, "A" ), shoe( moduleId, "B" ) }
+        } );
+    }
+    return dCfg;
+}
+
+z3::expr DiscreteConfiguration::constraints( Context& ctx ) const {
+    z3::expr res = graph.connectionConstraints( ctx );
+    unsigned count = discreteTables().rotations.size();
+    for ( const auto& module : modules ) {
+        for ( const auto& shoe : module.shoes )
+            res = res && z3::ult( shoe.rot, ctx.ctx.bv_val( count, rotWidth ) );
+    }
+    return res;
+}
+
+z3::expr phiValid( Context& ctx, const DiscreteConfiguration& cfg ) {
+    return phiShoeConsistent( ctx, cfg ) && phiConnectorConsistent( ctx, cfg )
+        && phiNoIntersect( ctx, cfg ) && phiIsConnected( ctx, cfg.graph );
+}
+
+z3::expr phiShoeConsistent( Context& ctx, const DiscreteConfiguration& cfg ) {
+    const auto& t = discreteTables();
+    std::vector< int > body;
+    for ( int a = 0; a != 4; a++ )
+        for ( int b = 0; b != 4; b++ )
+            for ( int g = 0; g != 4; g++ )
+                body.push_back( t.body[ a ][ b ][ g ] );
+    // Shoe B sits in the direction (0, -sin alpha, cos alpha) from shoe A
+    const std::vector< Vector > offsets = {
+        { 0, 0, 1 }, { 0, -1, 0 }, { 0, 0, -1 }, { 0, 1, 0 } };
+
+    z3::expr phi = ctx.ctx.bool_val( true );
+    for ( const auto& module : cfg.modules ) {
+        const auto& a = module.shoes[ A ];
+        const auto& b = module.shoes[ B ];
+        z3::expr bodyRot = lookup(
+            z3::concat( module.alpha, z3::concat( module.beta, module.gamma ) ),
+            body, rotWidth );
+        phi = phi && b.rot == compose( a.rot, bodyRot )
+            && shifted( a, b, module.alpha, offsets, cfg.posWidth );
+    }
+    return phi;
+}
+
+z3::expr phiConnectorConsistent( Context& ctx, const DiscreteConfiguration& cfg ) {
+    const auto& t = discreteTables();
+    const std::array< Vector, 3 > offsets = {{ { 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, -1 } }};
+    z3::expr zero = ctx.ctx.bv_val( 0, 1 );
+
+    z3::expr phi = ctx.ctx.bool_val( true );
+    for ( auto [ m, ms, n, ns ] : allShoePairs( cfg.modules.size() ) ) {
+        const auto& shoeA = cfg.modules[ m ].shoes[ ms ];
+        const auto& shoeB = cfg.modules[ n ].shoes[ ns ];
+        for ( auto [ mc, nc, o ] : allShoeConnections() ) {
+            const auto& conn = cfg.graph.connection( m, ms, mc, n, ns, nc, o );
+            if ( conn.is_false() )
+                continue;
+            phi = phi && z3::implies( conn,
+                shoeB.rot == compose( shoeA.rot, t.connection[ mc ][ nc ][ o ] ) &&
+                shifted( shoeA, shoeB, zero, { offsets[ mc ] }, cfg.posWidth ) );
+        }
+    }
+    return phi;
+}
+
+z3::expr phiNoIntersect( Context& ctx, const DiscreteConfiguration& cfg ) {
+    z3::expr phi = ctx.ctx.bool_val( true );
+    for ( auto [ m, ms, n, ns ] : allShoePairs( cfg.modules.size() ) ) {
+        phi = phi && !samePosition( cfg.modules[ m ].shoes[ ms ],
+            cfg.modules[ n ].shoes[ ns ] );
+    }
+    return phi;
+}
+
+z3::expr phiRootModule( Context&, const DiscreteConfiguration& cfg ) {
+    const auto& shoe = cfg.modules[ 0 ].shoes[ A ];
+    return shoe.x == 0 && shoe.y == 0 && shoe.z == 0 && shoe.rot == 0;
+}
+
+z3::expr phiEqual( Context& ctx, const DiscreteConfiguration& dCfg,
+    const Configuration& cfg )
+{
+    auto quarterTurns = [&]( const z3::expr& var, double angle ) {
+        double turns = angle / 90;
+        long k = std::lround( turns );
+        if ( std::abs( turns - k ) > 1e-6 )
+            return ctx.ctx.bool_val( false );
+        return var == ctx.ctx.bv_val( static_cast< unsigned >( ( k % 4 + 4 ) % 4 ), 2 );
+    };
+
+    z3::expr phi = ctx.ctx.bool_val( true );
+    std::vector moduleIds = cfg.getIDs();
+    std::sort( moduleIds.begin(), moduleIds.end() );
+    for ( size_t i = 0; i != moduleIds.size(); i++ ) {
+        const auto& module = cfg.getModule( moduleIds[ i ] );
+        const auto& dModule = dCfg.modules[ i ];
+        phi = phi &&
+            quarterTurns( dModule.alpha, module.getJoint( Alpha ) ) &&
+            quarterTurns( dModule.beta, module.getJoint( Beta ) ) &&
+            quarterTurns( dModule.gamma, module.getJoint( Gamma ) );
+    }
+    return phi && phiEqualConnections( ctx, dCfg.graph, cfg );
+}
+
+z3::expr phiEqualJoints( Context& ctx, const DiscreteConfiguration& a,
+    const DiscreteConfiguration& b )
+{
+    assert( a.modules.size() == b.modules.size() );
+    z3::expr phi = ctx.ctx.bool_val( true );
+    for ( size_t i = 0; i != a.modules.size(); i++ ) {
+        phi = phi && a.modules[ i ].alpha == b.modules[ i ].alpha
+            && a.modules[ i ].beta == b.modules[ i ].beta
+            && a.modules[ i ].gamma == b.modules[ i ].gamma;
+    }
+    return phi;
+}
+
+z3::expr phiStep( Context& ctx, const DiscreteConfiguration& a,
+    const DiscreteConfiguration& b )
+{
+    // Same steps as the real encoding: connect, disconnect and an
+    // (unconstrained) rotation
+    z3::expr joints = phiEqualJoints( ctx, a, b );
+    return ( joints && phiSubsetConnections( ctx, a.graph, b.graph ) )
+        || ( joints && phiSubsetConnections( ctx, b.graph, a.graph ) )
+        || phiEqualConnections( ctx, a.graph, b.graph );
+}
+
+std::pair< z3::expr, std::vector< DiscreteConfiguration > > discreteReconfig(
+    Context& ctx, int len, const Configuration& init, const Configuration& target )
+{
+    assert( len >= 2 );
+    std::vector< DiscreteConfiguration > cfgs;
+    for ( int i = 0; i != len; i++ )
+        cfgs.push_back( buildDiscreteConfiguration( ctx, init, i ) );
+    z3::expr phi = phiEqual( ctx, cfgs.front(), init ) &&
+        phiEqual( ctx, cfgs.back(), target );
+    for ( const auto& cfg : cfgs ) {
+        phi = phi && phiValid( ctx, cfg ) && phiRootModule( ctx, cfg )
+            && cfg.constraints( ctx );
+    }
+    for ( int i = 0; i != len - 1; i++ )
+        phi = phi && phiStep( ctx, cfgs[ i ], cfgs[ i + 1 ] );
+    return { phi, cfgs };
+}
+
+} // namespace rofi::smtr
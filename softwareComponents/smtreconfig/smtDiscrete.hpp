@@ -0,0 +1,80 @@
+#pragma once
+#include "smtReconfig.hpp"
+#include <array>
+#include <vector>
+
+namespace rofi::smtr {
+
+/**
+ * Encoding of Step90 reconfiguration without real arithmetic.
+ *
+ * With joints restricted to multiples of 90 degrees, shoes sit on the
+ * integer lattice and take one of the 24 orientations of a cube. A joint is
+ * a 2-bit vector (the number of quarter turns), a shoe orientation an index
+ * into the orientation group and a shoe position three bit-vector
+ * coordinates. Body and connection transforms become lookups into tables
+ * precomputed from the real encoding, so the formulas are pure QF_BV.
+ *
+ * Connection variables, connectivity and parity pruning are shared with
+ * the real encoding through `graph`, whose real variables are left unused.
+ */
+
+struct DiscreteShoe {
+    z3::expr x, y, z; // Lattice position
+    z3::expr rot; // Index into DiscreteTables::rotations
+};
+
+struct DiscreteModule {
+    z3::expr alpha, beta, gamma; // Number of quarter turns
+    std::array< DiscreteShoe, 2 > shoes;
+};
+
+struct DiscreteConfiguration {
+    SmtConfiguration graph; // Connections
+    std::vector< DiscreteModule > modules;
+    unsigned posWidth; // Bit-width of positions
+
+    z3::expr constraints( Context& ctx ) const;
+};
+
+/**
+ * Orientations of a shoe and the transforms between them, precomputed from
+ * `phiShoeConsistent` and `otherShoeOrientation`. Rotations are integer
+ * matrices; the identity has index 0.
+ */
+struct DiscreteTables {
+    using Matrix = std::array< std::array< int, 3 >, 3 >;
+    using Vector = std::array< int, 3 >;
+
+    std::vector< Matrix > rotations;
+    // Orientation of shoe B relative to shoe A for [alpha][beta][gamma]
+    std::array< std::array< std::array< int, 4 >, 4 >, 4 > body;
+    // Orientation of the other shoe of a connection for [mc][nc][o]
+    std::array< std::array< std::array< int, 4 >, 3 >, 3 > connection;
+    // compose[ a ][ b ] is the orientation of rotating by a then by b
+    std::vector< std::vector< int > > compose;
+
+    int index( const Matrix& m ) const;
+};
+
+const DiscreteTables& discreteTables();
+
+DiscreteConfiguration buildDiscreteConfiguration( Context& ctx,
+    const Configuration& cfg, int cfgId );
+
+z3::expr phiValid( Context& ctx, const DiscreteConfiguration& cfg );
+z3::expr phiShoeConsistent( Context& ctx, const DiscreteConfiguration& cfg );
+z3::expr phiConnectorConsistent( Context& ctx, const DiscreteConfiguration& cfg );
+z3::expr phiNoIntersect( Context& ctx, const DiscreteConfiguration& cfg );
+z3::expr phiRootModule( Context& ctx, const DiscreteConfiguration& cfg );
+z3::expr phiEqual( Context& ctx, const DiscreteConfiguration& dCfg,
+        const Configuration& cfg );
+z3::expr phiEqualJoints( Context& ctx, const DiscreteConfiguration& a,
+        const DiscreteConfiguration& b );
+z3::expr phiStep( Context& ctx, const DiscreteConfiguration& a,
+        const DiscreteConfiguration& b );
+
+std::pair< z3::expr, std::vector< DiscreteConfiguration > > discreteReconfig(
+    Context& ctx, int len, const Configuration& init, const Configuration& target );
+
+} // namespace rofi::smtr
@@ -31,7 +31,8 @@ void collectVar( const SmtConfiguration& c, std::vector< z3::expr >& out ) {
             for ( const auto& n : ms ) {
                 for ( const auto& ns : n ) {
                     for ( const auto& var : ns ) {
-                        out.push_back( var );
+                        if ( !var.is_false() )
+                            out.push_back( var );
                     }
                 }
             }
@@ -129,6 +130,48 @@ auto allConnectors( int count ) ->
     return ret;
 }
 
+/**
+ * Parity of the lattice point of every shoe, indexed by 2 * module index +
+ * shoe; -1 for shoes not connected to the root shoe (A of the first module).
+ *
+ * With 90-degree joints all shoes lie on the integer lattice and every body
+ * or connection edge is a unit step, so the shoe graph is bipartite. The
+ * root shoe is fixed to the origin in every configuration and all
+ * configurations are connected, hence the parities never change during a
+ * reconfiguration.
+ */
+std::vector< int > shoeParities( const Configuration& cfg,
+    const std::vector< ID >& moduleIds )
+{
+    std::vector< int > parity( 2 * moduleIds.size(), -1 );
+    if ( moduleIds.empty() )
+        return parity;
+
+    auto shoeIdx = [&]( ID id, ShoeId s ) -> int {
+        auto it = std::lower_bound( moduleIds.begin(), moduleIds.end(), id );
+        return 2 * std::distance( moduleIds.begin(), it ) + s;
+    };
+
+    std::vector< int > queue = { 0 };
+    parity[ 0 ] = 0;
+    for ( size_t i = 0; i != queue.size(); i++ ) {
+        int shoe = queue[ i ];
+        ID id = moduleIds[ shoe / 2 ];
+        std::vector< int > neighbours = { shoe ^ 1 };
+        for ( const Edge& e : cfg.getEdges( id ) ) {
+            if ( e.side1() == shoe % 2 )
+                neighbours.push_back( shoeIdx( e.id2(), e.side2() ) );
+        }
+        for ( int other : neighbours ) {
+            if ( parity[ other ] != -1 )
+                continue;
+            parity[ other ] = 1 - parity[ shoe ];
+            queue.push_back( other );
+        }
+    }
+    return parity;
+}
+
 SmtConfiguration buildConfiguration( Context& ctx,
     const Configuration& cfg, int cfgId )
 {
@@ -152,6 +195,21 @@ SmtConfiguration buildConfiguration( Context& ctx,
         smtCfg.modules.push_back( m );
     };
 
+    // Shoes of the same parity are never adjacent, their connections are
+    // left out of the formula
+    std::vector< int > parity;
+    if ( ctx.cfg.symmetryBreaking
+        && ctx.cfg.stepSize == Parameters::StepSize::Step90 )
+    {
+        parity = shoeParities( cfg, moduleIds );
+    }
+    auto sameParity = [&]( int m, ShoeId ms, int n, ShoeId ns ) {
+        if ( parity.empty() )
+            return false;
+        int p = parity[ 2 * m + ms ];
+        return p != -1 && p == parity[ 2 * n + ns ];
+    };
+
     // Add connections
     for ( auto [ m, ms, n, ns ] : allShoePairs( moduleIds.size() ) ) {
         if ( smtCfg.connections.size() <= m )
@@ -163,7 +221,12 @@ SmtConfiguration buildConfiguration( Context& ctx,
         assert( cell.size() == n - m );
 
         std::vector< z3::expr >& conn = cell[ n - m - 1 ][ ns ];
+        bool impossible = sameParity( m, ms, n, ns );
         for ( auto [ mc, nc, o ] : allShoeConnections() ) {
+            if ( impossible ) {
+                conn.push_back( ctx.ctx.bool_val( false ) );
+                continue;
+            }
             conn.push_back(
                 boolVar( ctx.ctx,
                     "cfg{}_c_{}{}{}_{}{}{}_{}",
@@ -715,12 +778,16 @@ z3::expr phiEqual( Context& ctx, const SmtConfiguration& smtCfg,
             phiEqual( ctx, smtModule.gamma, degToRad( module.getJoint( Gamma ) ) );
     }
 
-    auto moduleIdx = [&]( int id ) -> int {
-        auto it = std::lower_bound( moduleIds.begin(), moduleIds.end(), id );
-        assert( it != moduleIds.end() && *it == id );
-        return std::distance( moduleIds.begin(), it );
-    };
+    return phi && phiEqualConnections( ctx, smtCfg, cfg );
+}
 
+z3::expr phiEqualConnections( Context& ctx, const SmtConfiguration& smtCfg,
+    const Configuration& cfg )
+{
+    z3::expr phi = ctx.ctx.bool_val( true );
+
+    std::vector moduleIds = cfg.getIDs();
+    std::sort( moduleIds.begin(), moduleIds.end() );
     for ( auto [ m, ms, n, ns ] : allShoePairs( moduleIds.size() ) ) {
         for ( auto [ mc, nc, o ] : allShoeConnections() ) {
             Edge e(moduleIds[ m ], ms, mc, o, nc, ns, moduleIds[ n ] );
@@ -737,10 +804,15 @@ z3::expr phiEqual( Context& ctx, const SmtConfiguration& smtCfg,
     return phi;
 }
 
+// Pins shoe A of the given module to the origin with the identity
+// orientation (qa = 1, not -1). This fixes all six degrees of freedom of the
+// world frame and the quaternion sign of the root, so no rigid motion of a
+// model is left as a symmetry. Modules keep their identities, hence picking
+// another module as the root would only relabel the frame, not prune more.
 z3::expr phiRootModule( Context& ctx, const SmtConfiguration& cfg,
                         int moduleIdx )
 {
-    const auto& shoe = cfg.modules[ 0 ].shoes[ A ];
+    const auto& shoe = cfg.modules[ moduleIdx ].shoes[ A ];
     return shoe.x == 0 && shoe.y == 0 && shoe.z == 0 &&
         shoe.qa == 1 && shoe.qb == 0 && shoe.qc == 0 && shoe.qd == 0;
 }
@@ -777,10 +849,10 @@ z3::expr phiEqualConnections( Context& ctx, const SmtConfiguration& a,
     return phi;
 }
 
-z3::expr phiStepConnect( Context& ctx, const SmtConfiguration& a,
-        const SmtConfiguration& b )
+z3::expr phiSubsetConnections( Context& ctx, const SmtConfiguration& a,
+    const SmtConfiguration& b )
 {
-    z3::expr phi = phiEqualJoints( ctx, a, b );
+    z3::expr phi = ctx.ctx.bool_val( true );
 
     for ( auto [ m, ms, n, ns ] : allShoePairs( a.modules.size() ) ) {
         for ( auto [ mc, nc, o ] : allShoeConnections() ) {
@@ -792,19 +864,16 @@ z3::expr phiStepConnect( Context& ctx, const SmtConfiguration& a,
     return phi;
 }
 
-z3::expr phiStepDisconnect( Context& ctx, const SmtConfiguration& a,
+z3::expr phiStepConnect( Context& ctx, const SmtConfiguration& a,
         const SmtConfiguration& b )
 {
-    z3::expr phi = phiEqualJoints( ctx, a, b );
-
-    for ( auto [ m, ms, n, ns ] : allShoePairs( a.modules.size() ) ) {
-        for ( auto [ mc, nc, o ] : allShoeConnections() ) {
-            phi = phi && z3::implies( b.connection( m, ms, mc, n, ns, nc, o ),
-                a.connection( m, ms, mc, n, ns, nc, o ) );
-        }
-    }
+    return phiEqualJoints( ctx, a, b ) && phiSubsetConnections( ctx, a, b );
+}
 
-    return phi;
+z3::expr phiStepDisconnect( Context& ctx, const SmtConfiguration& a,
+        const SmtConfiguration& b )
+{
+    return phiEqualJoints( ctx, a, b ) && phiSubsetConnections( ctx, b, a );
 }
 
 z3::expr phiStepRotate( Context& ctx, const SmtConfiguration& a,
@@ -847,7 +916,76 @@ std::pair< z3::expr, std::vector< SmtConfiguration > > reconfig( Context& ctx,
     return { phi, cfgs };
 }
 
+IncrementalReconfig::IncrementalReconfig( Context& ctx, z3::solver& solver,
+    const Configuration& init, const Configuration& target )
+    : _ctx( ctx ), _solver( solver ), _init( init ), _target( target )
+{
+    _add( _ctx.constraints() );
+    _addConfiguration();
+    _add( phiEqual( _ctx, _cfgs.front(), _init ) );
+}
+
+void IncrementalReconfig::_add( z3::expr phi ) {
+    if ( _ctx.cfg.simplify )
+        phi = phi.simplify();
+    _solver.add( phi );
+}
+
+void IncrementalReconfig::_addConfiguration() {
+    _cfgs.push_back( buildConfiguration( _ctx, _init, length() ) );
+    const auto& cfg = _cfgs.back();
+    _add( phiValid( _ctx, cfg ) && phiRootModule( _ctx, cfg, 0 )
+        && cfg.constraints( _ctx ) );
+}
+
+void IncrementalReconfig::extend() {
+    _addConfiguration();
+    _add( phiStep( _ctx, _cfgs[ _cfgs.size() - 2 ], _cfgs.back() ) );
+}
+
+z3::check_result IncrementalReconfig::check() {
+    z3::expr goal = _ctx.ctx.bool_const( fmt::format( "goal{}", length() ).c_str() );
+    _add( z3::implies( goal, phiEqual( _ctx, _cfgs.back(), _target ) ) );
+    z3::expr_vector assumptions( _ctx.ctx );
+    assumptions.push_back( goal );
+    auto res = _solver.check( assumptions );
+    if ( res == z3::unsat ) {
+        // The target is not reachable in this length; drop the guarded
+        // clauses for good.
+        _solver.add( !goal );
+    }
+    return res;
+}
+
 z3::expr SmtConfiguration::constraints( Context& ctx ) const {
+    z3::expr res = connectionConstraints( ctx ) && phiSinCos( ctx, *this );
+    if ( ctx.cfg.symmetryBreaking ) {
+        // Negating both quaternions of a module gives the same positions
+        // and, as orientations are compared up to sign, the same
+        // connections. Pick the lexicographically positive one; the root
+        // shoe is fixed by phiRootModule.
+        for ( size_t i = 1; i < modules.size(); i++ ) {
+            const Shoe& s = modules[ i ].shoes[ A ];
+            res = res && ( s.qa > 0 || ( s.qa == 0 && ( s.qb > 0
+                || ( s.qb == 0 && ( s.qc > 0 || ( s.qc == 0 && s.qd > 0 ) ) ) ) ) );
+        }
+    }
+
+    if ( ctx.cfg.stepSize == Parameters::StepSize::Step90 ) {
+        for ( const Module& m : modules ) {
+            res = res &&
+                ( m.alpha.sin == 0 || m.alpha.sin == 1 || m.alpha.sin == -1 );
+            res = res &&
+                ( m.beta.sin == 0 || m.beta.sin == 1 || m.beta.sin == -1 );
+            res = res &&
+                ( m.gamma.sin == 0 || m.gamma.sin == 1 || m.gamma.sin == -1 );
+        }
+    }
+
+    return res;
+}
+
+z3::expr SmtConfiguration::connectionConstraints( Context& ctx ) const {
     z3::expr res = ctx.ctx.bool_val( true );
     if ( ctx.cfg.shoeLimitConstain ) {
         // Each two shoes have at most one connection
@@ -876,20 +1014,6 @@ z3::expr SmtConfiguration::constraints( Context& ctx ) const {
                 res = res && smt::atMostOne( ctx.ctx, conns );
         }
     }
-
-    res = res && phiSinCos( ctx, *this );
-
-    if ( ctx.cfg.stepSize == Parameters::StepSize::Step90 ) {
-        for ( const Module& m : modules ) {
-            res = res &&
-                ( m.alpha.sin == 0 || m.alpha.sin == 1 || m.alpha.sin == -1 );
-            res = res &&
-                ( m.beta.sin == 0 || m.beta.sin == 1 || m.beta.sin == -1 );
-            res = res &&
-                ( m.gamma.sin == 0 || m.gamma.sin == 1 || m.gamma.sin == -1 );
-        }
-    }
-
     return res;
 }
 
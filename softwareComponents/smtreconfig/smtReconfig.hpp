@@ -16,6 +16,9 @@ struct Parameters {
     bool shoeLimitConstain = false;
     bool connectorLimitConstrain = false;
     bool simplify = false;
+    // Prune connections that can never form and fix the sign of shoe
+    // orientations; see `SmtConfiguration::constraints`
+    bool symmetryBreaking = false;
 };
 
 struct Context {
@@ -72,6 +75,8 @@ struct SmtConfiguration {
     }
 
     z3::expr constraints( Context& ctx ) const;
+    // Limits on the number of connections, independent of the geometry
+    z3::expr connectionConstraints( Context& ctx ) const;
 };
 
 void collectVar( const SinCosAngle& a, std::vector< z3::expr >& out );
@@ -99,6 +104,37 @@ SmtConfiguration buildConfiguration( Context& ctx,
 std::pair< z3::expr, std::vector< SmtConfiguration > > reconfig( Context& ctx,
     int len, const Configuration& init, const Configuration target );
 
+/**
+ * Reconfiguration formula built one configuration at a time in a single
+ * solver. Every `extend` adds a configuration with its validity constraints
+ * and the step leading to it. The goal equality of the current length is
+ * guarded by a fresh assumption literal, so a failed length is retracted
+ * without losing the clauses learned while solving it.
+ */
+class IncrementalReconfig {
+public:
+    IncrementalReconfig( Context& ctx, z3::solver& solver,
+        const Configuration& init, const Configuration& target );
+
+    // Appends one configuration and the step leading to it
+    void extend();
+
+    // Checks whether the last configuration can be the target
+    z3::check_result check();
+
+    int length() const { return static_cast< int >( _cfgs.size() ); }
+    const std::vector< SmtConfiguration >& configurations() const { return _cfgs; }
+
+private:
+    void _add( z3::expr phi );
+    void _addConfiguration();
+
+    Context& _ctx;
+    z3::solver& _solver;
+    Configuration _init, _target;
+    std::vector< SmtConfiguration > _cfgs;
+};
+
 z3::expr phiValid( Context& ctx, const SmtConfiguration& cfg );
 z3::expr phiConsistent( Context& ctx, const SmtConfiguration& cfg );
 z3::expr phiNoIntersect( Context& ctx, const SmtConfiguration& cfg );
@@ -108,6 +144,14 @@ z3::expr phiSinCos( Context& ctx, const SmtConfiguration& cfg );
 z3::expr phiConnectorConsistent( Context& ctx, const SmtConfiguration& cfg );
 z3::expr phiEqual( Context& ctx, const SmtConfiguration& smtCfg,
         const Configuration& cfg );
+z3::expr phiEqualConnections( Context& ctx, const SmtConfiguration& smtCfg,
+        const Configuration& cfg );
+z3::expr phiEqualConnections( Context& ctx, const SmtConfiguration& a,
+        const SmtConfiguration& b );
+z3::expr phiSubsetConnections( Context& ctx, const SmtConfiguration& a,
+        const SmtConfiguration& b );
+z3::expr otherShoeOrientation( Context& ctx, const Shoe& a, const Shoe& b,
+        ConnectorId ac, ConnectorId bc, Orientation o );
 z3::expr phiRootModule( Context& ctx, const SmtConfiguration& cfg, int moduleIdx );
 z3::expr phiEqualJoints( Context& ctx, const SmtConfiguration& a,
         const SmtConfiguration& b );
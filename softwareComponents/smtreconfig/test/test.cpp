@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include <smtReconfig.hpp>
+#include <smtDiscrete.hpp>
 #include <fmt/format.h>
 
 using namespace rofi::smtr;
@@ -597,3 +598,147 @@ TEST_CASE( "phiIs Connected" ) {
         REQUIRE( s.check() == z3::sat );
     }
 }
+
+TEST_CASE( "Incremental reconfiguration" ) {
+    Parameters params;
+    params.stepSize = Parameters::StepSize::Step90;
+    Context ctx( params );
+
+    Configuration init;
+    init.addModule( 0, 0, 0, 42 );
+    Configuration target;
+    target.addModule( 0, 90, 0, 42 );
+
+    z3::solver s( ctx.ctx );
+    IncrementalReconfig reconfig( ctx, s, init, target );
+    REQUIRE( reconfig.length() == 1 );
+    REQUIRE( reconfig.check() == z3::unsat );
+
+    reconfig.extend();
+    REQUIRE( reconfig.length() == 2 );
+    REQUIRE( reconfig.check() == z3::sat );
+
+    auto m = s.get_model();
+    const auto& last = reconfig.configurations().back();
+    CHECK( m.eval( last.modules[ 0 ].beta.sin ).get_decimal_string( 1 ) == "1" );
+}
+
+TEST_CASE( "Symmetry breaking" ) {
+    Parameters params;
+    params.stepSize = Parameters::StepSize::Step90;
+    params.symmetryBreaking = true;
+    Context ctx( params );
+
+    Configuration rofiCfg;
+    rofiCfg.addModule( 0, 0, 0, 42 );
+    rofiCfg.addModule( 0, 0, 0, 43 );
+    rofiCfg.addEdge( { 42, B, ZMinus, North, ZMinus, A, 43 } );
+    SmtConfiguration smtCfg = buildConfiguration( ctx, rofiCfg, 0 );
+
+    SECTION( "Shoes of the same parity cannot connect" ) {
+        CHECK( smtCfg.connection( 0, A, XPlus, 1, A, XMinus, North ).is_false() );
+        CHECK( smtCfg.connection( 0, B, XPlus, 1, B, XMinus, North ).is_false() );
+        CHECK( !smtCfg.connection( 0, A, XPlus, 1, B, XMinus, North ).is_false() );
+        CHECK( !smtCfg.connection( 0, B, ZMinus, 1, A, ZMinus, North ).is_false() );
+    }
+
+    SECTION( "Configuration stays satisfiable" ) {
+        z3::solver s( ctx.ctx );
+        s.add( ctx.constraints() );
+        s.add( phiValid( ctx, smtCfg ) && phiRootModule( ctx, smtCfg, 0 ) );
+        s.add( smtCfg.constraints( ctx ) );
+        s.add( phiEqual( ctx, smtCfg, rofiCfg ) );
+        REQUIRE( s.check() == z3::sat );
+
+        auto m = s.get_model();
+        const auto& shoe = smtCfg.modules[ 1 ].shoes[ A ];
+        std::vector< std::string > q;
+        for ( const auto& c : { shoe.qa, shoe.qb, shoe.qc, shoe.qd } )
+            q.push_back( m.eval( c ).get_decimal_string( 5 ) );
+        auto firstNonZero = std::find_if( q.begin(), q.end(), []( const auto& v ) {
+            return v != "0";
+        } );
+        REQUIRE( firstNonZero != q.end() );
+        CHECK( firstNonZero->front() != '-' );
+    }
+}
+
+TEST_CASE( "Bit-vector encoding" ) {
+    const auto& tables = discreteTables();
+    REQUIRE( tables.rotations.size() == 24 );
+
+    Parameters params;
+    params.stepSize = Parameters::StepSize::Step90;
+
+    Configuration rofiCfg;
+    rofiCfg.addModule( 90, 0, 0, 42 );
+    rofiCfg.addModule( 0, -90, 90, 43 );
+    rofiCfg.addEdge( { 42, B, ZMinus, East, XPlus, A, 43 } );
+
+    SECTION( "Shoe positions agree with the real encoding" ) {
+        Context ctx( params );
+        SmtConfiguration smtCfg = buildConfiguration( ctx, rofiCfg, 0 );
+        z3::solver s( ctx.ctx );
+        s.add( ctx.constraints() );
+        s.add( phiValid( ctx, smtCfg ) && phiRootModule( ctx, smtCfg, 0 ) );
+        s.add( smtCfg.constraints( ctx ) && phiEqual( ctx, smtCfg, rofiCfg ) );
+        REQUIRE( s.check() == z3::sat );
+        auto m = s.get_model();
+
+        DiscreteConfiguration dCfg = buildDiscreteConfiguration( ctx, rofiCfg, 1 );
+        z3::solver ds( ctx.ctx );
+        ds.add( phiValid( ctx, dCfg ) && phiRootModule( ctx, dCfg ) );
+        ds.add( dCfg.constraints( ctx ) && phiEqual( ctx, dCfg, rofiCfg ) );
+        REQUIRE( ds.check() == z3::sat );
+        auto dm = ds.get_model();
+
+        auto real = [&]( const z3::expr& e ) {
+            return std::lround( std::stod( m.eval( e ).get_decimal_string( 5 ) ) );
+        };
+        auto discrete = [&]( const z3::expr& e ) {
+            // Sign-extend the two's complement coordinate
+            long v = dm.eval( e ).get_numeral_uint();
+            long limit = 1l << ( dCfg.posWidth - 1 );
+            return v >= limit ? v - 2 * limit : v;
+        };
+        for ( int i = 0; i != 2; i++ ) {
+            for ( auto shoe : { A, B } ) {
+                const auto& r = smtCfg.modules[ i ].shoes[ shoe ];
+                const auto& d = dCfg.modules[ i ].shoes[ shoe ];
+                CAPTURE( i, shoe );
+                CHECK( real( r.x ) == discrete( d.x ) );
+                CHECK( real( r.y ) == discrete( d.y ) );
+                CHECK( real( r.z ) == discrete( d.z ) );
+            }
+        }
+    }
+
+    SECTION( "Intersecting configuration is invalid" ) {
+        Configuration collision;
+        collision.addModule( 0, 0, 0, 42 );
+        collision.addModule( 0, 0, 0, 43 );
+        collision.addModule( 0, 0, 0, 44 );
+        collision.addEdge( { 42, A, XPlus, North, XPlus, A, 43 } );
+        collision.addEdge( { 42, A, XMinus, North, XMinus, A, 44 } );
+        collision.addEdge( { 43, B, XPlus, North, XPlus, B, 44 } );
+
+        Context ctx( params );
+        DiscreteConfiguration dCfg = buildDiscreteConfiguration( ctx, collision, 0 );
+        z3::solver ds( ctx.ctx );
+        ds.add( phiValid( ctx, dCfg ) && phiRootModule( ctx, dCfg ) );
+        ds.add( dCfg.constraints( ctx ) && phiEqual( ctx, dCfg, collision ) );
+        REQUIRE( ds.check() == z3::unsat );
+    }
+
+    SECTION( "Reconfiguration" ) {
+        Context ctx( params );
+        Configuration init;
+        init.addModule( 0, 0, 0, 42 );
+        Configuration target;
+        target.addModule( 0, 90, 0, 42 );
+        auto [ phi, cfgs ] = discreteReconfig( ctx, 2, init, target );
+        z3::solver s( ctx.ctx, "QF_BV" );
+        s.add( phi );
+        REQUIRE( s.check() == z3::sat );
+    }
+}
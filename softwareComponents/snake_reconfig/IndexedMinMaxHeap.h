@@ -0,0 +1,245 @@
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Bounded double-ended priority queue of unique keys.
+ *
+ * Unlike `MinMaxHeap`, every key is stored at most once and its priority
+ * can be changed or the key removed in O(log n). The entries are ordered
+ * by two binary heaps, a min-heap and a max-heap, both holding slot
+ * indices into a shared entry array; each entry remembers its position in
+ * both heaps so that it can be sifted from there.
+ */
+template<typename Key, typename Priority, typename Hash = std::hash<Key>>
+class IndexedMinMaxHeap {
+public:
+    using value_type = std::pair<Priority, Key>;
+
+    explicit IndexedMinMaxHeap(size_t cap)
+    : _capacity(cap) {
+        _entries.reserve(cap);
+        _min_heap.reserve(cap);
+        _max_heap.reserve(cap);
+        _slots.reserve(cap);
+    }
+
+    /**
+     * \brief Inserts \p key with \p priority.
+     *
+     * \return `false` if the heap is full or already contains \p key.
+     */
+    bool push(const Key& key, Priority priority) {
+        if (full() || contains(key))
+            return false;
+
+        size_t slot;
+        if (_free.empty()) {
+            slot = _entries.size();
+            _entries.push_back({priority, key, 0, 0});
+        } else {
+            slot = _free.back();
+            _free.pop_back();
+            _entries[slot] = {priority, key, 0, 0};
+        }
+        _slots.emplace(key, slot);
+
+        _entries[slot].min_pos = _min_heap.size();
+        _min_heap.push_back(slot);
+        _sift_up(Min, _entries[slot].min_pos);
+
+        _entries[slot].max_pos = _max_heap.size();
+        _max_heap.push_back(slot);
+        _sift_up(Max, _entries[slot].max_pos);
+        return true;
+    }
+
+    /**
+     * \brief Sets the priority of \p key to \p priority if it is lower.
+     *
+     * \return `true` if the priority was lowered.
+     */
+    bool decrease(const Key& key, Priority priority) {
+        Entry& entry = _entries[_slot(key)];
+        if (!(priority < entry.priority))
+            return false;
+        entry.priority = priority;
+        _sift_up(Min, entry.min_pos);
+        _sift_down(Max, entry.max_pos);
+        return true;
+    }
+
+    /**
+     * \brief Sets the priority of \p key to \p priority.
+     */
+    void update(const Key& key, Priority priority) {
+        Entry& entry = _entries[_slot(key)];
+        entry.priority = priority;
+        _restore(Min, entry.min_pos);
+        _restore(Max, entry.max_pos);
+    }
+
+    /**
+     * \brief Removes \p key.
+     *
+     * \return `false` if the heap does not contain \p key.
+     */
+    bool remove(const Key& key) {
+        auto it = _slots.find(key);
+        if (it == _slots.end())
+            return false;
+        _erase(it->second);
+        return true;
+    }
+
+    bool contains(const Key& key) const {
+        return _slots.find(key) != _slots.end();
+    }
+
+    const Priority& priority(const Key& key) const {
+        return _entries[_slot(key)].priority;
+    }
+
+    value_type min() const {
+        if (empty())
+            throw std::logic_error("Empty heap");
+        const Entry& entry = _entries[_min_heap[0]];
+        return {entry.priority, entry.key};
+    }
+
+    value_type max() const {
+        if (empty())
+            throw std::logic_error("Empty heap");
+        const Entry& entry = _entries[_max_heap[0]];
+        return {entry.priority, entry.key};
+    }
+
+    value_type popMin() {
+        value_type ret_val = min();
+        _erase(_min_heap[0]);
+        return ret_val;
+    }
+
+    value_type popMax() {
+        value_type ret_val = max();
+        _erase(_max_heap[0]);
+        return ret_val;
+    }
+
+    size_t size() const {
+        return _min_heap.size();
+    }
+
+    size_t limit() const {
+        return _capacity;
+    }
+
+    bool empty() const {
+        return _min_heap.empty();
+    }
+
+    bool full() const {
+        return size() >= _capacity;
+    }
+
+private:
+    struct Entry {
+        Priority priority;
+        Key key;
+        size_t min_pos;
+        size_t max_pos;
+    };
+
+    enum Side { Min, Max };
+
+    size_t _slot(const Key& key) const {
+        auto it = _slots.find(key);
+        if (it == _slots.end())
+            throw std::logic_error("Key is not in the heap");
+        return it->second;
+    }
+
+    std::vector<size_t>& _heap(Side side) {
+        return side == Min ? _min_heap : _max_heap;
+    }
+
+    size_t& _pos(Side side, size_t slot) {
+        return side == Min ? _entries[slot].min_pos : _entries[slot].max_pos;
+    }
+
+    // Whether slot a belongs above slot b in the heap of the given side.
+    bool _before(Side side, size_t a, size_t b) const {
+        return side == Min ? _entries[a].priority < _entries[b].priority
+                           : _entries[b].priority < _entries[a].priority;
+    }
+
+    void _place(Side side, size_t i, size_t slot) {
+        _heap(side)[i] = slot;
+        _pos(side, slot) = i;
+    }
+
+    void _sift_up(Side side, size_t i) {
+        auto& heap = _heap(side);
+        size_t slot = heap[i];
+        while (i > 0) {
+            size_t p = (i - 1) / 2;
+            if (!_before(side, slot, heap[p]))
+                break;
+            _place(side, i, heap[p]);
+            i = p;
+        }
+        _place(side, i, slot);
+    }
+
+    void _sift_down(Side side, size_t i) {
+        auto& heap = _heap(side);
+        size_t slot = heap[i];
+        while (true) {
+            size_t child = 2 * i + 1;
+            if (child >= heap.size())
+                break;
+            if (child + 1 < heap.size() && _before(side, heap[child + 1], heap[child]))
+                ++child;
+            if (!_before(side, heap[child], slot))
+                break;
+            _place(side, i, heap[child]);
+            i = child;
+        }
+        _place(side, i, slot);
+    }
+
+    void _restore(Side side, size_t i) {
+        if (i > 0 && _before(side, _heap(side)[i], _heap(side)[(i - 1) / 2]))
+            _sift_up(side, i);
+        else
+            _sift_down(side, i);
+    }
+
+    void _remove_at(Side side, size_t i) {
+        auto& heap = _heap(side);
+        size_t last = heap.back();
+        heap.pop_back();
+        if (i == heap.size())
+            return;
+        _place(side, i, last);
+        _restore(side, i);
+    }
+
+    void _erase(size_t slot) {
+        _remove_at(Min, _entries[slot].min_pos);
+        _remove_at(Max, _entries[slot].max_pos);
+        _slots.erase(_entries[slot].key);
+        _free.push_back(slot);
+    }
+
+    size_t _capacity;
+    std::vector<Entry> _entries;
+    std::vector<size_t> _free;
+    std::vector<size_t> _min_heap;
+    std::vector<size_t> _max_heap;
+    std::unordered_map<Key, size_t, Hash> _slots;
+};
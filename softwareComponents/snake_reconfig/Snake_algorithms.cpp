@@ -1,6 +1,8 @@
 #include "Snake_algorithms.h"
 #include <nlohmann/json.hpp>
+#include <atoms/util.hpp>
 #include <cassert>
+#include <algorithm>
 
 /* * * * * * * * *
  * Top-most algo *
@@ -94,22 +96,32 @@ void logProgressCSV(std::ostream& debug_output, unsigned progress, std::optional
 }
 
 std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration& init, ProgressCallback logTime) {
+    return reconfigToSnake(init, SnakeStrategy{}, logTime);
+}
+
+std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration& init,
+    const SnakeStrategy& strategy, ProgressCallback logTime) {
+    SnakeSearchOptions options = snakeSearchOptions();
+    options.limitScale *= strategy.limitScale;
+    ScopedSnakeSearchOptions scope(options);
+    const auto& stop = options.stop;
+
     auto start = std::chrono::system_clock::now();
 
-    auto path = aerateConfig(init);
+    auto path = strategy.aerateFromRoot ? aerateFromRoot(init) : aerateConfig(init);
     auto afterAerate = std::chrono::system_clock::now();
     logTime(0, start, afterAerate, {}, {}, {}, {}, path.size());
     if (path.empty()) {
         return {path, false};
     }
 
-    path.push_back(treefy<MakeStar>(path.back()));
+    path.push_back(treefy<MakeStar>(path.back(), strategy.chooseRoot));
 
     auto [toSnake, finishedTTS] = treeToChain(path.back());
     auto afterTTS = std::chrono::system_clock::now();
     vectorAppend(path, toSnake);
     logTime(1, start, afterAerate, afterTTS, {}, {}, {}, path.size());
-    if (!finishedTTS) {
+    if (!finishedTTS || stop.stop_requested()) {
         return {path, false};
     }
 
@@ -117,7 +129,7 @@ std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration&
     auto afterParity = std::chrono::system_clock::now();
     vectorAppend(path, fixedSnake);
     logTime(2, start, afterAerate, afterTTS, afterParity, {}, {}, path.size());
-    if (!finishedFP) {
+    if (!finishedFP || stop.stop_requested()) {
         return {path, false};
     }
 
@@ -125,7 +137,7 @@ std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration&
     auto afterDocks = std::chrono::system_clock::now();
     vectorAppend(path, dockSnake);
     logTime(3, start, afterAerate, afterTTS, afterParity, afterDocks, {}, path.size());
-    if (!finishedFD) {
+    if (!finishedFD || stop.stop_requested()) {
         return {path, false};
     }
 
@@ -133,7 +145,7 @@ std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration&
     auto afterCircle = std::chrono::system_clock::now();
     vectorAppend(path, flatCircle);
     logTime(4, start, afterAerate, afterTTS, afterParity, afterDocks, afterCircle, path.size());
-    if (!finishedFC) {
+    if (!finishedFC || stop.stop_requested()) {
         return {path, false};
     }
 
@@ -276,11 +288,29 @@ ID closestMass(const Configuration& init) {
     return bestID;
 }
 
+ID lowestId(const Configuration& init) {
+    return init.getModules().begin()->first;
+}
+
+ID mostConnected(const Configuration& init) {
+    ID bestID = init.getModules().begin()->first;
+    size_t bestCount = 0;
+    for (const auto& [id, edges] : init.getEdges()) {
+        size_t count = std::count_if(edges.begin(), edges.end(),
+            [](const auto& edge) { return edge.has_value(); });
+        if (count > bestCount) {
+            bestCount = count;
+            bestID = id;
+        }
+    }
+    return bestID;
+}
+
 /* * * * * * * *
  * Connect arm *
  * * * * * * * */
 
-void addSubtree(ID subRoot, std::unordered_set<ID>& allowed, const std::unordered_map<ID, std::array<std::optional<Edge>, 6>>& spannSucc) {
+void addSubtree(ID subRoot, std::unordered_set<ID>& allowed, const EdgeMap& spannSucc) {
     std::queue<ID> toAdd;
     toAdd.push(subRoot);
     while (!toAdd.empty()) {
@@ -447,7 +477,7 @@ void computeSubtreeSizes(const Configuration& config, std::unordered_map<ID, uns
     }
 }
 
-double moduleDist(ID id1, ID id2, const std::unordered_map<ID, std::array<Matrix, 2>>& matrices) {
+double moduleDist(ID id1, ID id2, const MatrixMap& matrices) {
     return moduleDistance(matrices.at(id1)[0], matrices.at(id1)[1], matrices.at(id2)[0], matrices.at(id2)[1]);
 }
 
@@ -4,7 +4,7 @@
 #include <legacy/configuration/IO.h>
 #include <legacy/configuration/Generators.h>
 #include <Algorithms.h>
-#include "MinMaxHeap.h"
+#include "IndexedMinMaxHeap.h"
 #include "Snake_structs.h"
 #include <limits>
 #include <queue>
@@ -13,6 +13,8 @@
 #include <stack>
 #include <functional>
 #include <chrono>
+#include <stop_token>
+#include <utility>
 #include <nlohmann/json.hpp>
 
 template<typename T>
@@ -23,15 +25,68 @@ void vectorAppend(std::vector<T>& base, const std::vector<T>& toApp) {
     }
 }
 
-struct SnakeEvalCompare {
+/**
+ * Knobs of `limitedAstar` for the current thread. A portfolio run sets them
+ * with `ScopedSnakeSearchOptions` so that every search of its pipeline
+ * scales its queue limit and stops once cancellation is requested.
+ */
+struct SnakeSearchOptions {
+    double limitScale = 1;
+    std::stop_token stop;
+};
+
+inline SnakeSearchOptions& snakeSearchOptions() {
+    thread_local SnakeSearchOptions options;
+    return options;
+}
+
+class ScopedSnakeSearchOptions {
 public:
-    bool operator()(const EvalPair& a, const EvalPair& b) const {
-        return std::get<0>(a) < std::get<0>(b);
+    explicit ScopedSnakeSearchOptions(SnakeSearchOptions options)
+        : _previous(std::exchange(snakeSearchOptions(), std::move(options))) {}
+    ~ScopedSnakeSearchOptions() { snakeSearchOptions() = std::move(_previous); }
+
+    ScopedSnakeSearchOptions(const ScopedSnakeSearchOptions&) = delete;
+    ScopedSnakeSearchOptions& operator=(const ScopedSnakeSearchOptions&) = delete;
+
+private:
+    SnakeSearchOptions _previous;
+};
+
+/**
+ * Counters of the `limitedAstar` calls made on the current thread; used by
+ * the benchmark driver.
+ */
+struct SnakeSearchStats {
+    unsigned long calls = 0;
+    unsigned long expanded = 0;
+    std::chrono::steady_clock::duration time{0};
+};
+
+inline SnakeSearchStats& snakeSearchStats() {
+    thread_local SnakeSearchStats stats;
+    return stats;
+}
+
+class SnakeSearchTimer {
+public:
+    SnakeSearchTimer() : _start(std::chrono::steady_clock::now()) {
+        ++snakeSearchStats().calls;
+    }
+    ~SnakeSearchTimer() {
+        snakeSearchStats().time += std::chrono::steady_clock::now() - _start;
     }
+
+    SnakeSearchTimer(const SnakeSearchTimer&) = delete;
+    SnakeSearchTimer& operator=(const SnakeSearchTimer&) = delete;
+
+private:
+    std::chrono::steady_clock::time_point _start;
 };
 
 template<typename GenNext, typename Score>
 std::pair<std::vector<Configuration>, bool> limitedAstar(const Configuration& init, GenNext& genNext, Score& getScore, unsigned limit) {
+    SnakeSearchTimer timer;
     unsigned step = 90;
     double path_pref = 0.1;
     double free_pref = 1 - path_pref;
@@ -49,23 +104,28 @@ std::pair<std::vector<Configuration>, bool> limitedAstar(const Configuration& in
     if (startDist == 0)
         return {std::vector<Configuration>{init}, true};
 
-    MinMaxHeap<EvalPair, SnakeEvalCompare> queue(limit);
+    const auto& options = snakeSearchOptions();
+    limit = std::max(1u, unsigned(limit * options.limitScale));
+
+    // Every configuration is queued at most once; a shorter route lowers
+    // its key instead of adding a duplicate, so pruning sees live entries only.
+    IndexedMinMaxHeap<const Configuration*, double> queue(limit);
 
     const Configuration* pointer = pool.insert(init);
     const Configuration* bestConfig = pointer;
     double bestScore = startDist;
-    double worstDist = startDist;
 
     initDist[pointer] = 0;
     goalDist[pointer] = startDist;
     pred[pointer] = pointer;
     unsigned i = 0;
-    queue.push( {goalDist[pointer], pointer} );
+    queue.push(pointer, goalDist[pointer]);
 
 
-    while (!queue.empty() && i++ < limit) {
+    while (!queue.empty() && i++ < limit && !options.stop.stop_requested()) {
         const auto [d, current] = queue.popMin();
         double currDist = initDist[current];
+        ++snakeSearchStats().expanded;
 
         std::vector<Configuration> nextCfgs;
         genNext(*current, nextCfgs, step);
@@ -76,29 +136,20 @@ std::pair<std::vector<Configuration>, bool> limitedAstar(const Configuration& in
             double newDist = path_pref * (currDist + 1) + free_pref * newEval;
             bool update = false;
 
-            if (newEval != 0 && limit <= queue.size() + i) {
-                if (newDist > worstDist)
+            const Configuration* known = pool.get(next);
+            bool queued = known != nullptr && queue.contains(known);
+            // Revisits that do not shorten the route are not pushed, so they
+            // must not evict anything either.
+            bool improves = known == nullptr || currDist + 1 < initDist[known];
+            if (improves && !queued && newEval != 0 && limit <= queue.size() + i) {
+                if (queue.empty() || newDist > queue.max().first)
                     continue;
-                if (!queue.empty()) {
-                    queue.popMax();
-                    if (!queue.empty()) {
-                        const auto [newWorstD, _worstConfig] = queue.max();
-                        worstDist = newWorstD;
-                    } else {
-                        worstDist = newDist;
-                    }
-                }
+                queue.popMax();
             }
 
-            if (newDist > worstDist)
-                worstDist = newDist;
-
-            if (!pool.has(next)) {
-                pointerNext = pool.insert(next);
+            std::tie(pointerNext, update) = pool.insert_or_get(next);
+            if (update) {
                 initDist[pointerNext] = currDist + 1;
-                update = true;
-            } else {
-                pointerNext = pool.get(next);
             }
 
             if (newEval < bestScore) {
@@ -110,7 +161,10 @@ std::pair<std::vector<Configuration>, bool> limitedAstar(const Configuration& in
                 initDist[pointerNext] = currDist + 1;
                 goalDist[pointerNext] = newDist;
                 pred[pointerNext] = current;
-                queue.push({newDist, pointerNext});
+                if (queued)
+                    queue.decrease(pointerNext, newDist);
+                else
+                    queue.push(pointerNext, newDist);
             }
 
             if (newEval == 0) {
@@ -133,6 +187,8 @@ std::vector<Configuration> straightenSnake(const Configuration& init);
 
 using chooseRootFunc = ID(const Configuration&);
 ID closestMass(const Configuration& init);
+ID lowestId(const Configuration& init);
+ID mostConnected(const Configuration& init);
 
 template<typename Next>
 inline Configuration treefy(const Configuration& init, chooseRootFunc chooseRoot = closestMass) {
@@ -182,6 +238,21 @@ using ProgressCallback = std::function< void(
 
 std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration& init, ProgressCallback progressCallback);
 
+/**
+ * A variant of the `reconfigToSnake` pipeline: how the configuration is
+ * aerated first, which module becomes the root of the tree and how large
+ * the queues of its searches are.
+ */
+struct SnakeStrategy {
+    std::string name = "default";
+    bool aerateFromRoot = false;
+    chooseRootFunc* chooseRoot = closestMass;
+    double limitScale = 1;
+};
+
+std::pair<std::vector<Configuration>, bool> reconfigToSnake(const Configuration& init,
+    const SnakeStrategy& strategy, ProgressCallback progressCallback);
+
 void appendMapped(std::vector<Configuration>& path1, const std::vector<Configuration>& path2);
 
 std::vector<Configuration> reconfigThroughSnake(const Configuration& from, const Configuration& to);
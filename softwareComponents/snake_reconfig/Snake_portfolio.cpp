@@ -0,0 +1,91 @@
+#include "Snake_portfolio.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+std::vector<SnakeStrategy> defaultPortfolio() {
+    std::vector<SnakeStrategy> strategies;
+    const std::pair<const char*, chooseRootFunc*> roots[] = {
+        {"mass", closestMass}, {"lowest", lowestId}, {"connected", mostConnected}};
+    for (const auto& [rootName, chooseRoot] : roots) {
+        for (bool fromRoot : {false, true}) {
+            for (double scale : {1.0, 2.0}) {
+                std::string name = std::string(rootName) + (fromRoot ? "/root" : "/grid")
+                    + "/x" + std::to_string(int(scale));
+                strategies.push_back({name, fromRoot, chooseRoot, scale});
+            }
+        }
+    }
+    return strategies;
+}
+
+PortfolioResult snakePortfolio(const Configuration& init,
+    const std::vector<SnakeStrategy>& strategies, const PortfolioOptions& options)
+{
+    PortfolioResult best;
+    if (strategies.empty())
+        return best;
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<size_t>(threads, strategies.size()));
+
+    std::stop_source stop;
+    std::mutex mutex;
+    std::condition_variable allDone;
+    std::atomic<size_t> nextStrategy{0};
+    unsigned running = threads;
+
+    auto offer = [&](size_t index, std::vector<Configuration>&& path, nlohmann::json&& progress) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (best.success && best.path.size() <= path.size())
+            return;
+        best.path = std::move(path);
+        best.success = true;
+        best.strategy = index;
+        best.progress = std::move(progress);
+        if (options.firstWins)
+            stop.request_stop();
+    };
+
+    auto worker = [&] {
+        ScopedSnakeSearchOptions scope({1, stop.get_token()});
+        for (size_t i = nextStrategy++; i < strategies.size() && !stop.stop_requested(); i = nextStrategy++) {
+            try {
+                nlohmann::json progress;
+                auto [path, success] = reconfigToSnake(init, strategies[i], [&]( auto... args ) {
+                    progress = logProgressJson( std::forward< decltype( args ) >( args )... );
+                });
+                if (success && !stop.stop_requested())
+                    offer(i, std::move(path), std::move(progress));
+            } catch (const std::exception&) {
+                // The pipeline gives up on configurations it cannot handle;
+                // other strategies may still succeed.
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0)
+            allDone.notify_all();
+    };
+
+    std::vector<std::jthread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(worker);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto finished = [&] { return running == 0; };
+        if (options.deadline > 0) {
+            auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(options.deadline));
+            if (!allDone.wait_until(lock, deadline, finished))
+                stop.request_stop();
+        }
+        allDone.wait(lock, finished);
+    }
+    return best;
+}
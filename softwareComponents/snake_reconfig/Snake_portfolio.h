@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Snake_algorithms.h"
+#include <optional>
+#include <vector>
+
+/* PORTFOLIO
+ *
+ * Runs several `SnakeStrategy` variants of `reconfigToSnake` at once on
+ * a pool of threads. Which variant succeeds, and how fast, depends on the
+ * instance; the portfolio returns either the first plan found or the
+ * shortest plan found before the deadline. Runs that can no longer win are
+ * cancelled cooperatively: their searches see the stop request through
+ * `snakeSearchOptions()` and give up.
+ * */
+
+struct PortfolioOptions {
+    unsigned threads = 0;       // 0 for all cores
+    double deadline = 0;        // seconds, 0 for no limit
+    bool firstWins = true;      // otherwise the shortest plan wins
+};
+
+struct PortfolioResult {
+    std::vector<Configuration> path;
+    bool success = false;
+    std::optional<size_t> strategy;     // index of the winning strategy
+    nlohmann::json progress;            // per-phase times of the winning run
+};
+
+/**
+ * \brief Root choices x aeration variants x A* limit scales.
+ */
+std::vector<SnakeStrategy> defaultPortfolio();
+
+PortfolioResult snakePortfolio(const Configuration& init,
+    const std::vector<SnakeStrategy>& strategies, const PortfolioOptions& options);
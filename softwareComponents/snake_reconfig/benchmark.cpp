@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <legacy/configuration/Configuration.h>
+#include <legacy/configuration/IO.h>
+#include "Snake_algorithms.h"
+#include <dimcli/cli.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* BENCHMARK
+ *
+ * Runs `reconfigToSnake` on a set of instances and writes one JSON record
+ * per instance: status, path length, per-phase times, limitedAstar calls,
+ * expanded states and time, wall time and peak RSS.
+ *
+ * All instances are loaded up front; every run then happens in a forked
+ * process, so that several run at once, a run can be killed on timeout
+ * and its peak memory is measured on its own.
+ * */
+
+Dim::Cli cli;
+auto& inputs = cli.optVec< std::string >( "<INSTANCES>" )
+    .desc( "Configuration files or directories of them (*.out files are skipped)" );
+auto& jobs = cli.opt< unsigned >( "j jobs", 1 )
+    .desc( "Number of instances running at once; 0 for all cores" );
+auto& timeout = cli.opt< double >( "timeout", 0 )
+    .desc( "Time limit of one instance in seconds; 0 for no limit" );
+auto& outputFile = cli.opt< std::string >( "o output" )
+    .desc( "JSON output file; standard output if not given" );
+
+struct Instance {
+    std::string file;
+    Configuration config;
+    bool loaded = false;
+    nlohmann::json record;
+};
+
+struct Running {
+    size_t index;
+    pid_t pid;
+    int fd;
+    std::string report;
+    std::chrono::steady_clock::time_point start;
+    bool killed = false;
+};
+
+std::vector<std::string> listInstances() {
+    std::vector<std::string> files;
+    for ( const auto& input : inputs ) {
+        if ( !std::filesystem::is_directory( input ) ) {
+            files.push_back( input );
+            continue;
+        }
+        std::vector<std::string> dirFiles;
+        for ( const auto& entry : std::filesystem::directory_iterator( input ) ) {
+            if ( entry.is_regular_file() && entry.path().extension() != ".out" )
+                dirFiles.push_back( entry.path().string() );
+        }
+        std::sort( dirFiles.begin(), dirFiles.end() );
+        files.insert( files.end(), dirFiles.begin(), dirFiles.end() );
+    }
+    return files;
+}
+
+[[noreturn]] void runChild( const Instance& instance, int fd ) {
+    nlohmann::json report;
+    try {
+        nlohmann::json phases;
+        auto [path, success] = reconfigToSnake( instance.config, [&]( auto... args ) {
+            phases = logProgressJson( std::forward< decltype( args ) >( args )... );
+        });
+        const auto& stats = snakeSearchStats();
+        report = {
+            { "status", success ? "ok" : "incomplete" },
+            { "pathLength", path.size() },
+            { "phases", phases },
+            { "astar", {
+                { "calls", stats.calls },
+                { "expanded", stats.expanded },
+                { "time", std::chrono::duration_cast< std::chrono::milliseconds >( stats.time ).count() }
+            } }
+        };
+    } catch ( const std::exception& e ) {
+        report = { { "status", "error" }, { "error", e.what() } };
+    }
+
+    std::string out = report.dump();
+    const char* data = out.data();
+    size_t left = out.size();
+    while ( left > 0 ) {
+        auto written = write( fd, data, left );
+        if ( written <= 0 )
+            _exit( 1 );
+        data += written;
+        left -= size_t( written );
+    }
+    _exit( 0 );
+}
+
+void drain( Running& run ) {
+    char buffer[ 4096 ];
+    ssize_t count;
+    while ( ( count = read( run.fd, buffer, sizeof( buffer ) ) ) > 0 )
+        run.report.append( buffer, size_t( count ) );
+}
+
+void collect( Running& run, int waitStatus, const rusage& usage, Instance& instance ) {
+    using namespace std::chrono;
+    drain( run );
+    close( run.fd );
+
+    auto& record = instance.record;
+    record["wallTime"] = duration< double >( steady_clock::now() - run.start ).count();
+    record["peakRssKiB"] = usage.ru_maxrss;
+
+    if ( run.killed ) {
+        record["status"] = "timeout";
+        return;
+    }
+    auto report = nlohmann::json::parse( run.report, nullptr, false );
+    if ( !WIFEXITED( waitStatus ) || report.is_discarded() ) {
+        record["status"] = "error";
+        return;
+    }
+    record.update( report );
+}
+
+void runAll( std::vector<Instance>& instances ) {
+    using namespace std::chrono;
+    unsigned maxJobs = *jobs;
+    if ( maxJobs == 0 )
+        maxJobs = std::max( 1u, std::thread::hardware_concurrency() );
+
+    std::vector<Running> running;
+    size_t next = 0;
+    while ( next < instances.size() || !running.empty() ) {
+        while ( next < instances.size() && running.size() < maxJobs ) {
+            Instance& instance = instances[ next ];
+            if ( !instance.loaded ) {
+                instance.record["status"] = "invalid-input";
+                ++next;
+                continue;
+            }
+            int fds[ 2 ];
+            if ( pipe( fds ) != 0 )
+                throw std::runtime_error( "Could not create a pipe" );
+            pid_t pid = fork();
+            if ( pid < 0 )
+                throw std::runtime_error( "Could not fork" );
+            if ( pid == 0 ) {
+                close( fds[ 0 ] );
+                runChild( instance, fds[ 1 ] );
+            }
+            close( fds[ 1 ] );
+            // The report is read while the child runs, so it never blocks
+            // on a full pipe.
+            fcntl( fds[ 0 ], F_SETFL, O_NONBLOCK );
+            running.push_back( { next, pid, fds[ 0 ], {}, steady_clock::now() } );
+            ++next;
+        }
+
+        bool finished = false;
+        for ( auto it = running.begin(); it != running.end(); ) {
+            drain( *it );
+            int waitStatus = 0;
+            rusage usage{};
+            if ( wait4( it->pid, &waitStatus, WNOHANG, &usage ) == it->pid ) {
+                collect( *it, waitStatus, usage, instances[ it->index ] );
+                it = running.erase( it );
+                finished = true;
+                continue;
+            }
+            if ( !it->killed && *timeout > 0
+                && duration< double >( steady_clock::now() - it->start ).count() > *timeout ) {
+                kill( it->pid, SIGKILL );
+                it->killed = true;
+            }
+            ++it;
+        }
+        if ( !finished )
+            std::this_thread::sleep_for( milliseconds( 10 ) );
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if ( !cli.parse( argc, argv ) )
+        return cli.printError( std::cerr );
+
+    std::vector<Instance> instances;
+    for ( const auto& file : listInstances() ) {
+        Instance instance;
+        instance.file = file;
+        std::ifstream input( file );
+        instance.loaded = input.good() && IO::readConfiguration( input, instance.config );
+        if ( instance.loaded )
+            instance.config.computeMatrices();
+        instance.record = {
+            { "instance", file },
+            { "modules", instance.config.getModules().size() }
+        };
+        instances.push_back( std::move( instance ) );
+    }
+
+    runAll( instances );
+
+    auto results = nlohmann::json::array();
+    for ( const auto& instance : instances )
+        results.push_back( instance.record );
+
+    if ( outputFile ) {
+        std::ofstream f( *outputFile );
+        f << std::setw( 4 ) << results << "\n";
+    } else {
+        std::cout << std::setw( 4 ) << results << "\n";
+    }
+    return 0;
+}
@@ -1,8 +1,4 @@
 set -x
-LOG=log.csv
-touch $LOG
-FILES=../data/snakeBench/*
-for f in $FILES
-do
-    ./snake_reconfig/snakeReconfig $f $LOG "${f}.out"
-done
+OUT=${1:-bench.json}
+INSTANCES=${2:-../data/configurations/old/snakeBench}
+./snake_reconfig/snakeBenchmark $INSTANCES -j 0 --timeout 600 -o $OUT
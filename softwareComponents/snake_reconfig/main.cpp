@@ -6,12 +6,23 @@
 #include <legacy/configuration/Configuration.h>
 #include <legacy/configuration/IO.h>
 #include "Snake_algorithms.h"
+#include "Snake_portfolio.h"
 #include <dimcli/cli.h>
 
 Dim::Cli cli;
 auto& inputCfgFile = cli.opt< std::string >( "<INPUT_CFG>" );
 auto& logFile = cli.opt< std::string >( "l log" );
 auto& outputFile = cli.opt< std::string >( "[OUTPUT_FILE]" );
+auto& threads = cli.opt< unsigned >( "t threads", 1 )
+    .desc( "Number of threads checking successor configurations; 0 for all cores" );
+auto& portfolio = cli.opt< bool >( "portfolio", false )
+    .desc( "Run several strategies at once and keep the first plan found" );
+auto& portfolioThreads = cli.opt< unsigned >( "portfolio-threads", 0 )
+    .desc( "Number of strategies running at once in portfolio mode; 0 for all cores" );
+auto& deadline = cli.opt< double >( "deadline", 0 )
+    .desc( "Cancel portfolio runs after this many seconds; 0 for no limit" );
+auto& shortest = cli.opt< bool >( "shortest", false )
+    .desc( "In portfolio mode, keep the shortest plan found instead of the first one" );
 
 std::string storePath(const std::vector<Configuration>& configs ) {
     std::ostringstream file;
@@ -38,6 +49,7 @@ int main(int argc, char* argv[])
         return cli.printError( std::cerr );
 
     gLogPath = *logFile;
+    setSuccessorThreads( *threads );
 
     finishLog();
 
@@ -46,10 +58,24 @@ int main(int argc, char* argv[])
     IO::readConfiguration( initInput, init );
     init.computeMatrices();
 
-    auto [reconfigPath, success] = reconfigToSnake(init, [&]( auto... args ) {
-        gCurrentProgress = logProgressJson( std::forward< decltype( args ) >( args )... );
-        finishLog();
-    });
+    std::vector<Configuration> reconfigPath;
+    bool success = false;
+    if ( *portfolio ) {
+        auto strategies = defaultPortfolio();
+        auto result = snakePortfolio( init, strategies,
+            { *portfolioThreads, *deadline, !*shortest } );
+        reconfigPath = std::move( result.path );
+        success = result.success;
+        if ( result.strategy ) {
+            gCurrentProgress = std::move( result.progress );
+            gCurrentProgress["strategy"] = strategies[ *result.strategy ].name;
+        }
+    } else {
+        std::tie( reconfigPath, success ) = reconfigToSnake(init, [&]( auto... args ) {
+            gCurrentProgress = logProgressJson( std::forward< decltype( args ) >( args )... );
+            finishLog();
+        });
+    }
 
     auto path = storePath( reconfigPath );
 
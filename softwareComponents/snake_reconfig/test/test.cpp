@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include "../MinMaxHeap.h"
+#include "../IndexedMinMaxHeap.h"
 
 class IntComp{
 public:
@@ -145,3 +146,29 @@ TEST_CASE("Unique Ptr to Ints") {
     REQUIRE(*min == 10);
     REQUIRE(mmh.empty());
 }
+
+TEST_CASE("Indexed heap with decrease-key") {
+    IndexedMinMaxHeap<int, double> imh(5);
+    REQUIRE(imh.limit() == 5);
+    for (int key : {1, 2, 3, 4, 5})
+        REQUIRE(imh.push(key, key * 10));
+    REQUIRE(imh.full());
+    REQUIRE(!imh.push(6, 0));
+    REQUIRE(!imh.push(1, 0));
+
+    REQUIRE(imh.decrease(4, 5));
+    REQUIRE(!imh.decrease(4, 7));
+    REQUIRE(imh.size() == 5);
+    REQUIRE(imh.min() == std::pair<double, int>{5, 4});
+
+    REQUIRE(imh.remove(5));
+    REQUIRE(!imh.remove(5));
+    REQUIRE(imh.max() == std::pair<double, int>{30, 3});
+
+    imh.update(1, 100);
+    REQUIRE(imh.popMax() == std::pair<double, int>{100, 1});
+    REQUIRE(imh.popMin() == std::pair<double, int>{5, 4});
+    REQUIRE(imh.popMin() == std::pair<double, int>{20, 2});
+    REQUIRE(imh.popMax() == std::pair<double, int>{30, 3});
+    REQUIRE(imh.empty());
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+#include <sstream>
+#include "../Snake_portfolio.h"
+
+namespace {
+
+Configuration load(const std::string& text) {
+    std::istringstream input(text);
+    Configuration config;
+    IO::readConfiguration(input, config);
+    config.computeMatrices();
+    return config;
+}
+
+/* The default strategy gives up on this chain, only the searches with
+   larger queues turn it into a snake */
+const std::string chain =
+    "C\n"
+    "M 1 0 0 0\n"
+    "M 2 90 0 0\n"
+    "M 3 0 90 0\n"
+    "E 1 B -Z N -Z A 2\n"
+    "E 2 B -Z N -Z A 3\n";
+
+void checkResult(const Configuration& init, const PortfolioResult& result, size_t strategyCount) {
+    REQUIRE(result.success);
+    REQUIRE(result.strategy);
+    CHECK(*result.strategy < strategyCount);
+    REQUIRE(!result.path.empty());
+    CHECK(IO::toString(result.path.front()) == IO::toString(init));
+    auto last = result.path.back();
+    CHECK(last.isValid());
+
+    // The winning run reports the times of all phases
+    CHECK(result.progress["progress"] == 5);
+    CHECK(!result.progress["circle"].is_null());
+    CHECK(result.progress["pathLen"] == result.path.size());
+}
+
+} // namespace
+
+TEST_CASE("Root choices") {
+    SECTION("Without edges every module is a root candidate") {
+        auto config = load("C\nM 7 0 0 0\nM 9 0 0 0\n");
+        CHECK(lowestId(config) == 7);
+        CHECK(mostConnected(config) == 7);
+    }
+    SECTION("The module with most edges") {
+        CHECK(mostConnected(load(chain)) == 2);
+    }
+}
+
+TEST_CASE("Portfolio finds a snake") {
+    auto init = load(chain);
+    auto strategies = defaultPortfolio();
+    REQUIRE(!reconfigToSnake(init, SnakeStrategy{}, []( auto... /* args */ ){} ).second);
+
+    PortfolioOptions options;
+    options.threads = 2;
+    auto first = snakePortfolio(init, strategies, options);
+    checkResult(init, first, strategies.size());
+
+    options.firstWins = false;
+    auto shortest = snakePortfolio(init, strategies, options);
+    checkResult(init, shortest, strategies.size());
+    CHECK(shortest.path.size() <= first.path.size());
+}
+
+TEST_CASE("Portfolio without strategies fails") {
+    auto result = snakePortfolio(load(chain), {}, {});
+    CHECK(!result.success);
+    CHECK(!result.strategy);
+}
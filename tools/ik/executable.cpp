@@ -23,6 +23,9 @@ int main( int argc, char** argv )
     Vector goal = { 0, 0, 0, 1 };
     std::vector< double > rotation = { 0, 0, 0 };
     int random_targets = 0;
+    multistart ms;
+    bool use_multistart = false;
+    bool all_strategies = false;
     std::ifstream targets;
     std::ofstream results;
 
@@ -81,6 +84,15 @@ int main( int argc, char** argv )
             s = strategy::pseudoinverse;
         } else if( arg == "-fabrik" ){
             s = strategy::fabrik;
+        } else if( arg == "-ms" || arg == "--multistart" ){
+            use_multistart = true;
+            ms.starts = std::stoi( argv[ ++i ] );
+        } else if( arg == "--all-strategies" ){
+            all_strategies = true;
+        } else if( arg == "-j" || arg == "--jobs" ){
+            ms.jobs = std::stoi( argv[ ++i ] );
+        } else if( arg == "--best" ){
+            ms.best = true;
         } else if( arg == "-v" || arg == "--verbose" ){
             opt.verbose = true;
         } else if( arg == "-a" || arg == "--animate" ){
@@ -94,6 +106,12 @@ int main( int argc, char** argv )
         }
 
     }
+    if( all_strategies ){
+        ms.strategies = { strategy::ccd, strategy::fabrik, strategy::pseudoinverse };
+    } else {
+        ms.strategies = { s };
+    }
+
     kinematic_rofibot bot( path, fixed, opt );
 
     if( opt.random ){
@@ -105,14 +123,14 @@ int main( int argc, char** argv )
     int cur = 0;
     if( !targets.is_open() ){
         if( reach ){
-            result = bot.reach( goal, rotation, s );
+            result = use_multistart ? bot.reach( goal, rotation, ms ) : bot.reach( goal, rotation, s );
         }
         if( connect ){
             result = bot.connect( s, to_connect.first, to_connect.second );
         }
         for( int i = 0; i < random_targets; ++i ){
             if( opt.random ){
-                result = bot.reach_random( s );
+                result = use_multistart ? bot.reach_random( ms ) : bot.reach_random( s );
             }
             if( results.is_open() ){
                 success += (int) result;
@@ -135,7 +153,7 @@ int main( int argc, char** argv )
             if( method == "r" ){
                 ss >> goal[ 0 ] >> goal[ 1 ] >> goal[ 2 ]
                     >> rotation[ 0 ] >> rotation[ 1 ] >> rotation[ 2 ];
-                result = bot.reach( goal, rotation, s );
+                result = use_multistart ? bot.reach( goal, rotation, ms ) : bot.reach( goal, rotation, s );
             } else if( method == "c" ){
                 ss >> to_connect.first >> to_connect.second;
                 result = bot.connect( s, to_connect.first, to_connect.second );